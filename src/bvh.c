@@ -0,0 +1,549 @@
+#include "bvh.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BVH_BINS 16
+// Deepest tree the builder makes, bounds the traversal stacks
+#define BVH_MAX_DEPTH 64
+
+// Plain compares, fminf/fmaxf handle NaN and compile to library calls on the hot build path
+static inline float min_float(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+static inline float max_float(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+static float aabb_area(const float min[3], const float max[3])
+{
+    float dx = max[0] - min[0];
+    float dy = max[1] - min[1];
+    float dz = max[2] - min[2];
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static void aabb_reset(float min[3], float max[3])
+{
+    for (int k = 0; k < 3; k++)
+    {
+        min[k] = FLT_MAX;
+        max[k] = -FLT_MAX;
+    }
+}
+
+static void aabb_grow(float min[3], float max[3], const float other_min[3], const float other_max[3])
+{
+    for (int k = 0; k < 3; k++)
+    {
+        min[k] = min_float(min[k], other_min[k]);
+        max[k] = max_float(max[k], other_max[k]);
+    }
+}
+
+static float centroid(const bvh_aabb_t *object, int axis)
+{
+    return 0.5f * (object->min[axis] + object->max[axis]);
+}
+
+static void leaf_bounds(const bvh_t *bvh, bvh_node_t *node)
+{
+    aabb_reset(node->min, node->max);
+    for (uint32_t i = 0; i < node->count; i++)
+    {
+        const bvh_aabb_t *object = &bvh->objects[bvh->indices[node->first + i]];
+        aabb_grow(node->min, node->max, object->min, object->max);
+    }
+}
+
+typedef struct bvh_bin_t
+{
+    float min[3];
+    float max[3];
+    uint32_t count;
+} bvh_bin_t;
+
+static void subdivide(bvh_t *bvh, uint32_t node_index, int depth)
+{
+    bvh_node_t *node = &bvh->nodes[node_index];
+    uint32_t first = node->first;
+    uint32_t count = node->count;
+    if (count <= 1 || depth >= BVH_MAX_DEPTH - 1)
+    {
+        return;
+    }
+
+    float centroid_min[3], centroid_max[3];
+    aabb_reset(centroid_min, centroid_max);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const bvh_aabb_t *object = &bvh->objects[bvh->indices[first + i]];
+        for (int k = 0; k < 3; k++)
+        {
+            float c = centroid(object, k);
+            centroid_min[k] = min_float(centroid_min[k], c);
+            centroid_max[k] = max_float(centroid_max[k], c);
+        }
+    }
+
+    // best split plane between bins over all three axes, small nodes need fewer bins
+    int bin_count = count < BVH_BINS ? (int)count : BVH_BINS;
+    int best_axis = -1;
+    int best_split = 0;
+    float best_cost = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float extent = centroid_max[axis] - centroid_min[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+
+        bvh_bin_t bins[BVH_BINS];
+        for (int b = 0; b < bin_count; b++)
+        {
+            aabb_reset(bins[b].min, bins[b].max);
+            bins[b].count = 0;
+        }
+
+        float scale = bin_count / extent;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const bvh_aabb_t *object = &bvh->objects[bvh->indices[first + i]];
+            int b = (int)((centroid(object, axis) - centroid_min[axis]) * scale);
+            b = b < bin_count - 1 ? b : bin_count - 1;
+            bins[b].count++;
+            aabb_grow(bins[b].min, bins[b].max, object->min, object->max);
+        }
+
+        // sweep from the left collecting areas, then from the right evaluating each split
+        float left_area[BVH_BINS - 1];
+        uint32_t left_count[BVH_BINS - 1];
+        float min[3], max[3];
+        aabb_reset(min, max);
+        uint32_t sum = 0;
+        for (int b = 0; b < bin_count - 1; b++)
+        {
+            sum += bins[b].count;
+            aabb_grow(min, max, bins[b].min, bins[b].max);
+            left_count[b] = sum;
+            left_area[b] = sum ? aabb_area(min, max) : 0.0f;
+        }
+
+        aabb_reset(min, max);
+        sum = 0;
+        for (int b = bin_count - 1; b > 0; b--)
+        {
+            sum += bins[b].count;
+            aabb_grow(min, max, bins[b].min, bins[b].max);
+            if (sum == 0 || left_count[b - 1] == 0)
+            {
+                continue;
+            }
+
+            float cost = left_area[b - 1] * left_count[b - 1] + aabb_area(min, max) * sum;
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b;
+            }
+        }
+    }
+
+    // a split costs one node test, a leaf one test per object
+    float area = aabb_area(node->min, node->max);
+    float split_cost = 1.0f + (area > 0.0f ? best_cost / area : 0.0f);
+    if (count <= BVH_MAX_LEAF_SIZE && (best_axis < 0 || split_cost >= (float)count))
+    {
+        return;
+    }
+
+    uint32_t left_count = 0;
+    if (best_axis >= 0)
+    {
+        float scale = bin_count / (centroid_max[best_axis] - centroid_min[best_axis]);
+        uint32_t i = first;
+        uint32_t j = first + count;
+        while (i < j)
+        {
+            int b = (int)((centroid(&bvh->objects[bvh->indices[i]], best_axis) - centroid_min[best_axis]) * scale);
+            if (b < best_split)
+            {
+                i++;
+            }
+            else
+            {
+                uint32_t swap = bvh->indices[i];
+                bvh->indices[i] = bvh->indices[--j];
+                bvh->indices[j] = swap;
+            }
+        }
+        left_count = i - first;
+    }
+
+    if (left_count == 0 || left_count == count)
+    {
+        // coincident centroids, any split is as good as another
+        left_count = count / 2;
+    }
+
+    uint32_t left = bvh->node_count;
+    bvh->node_count += 2;
+
+    bvh_node_t *children = &bvh->nodes[left];
+    children[0] = (bvh_node_t){.first = first, .count = left_count};
+    children[1] = (bvh_node_t){.first = first + left_count, .count = count - left_count};
+    leaf_bounds(bvh, &children[0]);
+    leaf_bounds(bvh, &children[1]);
+
+    node->first = left;
+    node->count = 0;
+
+    subdivide(bvh, left, depth + 1);
+    subdivide(bvh, left + 1, depth + 1);
+}
+
+int bvh_build(bvh_t *bvh, const bvh_aabb_t *objects, uint32_t object_count)
+{
+    if (bvh->object_count != object_count || !bvh->nodes)
+    {
+        free(bvh->nodes);
+        free(bvh->indices);
+        free(bvh->objects);
+
+        // a binary tree with one object per leaf has at most 2n - 1 nodes
+        uint32_t node_capacity = object_count ? 2 * object_count - 1 : 1;
+        bvh->nodes = malloc(node_capacity * sizeof(bvh_node_t));
+        bvh->indices = malloc((object_count ? object_count : 1) * sizeof(uint32_t));
+        bvh->objects = malloc((object_count ? object_count : 1) * sizeof(bvh_aabb_t));
+        if (!bvh->nodes || !bvh->indices || !bvh->objects)
+        {
+            bvh_free(bvh);
+            return 0;
+        }
+        bvh->object_count = object_count;
+    }
+
+    if (objects != bvh->objects)
+    {
+        memcpy(bvh->objects, objects, object_count * sizeof(bvh_aabb_t));
+    }
+
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        bvh->indices[i] = i;
+    }
+
+    bvh->node_count = 1;
+    bvh->nodes[0] = (bvh_node_t){.first = 0, .count = object_count};
+    leaf_bounds(bvh, &bvh->nodes[0]);
+    if (object_count > 0)
+    {
+        subdivide(bvh, 0, 0);
+    }
+
+    bvh->build_cost = bvh->cost = bvh_sah_cost(bvh);
+    return 1;
+}
+
+void bvh_free(bvh_t *bvh)
+{
+    free(bvh->nodes);
+    free(bvh->indices);
+    free(bvh->objects);
+    memset(bvh, 0, sizeof(*bvh));
+}
+
+void bvh_refit(bvh_t *bvh, const bvh_aabb_t *objects)
+{
+    if (objects != bvh->objects)
+    {
+        memcpy(bvh->objects, objects, bvh->object_count * sizeof(bvh_aabb_t));
+    }
+
+    // children are always allocated after their parent, so a reverse walk is bottom-up
+    for (uint32_t i = bvh->node_count; i-- > 0;)
+    {
+        bvh_node_t *node = &bvh->nodes[i];
+        if (node->count > 0 || bvh->object_count == 0)
+        {
+            leaf_bounds(bvh, node);
+        }
+        else
+        {
+            const bvh_node_t *left = &bvh->nodes[node->first];
+            const bvh_node_t *right = &bvh->nodes[node->first + 1];
+            memcpy(node->min, left->min, sizeof(node->min));
+            memcpy(node->max, left->max, sizeof(node->max));
+            aabb_grow(node->min, node->max, right->min, right->max);
+        }
+    }
+
+    bvh->cost = bvh_sah_cost(bvh);
+}
+
+int bvh_update(bvh_t *bvh, const bvh_aabb_t *objects)
+{
+    bvh_refit(bvh, objects);
+    if (bvh->cost <= bvh->build_cost * BVH_REBUILD_RATIO)
+    {
+        return 0;
+    }
+
+    bvh->rebuilds++;
+    bvh_build(bvh, bvh->objects, bvh->object_count);
+    return 1;
+}
+
+float bvh_sah_cost(const bvh_t *bvh)
+{
+    float root_area = aabb_area(bvh->nodes[0].min, bvh->nodes[0].max);
+    if (bvh->object_count == 0 || root_area <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    float cost = 0.0f;
+    for (uint32_t i = 0; i < bvh->node_count; i++)
+    {
+        const bvh_node_t *node = &bvh->nodes[i];
+        cost += aabb_area(node->min, node->max) * (node->count > 0 ? (float)node->count : 1.0f);
+    }
+    return cost / root_area;
+}
+
+// 0 outside, 1 intersecting, 2 fully inside
+static int frustum_test_aabb(const frustum_t *frustum, const float min[3], const float max[3])
+{
+    int inside = 2;
+    for (uint32_t p = 0; p < frustum->plane_count; p++)
+    {
+        const float *plane = frustum->planes[p];
+
+        // the corners farthest along and against the plane normal
+        float far_distance = plane[3];
+        float near_distance = plane[3];
+        for (int k = 0; k < 3; k++)
+        {
+            far_distance += plane[k] * (plane[k] > 0.0f ? max[k] : min[k]);
+            near_distance += plane[k] * (plane[k] > 0.0f ? min[k] : max[k]);
+        }
+
+        if (far_distance < 0.0f)
+        {
+            return 0;
+        }
+        if (near_distance < 0.0f)
+        {
+            inside = 1;
+        }
+    }
+    return inside;
+}
+
+// Appends every object below node without further tests
+static uint32_t collect(const bvh_t *bvh, uint32_t node_index, uint32_t *results, uint32_t count, uint32_t max_results)
+{
+    uint32_t stack[BVH_MAX_DEPTH * 2];
+    uint32_t stack_size = 0;
+    stack[stack_size++] = node_index;
+
+    while (stack_size > 0 && count < max_results)
+    {
+        const bvh_node_t *node = &bvh->nodes[stack[--stack_size]];
+        if (node->count > 0)
+        {
+            for (uint32_t i = 0; i < node->count && count < max_results; i++)
+            {
+                results[count++] = bvh->indices[node->first + i];
+            }
+        }
+        else
+        {
+            stack[stack_size++] = node->first;
+            stack[stack_size++] = node->first + 1;
+        }
+    }
+    return count;
+}
+
+uint32_t bvh_query_frustum(const bvh_t *bvh, const frustum_t *frustum, uint32_t *results, uint32_t max_results)
+{
+    if (bvh->object_count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    uint32_t stack[BVH_MAX_DEPTH * 2];
+    uint32_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0 && count < max_results)
+    {
+        uint32_t node_index = stack[--stack_size];
+        const bvh_node_t *node = &bvh->nodes[node_index];
+
+        int test = frustum_test_aabb(frustum, node->min, node->max);
+        if (test == 0)
+        {
+            continue;
+        }
+
+        if (test == 2)
+        {
+            count = collect(bvh, node_index, results, count, max_results);
+        }
+        else if (node->count > 0)
+        {
+            for (uint32_t i = 0; i < node->count && count < max_results; i++)
+            {
+                uint32_t object = bvh->indices[node->first + i];
+                if (frustum_test_aabb(frustum, bvh->objects[object].min, bvh->objects[object].max))
+                {
+                    results[count++] = object;
+                }
+            }
+        }
+        else
+        {
+            stack[stack_size++] = node->first;
+            stack[stack_size++] = node->first + 1;
+        }
+    }
+    return count;
+}
+
+static int sphere_overlaps_aabb(const float center[3], float radius, const float min[3], const float max[3])
+{
+    float distance_sq = 0.0f;
+    for (int k = 0; k < 3; k++)
+    {
+        float d = center[k] < min[k] ? min[k] - center[k] : (center[k] > max[k] ? center[k] - max[k] : 0.0f);
+        distance_sq += d * d;
+    }
+    return distance_sq <= radius * radius;
+}
+
+uint32_t bvh_query_sphere(const bvh_t *bvh, const float center[3], float radius, uint32_t *results, uint32_t max_results)
+{
+    if (bvh->object_count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    uint32_t stack[BVH_MAX_DEPTH * 2];
+    uint32_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0 && count < max_results)
+    {
+        const bvh_node_t *node = &bvh->nodes[stack[--stack_size]];
+        if (!sphere_overlaps_aabb(center, radius, node->min, node->max))
+        {
+            continue;
+        }
+
+        if (node->count > 0)
+        {
+            for (uint32_t i = 0; i < node->count && count < max_results; i++)
+            {
+                uint32_t object = bvh->indices[node->first + i];
+                if (sphere_overlaps_aabb(center, radius, bvh->objects[object].min, bvh->objects[object].max))
+                {
+                    results[count++] = object;
+                }
+            }
+        }
+        else
+        {
+            stack[stack_size++] = node->first;
+            stack[stack_size++] = node->first + 1;
+        }
+    }
+    return count;
+}
+
+// Slab test, returns the entry distance or FLT_MAX on a miss
+static float ray_aabb(const float origin[3], const float inverse_direction[3], float max_t, const float min[3], const float max[3])
+{
+    float t_enter = 0.0f;
+    float t_exit = max_t;
+    for (int k = 0; k < 3; k++)
+    {
+        float t0 = (min[k] - origin[k]) * inverse_direction[k];
+        float t1 = (max[k] - origin[k]) * inverse_direction[k];
+        t_enter = max_float(t_enter, min_float(t0, t1));
+        t_exit = min_float(t_exit, max_float(t0, t1));
+    }
+    return t_enter <= t_exit ? t_enter : FLT_MAX;
+}
+
+int bvh_raycast(const bvh_t *bvh, const float origin[3], const float direction[3], float max_t, float *hit_t)
+{
+    if (bvh->object_count == 0)
+    {
+        return -1;
+    }
+
+    // divisions by zero give infinities, which the slab test handles
+    float inverse_direction[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+
+    int hit = -1;
+    float closest = max_t;
+    uint32_t stack[BVH_MAX_DEPTH * 2];
+    uint32_t stack_size = 0;
+    if (ray_aabb(origin, inverse_direction, closest, bvh->nodes[0].min, bvh->nodes[0].max) != FLT_MAX)
+    {
+        stack[stack_size++] = 0;
+    }
+
+    while (stack_size > 0)
+    {
+        const bvh_node_t *node = &bvh->nodes[stack[--stack_size]];
+        if (node->count > 0)
+        {
+            for (uint32_t i = 0; i < node->count; i++)
+            {
+                uint32_t object = bvh->indices[node->first + i];
+                float t = ray_aabb(origin, inverse_direction, closest, bvh->objects[object].min, bvh->objects[object].max);
+                if (t != FLT_MAX && (hit < 0 || t < closest))
+                {
+                    closest = t;
+                    hit = (int)object;
+                }
+            }
+            continue;
+        }
+
+        // visit the nearer child first, the farther one is pushed below it
+        float t_left = ray_aabb(origin, inverse_direction, closest, bvh->nodes[node->first].min, bvh->nodes[node->first].max);
+        float t_right = ray_aabb(origin, inverse_direction, closest, bvh->nodes[node->first + 1].min, bvh->nodes[node->first + 1].max);
+        uint32_t near_child = t_left <= t_right ? node->first : node->first + 1;
+        uint32_t far_child = t_left <= t_right ? node->first + 1 : node->first;
+        float t_far = t_left <= t_right ? t_right : t_left;
+        float t_near = t_left <= t_right ? t_left : t_right;
+
+        if (t_far != FLT_MAX)
+        {
+            stack[stack_size++] = far_child;
+        }
+        if (t_near != FLT_MAX)
+        {
+            stack[stack_size++] = near_child;
+        }
+    }
+
+    if (hit >= 0 && hit_t)
+    {
+        *hit_t = closest;
+    }
+    return hit;
+}
@@ -0,0 +1,64 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <stdint.h>
+
+#include "culling.h"
+
+// Objects per leaf the builder always splits above
+#define BVH_MAX_LEAF_SIZE 4
+// A refit tree is rebuilt once its SAH cost grows past this factor of the cost after its build
+#define BVH_REBUILD_RATIO 1.5f
+
+typedef struct bvh_aabb_t
+{
+    float min[3];
+    float max[3];
+} bvh_aabb_t;
+
+// 32 bytes, two nodes per cache line. Internal nodes have count 0 and their children at
+// first and first + 1, leaves hold count objects from indices[first].
+typedef struct bvh_node_t
+{
+    float min[3];
+    uint32_t first;
+    float max[3];
+    uint32_t count;
+} bvh_node_t;
+
+// Bounding volume hierarchy over object AABBs, built top-down with a binned surface area
+// heuristic. Moving objects are handled by refitting the bounds in place, and the tree is
+// rebuilt when refitting has degraded it too far.
+typedef struct bvh_t
+{
+    bvh_node_t *nodes;
+    uint32_t node_count;
+    uint32_t *indices;
+    bvh_aabb_t *objects;
+    uint32_t object_count;
+
+    float build_cost; // SAH cost right after the last build
+    float cost;       // SAH cost after the last refit
+    uint32_t rebuilds;
+} bvh_t;
+
+// The bvh must be zeroed before its first build, later builds reuse its memory
+int bvh_build(bvh_t *bvh, const bvh_aabb_t *objects, uint32_t object_count);
+void bvh_free(bvh_t *bvh);
+
+// Updates the bounds of every object keeping the tree topology
+void bvh_refit(bvh_t *bvh, const bvh_aabb_t *objects);
+// Refits, then rebuilds if the tree quality fell below BVH_REBUILD_RATIO, returns 1 if it was rebuilt
+int bvh_update(bvh_t *bvh, const bvh_aabb_t *objects);
+
+// Expected cost of a query relative to testing the root, lower is better
+float bvh_sah_cost(const bvh_t *bvh);
+
+// Each query writes up to max_results object indices and returns how many it wrote
+uint32_t bvh_query_frustum(const bvh_t *bvh, const frustum_t *frustum, uint32_t *results, uint32_t max_results);
+uint32_t bvh_query_sphere(const bvh_t *bvh, const float center[3], float radius, uint32_t *results, uint32_t max_results);
+// Returns the object whose AABB the ray enters first within max_t, or -1. direction need not be normalized,
+// t is in units of its length.
+int bvh_raycast(const bvh_t *bvh, const float origin[3], const float direction[3], float max_t, float *hit_t);
+
+#endif
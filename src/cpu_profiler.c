@@ -0,0 +1,208 @@
+#include "cpu_profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL2/SDL.h"
+#include "clock.h"
+
+typedef struct cpu_event_t
+{
+    const char *name;
+    uint64_t ns;
+    int32_t index;
+    char phase; // Chrome trace phase: 'B'egin, 'E'nd or 'i'nstant
+} cpu_event_t;
+
+typedef struct cpu_thread_buffer_t
+{
+    const char *name;
+    uint32_t thread_id;
+    SDL_atomic_t written; // events written so far, the ring holds the newest CPU_PROFILER_EVENTS
+    cpu_event_t events[CPU_PROFILER_EVENTS];
+} cpu_thread_buffer_t;
+
+static uint64_t start_ns;
+static cpu_thread_buffer_t *threads[CPU_PROFILER_MAX_THREADS];
+static SDL_atomic_t thread_count;
+
+// the calling thread's buffer, allocated on its first event
+static _Thread_local cpu_thread_buffer_t *thread_buffer;
+static _Thread_local int thread_disabled;
+
+void cpu_profiler_init(void)
+{
+    start_ns = clock_ns();
+}
+
+void cpu_profiler_free(void)
+{
+    int count = SDL_AtomicGet(&thread_count);
+    for (int i = 0; i < count && i < CPU_PROFILER_MAX_THREADS; i++)
+    {
+        free(threads[i]);
+        threads[i] = NULL;
+    }
+    SDL_AtomicSet(&thread_count, 0);
+    thread_buffer = NULL;
+}
+
+static cpu_thread_buffer_t *get_thread_buffer(void)
+{
+    if (thread_buffer || thread_disabled)
+    {
+        return thread_buffer;
+    }
+
+    int slot = SDL_AtomicAdd(&thread_count, 1);
+    if (slot >= CPU_PROFILER_MAX_THREADS)
+    {
+        thread_disabled = 1;
+        return NULL;
+    }
+
+    cpu_thread_buffer_t *buffer = calloc(1, sizeof(cpu_thread_buffer_t));
+    if (!buffer)
+    {
+        thread_disabled = 1;
+        return NULL;
+    }
+
+    buffer->thread_id = SDL_ThreadID();
+    buffer->name = slot == 0 ? "main" : "worker";
+    SDL_AtomicSetPtr((void **)&threads[slot], buffer);
+    thread_buffer = buffer;
+    return buffer;
+}
+
+static void record(const char *name, int index, char phase)
+{
+    cpu_thread_buffer_t *buffer = get_thread_buffer();
+    if (!buffer)
+    {
+        return;
+    }
+
+    // only this thread writes, the counter publishes the event to the trace writer
+    int written = SDL_AtomicGet(&buffer->written);
+    cpu_event_t *event = &buffer->events[(uint32_t)written % CPU_PROFILER_EVENTS];
+    event->name = name;
+    event->ns = clock_ns();
+    event->index = index;
+    event->phase = phase;
+    SDL_AtomicSet(&buffer->written, written + 1);
+}
+
+void cpu_profiler_thread_name(const char *name)
+{
+    cpu_thread_buffer_t *buffer = get_thread_buffer();
+    if (buffer)
+    {
+        buffer->name = name;
+    }
+}
+
+void cpu_zone_begin(const char *name, int index)
+{
+    record(name, index, 'B');
+}
+
+void cpu_zone_end(void)
+{
+    record(NULL, -1, 'E');
+}
+
+void cpu_profiler_instant(const char *name, int index)
+{
+    record(name, index, 'i');
+}
+
+static void write_event(FILE *file, const cpu_thread_buffer_t *buffer, const cpu_event_t *event, int *first)
+{
+    double ts_us = ((int64_t)event->ns - (int64_t)start_ns) / 1e3;
+    fprintf(file, "%s\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u", *first ? "" : ",", event->phase, ts_us, buffer->thread_id);
+    if (event->phase != 'E')
+    {
+        fprintf(file, ",\"name\":\"%s\"", event->name);
+    }
+    if (event->phase == 'i')
+    {
+        fprintf(file, ",\"s\":\"t\"");
+    }
+    if (event->index >= 0)
+    {
+        fprintf(file, ",\"args\":{\"index\":%d}", event->index);
+    }
+    fprintf(file, "}");
+    *first = 0;
+}
+
+int cpu_profiler_write_trace(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        printf("Failed to open trace file %s\n", path);
+        return 0;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    int first = 1;
+    uint64_t event_count = 0;
+
+    int count = SDL_AtomicGet(&thread_count);
+    for (int t = 0; t < count && t < CPU_PROFILER_MAX_THREADS; t++)
+    {
+        cpu_thread_buffer_t *buffer = SDL_AtomicGetPtr((void **)&threads[t]);
+        if (!buffer)
+        {
+            continue;
+        }
+
+        fprintf(file, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", buffer->thread_id, buffer->name);
+        first = 0;
+
+        // the thread keeps recording while we read, so stay clear of the part it overwrites next
+        uint32_t written = (uint32_t)SDL_AtomicGet(&buffer->written);
+        uint32_t margin = CPU_PROFILER_EVENTS / 16;
+        uint32_t begin = written > CPU_PROFILER_EVENTS - margin ? written - (CPU_PROFILER_EVENTS - margin) : 0;
+
+        // ends whose begin was already overwritten would unbalance the trace
+        int depth = 0;
+        for (uint32_t i = begin; i < written; i++)
+        {
+            const cpu_event_t *event = &buffer->events[i % CPU_PROFILER_EVENTS];
+            if (event->phase == 'E')
+            {
+                if (depth == 0)
+                {
+                    continue;
+                }
+                depth--;
+            }
+            else if (event->phase == 'B')
+            {
+                depth++;
+            }
+
+            write_event(file, buffer, event, &first);
+            event_count++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    int ok = !ferror(file);
+    fclose(file);
+
+    if (ok)
+    {
+        printf("Wrote %llu CPU profiler events to %s\n", (unsigned long long)event_count, path);
+    }
+    else
+    {
+        printf("Failed to write trace file %s\n", path);
+    }
+    return ok;
+}
@@ -0,0 +1,34 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <stdint.h>
+
+// Events kept per thread, a ring holding the newest ones, about 30 s of the main loop
+#define CPU_PROFILER_EVENTS 65536
+// Threads that may record
+#define CPU_PROFILER_MAX_THREADS 8
+
+// Named CPU zones recorded into a buffer per thread and written out as Chrome trace JSON,
+// which chrome://tracing and ui.perfetto.dev open. Recording a zone is two clock reads and
+// two stores to the calling thread's own buffer, no locks, so it can stay on in every build.
+// Zone and thread names must outlive the profiler, string literals in practice.
+
+// Call once before any thread records
+void cpu_profiler_init(void);
+// Call once every recording thread has finished
+void cpu_profiler_free(void);
+
+// Names the calling thread in the trace
+void cpu_profiler_thread_name(const char *name);
+
+// Zones nest and must end on the thread that began them. index tells apart zones with the
+// same name such as views, pass -1 for none.
+void cpu_zone_begin(const char *name, int index);
+void cpu_zone_end(void);
+// A point in time, such as a frame that went over budget
+void cpu_profiler_instant(const char *name, int index);
+
+// Writes the events still held by every thread, returns 0 if the file could not be written
+int cpu_profiler_write_trace(const char *path);
+
+#endif
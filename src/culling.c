@@ -0,0 +1,293 @@
+#include "culling.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULL_SSE 1
+#include <xmmintrin.h>
+#else
+#define CULL_SSE 0
+#endif
+
+int cull_init(cull_t *cull, uint32_t capacity)
+{
+    memset(cull, 0, sizeof(*cull));
+
+    cull->center_x = malloc(capacity * sizeof(float));
+    cull->center_y = malloc(capacity * sizeof(float));
+    cull->center_z = malloc(capacity * sizeof(float));
+    cull->radius = malloc(capacity * sizeof(float));
+    cull->view_masks = malloc(capacity);
+    if (!cull->center_x || !cull->center_y || !cull->center_z || !cull->radius || !cull->view_masks)
+    {
+        cull_free(cull);
+        return 0;
+    }
+
+    cull->capacity = capacity;
+    return 1;
+}
+
+void cull_free(cull_t *cull)
+{
+    free(cull->center_x);
+    free(cull->center_y);
+    free(cull->center_z);
+    free(cull->radius);
+    free(cull->view_masks);
+    memset(cull, 0, sizeof(*cull));
+}
+
+static void quat_rotate(float out[3], const float q[4], const float v[3])
+{
+    // v + 2 * cross(q.xyz, cross(q.xyz, v) + w * v)
+    float t[3] = {
+        q[1] * v[2] - q[2] * v[1] + q[3] * v[0],
+        q[2] * v[0] - q[0] * v[2] + q[3] * v[1],
+        q[0] * v[1] - q[1] * v[0] + q[3] * v[2],
+    };
+    float r[3] = {
+        v[0] + 2.0f * (q[1] * t[2] - q[2] * t[1]),
+        v[1] + 2.0f * (q[2] * t[0] - q[0] * t[2]),
+        v[2] + 2.0f * (q[0] * t[1] - q[1] * t[0]),
+    };
+    memcpy(out, r, sizeof(r));
+}
+
+static float dot3(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Adds the plane with the local space normal rotated by orientation, passing through
+// the point at distance offset along the normal from the origin
+static void add_plane(frustum_t *frustum, const float orientation[4], const float local_normal[3], float offset)
+{
+    float length = sqrtf(dot3(local_normal, local_normal));
+    float normal[3] = {local_normal[0] / length, local_normal[1] / length, local_normal[2] / length};
+
+    float *plane = frustum->planes[frustum->plane_count++];
+    quat_rotate(plane, orientation, normal);
+    plane[3] = -offset;
+}
+
+// Side planes through the origin of a fov given as tangents, in the space of orientation
+static void add_side_planes(frustum_t *frustum, const float orientation[4], float left, float right, float down, float up)
+{
+    // inward normals, the view looks down -z
+    add_plane(frustum, orientation, (float[3]){1.0f, 0.0f, left}, 0.0f);
+    add_plane(frustum, orientation, (float[3]){-1.0f, 0.0f, -right}, 0.0f);
+    add_plane(frustum, orientation, (float[3]){0.0f, 1.0f, down}, 0.0f);
+    add_plane(frustum, orientation, (float[3]){0.0f, -1.0f, -up}, 0.0f);
+}
+
+void frustum_from_view(frustum_t *frustum, const XrPosef *pose, const XrFovf *fov, float near_z, float far_z)
+{
+    frustum->plane_count = 0;
+
+    const float *orientation = (const float *)&pose->orientation;
+    const float *position = (const float *)&pose->position;
+
+    // first the planes through the origin, then moved to the eye position
+    add_side_planes(frustum, orientation, tanf(fov->angleLeft), tanf(fov->angleRight), tanf(fov->angleDown), tanf(fov->angleUp));
+    add_plane(frustum, orientation, (float[3]){0.0f, 0.0f, -1.0f}, near_z);
+    if (isfinite(far_z))
+    {
+        add_plane(frustum, orientation, (float[3]){0.0f, 0.0f, 1.0f}, -far_z);
+    }
+
+    for (uint32_t i = 0; i < frustum->plane_count; i++)
+    {
+        frustum->planes[i][3] -= dot3(frustum->planes[i], position);
+    }
+}
+
+// Builds a frustum in the average view orientation whose angles cover every corner ray of
+// every view, with each side plane moved back to the outermost eye. Every view frustum lies
+// inside it, so it is exact for parallel eyes and still conservative for canted displays.
+static void frustum_combine(frustum_t *frustum, const XrView *views, uint32_t view_count)
+{
+    frustum->plane_count = 0;
+
+    // average orientation, quaternions flipped into the same hemisphere as the first
+    float orientation[4] = {0, 0, 0, 0};
+    for (uint32_t v = 0; v < view_count; v++)
+    {
+        const float *q = (const float *)&views[v].pose.orientation;
+        const float *q0 = (const float *)&views[0].pose.orientation;
+        float sign = q[0] * q0[0] + q[1] * q0[1] + q[2] * q0[2] + q[3] * q0[3] < 0.0f ? -1.0f : 1.0f;
+        for (int k = 0; k < 4; k++)
+        {
+            orientation[k] += sign * q[k];
+        }
+    }
+    float length = sqrtf(orientation[0] * orientation[0] + orientation[1] * orientation[1] + orientation[2] * orientation[2] + orientation[3] * orientation[3]);
+    for (int k = 0; k < 4; k++)
+    {
+        orientation[k] /= length;
+    }
+    float inverse[4] = {-orientation[0], -orientation[1], -orientation[2], orientation[3]};
+
+    float left = 0.0f, right = 0.0f, down = 0.0f, up = 0.0f;
+    for (uint32_t v = 0; v < view_count; v++)
+    {
+        const XrFovf *fov = &views[v].fov;
+        float x[2] = {tanf(fov->angleLeft), tanf(fov->angleRight)};
+        float y[2] = {tanf(fov->angleDown), tanf(fov->angleUp)};
+        for (int corner = 0; corner < 4; corner++)
+        {
+            float ray[3] = {x[corner & 1], y[corner >> 1], -1.0f};
+            quat_rotate(ray, (const float *)&views[v].pose.orientation, ray);
+            quat_rotate(ray, inverse, ray);
+            if (ray[2] > -1e-3f)
+            {
+                // a ray at or behind 90 degrees from the average, no useful combined frustum
+                return;
+            }
+
+            float tan_x = ray[0] / -ray[2];
+            float tan_y = ray[1] / -ray[2];
+            if ((v == 0 && corner == 0) || tan_x < left)
+                left = tan_x;
+            if ((v == 0 && corner == 0) || tan_x > right)
+                right = tan_x;
+            if ((v == 0 && corner == 0) || tan_y < down)
+                down = tan_y;
+            if ((v == 0 && corner == 0) || tan_y > up)
+                up = tan_y;
+        }
+    }
+
+    add_side_planes(frustum, orientation, left, right, down, up);
+    // through the rearmost eye, the near and far distances are left to the per-view test
+    add_plane(frustum, orientation, (float[3]){0.0f, 0.0f, -1.0f}, 0.0f);
+
+    for (uint32_t i = 0; i < frustum->plane_count; i++)
+    {
+        float min_distance = INFINITY;
+        for (uint32_t v = 0; v < view_count; v++)
+        {
+            float distance = dot3(frustum->planes[i], (const float *)&views[v].pose.position);
+            if (distance < min_distance)
+            {
+                min_distance = distance;
+            }
+        }
+        frustum->planes[i][3] = -min_distance;
+    }
+}
+
+void cull_begin(cull_t *cull, const XrView *views, uint32_t view_count, float near_z, float far_z)
+{
+    cull->count = 0;
+    cull->view_count = view_count < CULL_MAX_VIEWS ? view_count : CULL_MAX_VIEWS;
+
+    for (uint32_t v = 0; v < cull->view_count; v++)
+    {
+        frustum_from_view(&cull->views[v], &views[v].pose, &views[v].fov, near_z, far_z);
+    }
+    frustum_combine(&cull->combined, views, cull->view_count);
+}
+
+int cull_add_sphere(cull_t *cull, const float center[3], float radius)
+{
+    if (cull->count == cull->capacity)
+    {
+        return -1;
+    }
+
+    uint32_t i = cull->count++;
+    cull->center_x[i] = center[0];
+    cull->center_y[i] = center[1];
+    cull->center_z[i] = center[2];
+    cull->radius[i] = radius;
+    return (int)i;
+}
+
+static int sphere_inside(const frustum_t *frustum, const cull_t *cull, uint32_t i)
+{
+    for (uint32_t p = 0; p < frustum->plane_count; p++)
+    {
+        const float *plane = frustum->planes[p];
+        float distance = plane[0] * cull->center_x[i] + plane[1] * cull->center_y[i] + plane[2] * cull->center_z[i] + plane[3];
+        if (distance < -cull->radius[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void cull_run(cull_t *cull)
+{
+    const frustum_t *combined = &cull->combined;
+    uint8_t all_views = (uint8_t)((1u << cull->view_count) - 1);
+    uint32_t i = 0;
+
+#if CULL_SSE
+    for (; i + 4 <= cull->count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&cull->center_x[i]);
+        __m128 y = _mm_loadu_ps(&cull->center_y[i]);
+        __m128 z = _mm_loadu_ps(&cull->center_z[i]);
+        __m128 neg_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&cull->radius[i]));
+        __m128 inside = _mm_cmpeq_ps(x, x);
+
+        for (uint32_t p = 0; p < combined->plane_count; p++)
+        {
+            const float *plane = combined->planes[p];
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_mul_ps(y, _mm_set1_ps(plane[1]))),
+                                         _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, neg_radius));
+        }
+
+        int bits = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; k++)
+        {
+            cull->view_masks[i + k] = (bits >> k) & 1 ? all_views : 0;
+        }
+    }
+#endif
+
+    for (; i < cull->count; i++)
+    {
+        cull->view_masks[i] = sphere_inside(combined, cull, i) ? all_views : 0;
+    }
+
+    // the few survivors of the combined test are sorted into the views they are visible in
+    uint32_t culled = 0;
+    for (i = 0; i < cull->count; i++)
+    {
+        if (cull->view_masks[i] && cull->view_count > 1)
+        {
+            for (uint32_t v = 0; v < cull->view_count; v++)
+            {
+                if (!sphere_inside(&cull->views[v], cull, i))
+                {
+                    cull->view_masks[i] &= (uint8_t)~(1u << v);
+                }
+            }
+        }
+
+        if (!cull->view_masks[i])
+        {
+            culled++;
+        }
+    }
+
+    cull->tested_last = cull->count;
+    cull->culled_last = culled;
+    cull->frames++;
+    cull->tested += cull->count;
+    cull->culled += culled;
+}
+
+void cull_print_stats(const cull_t *cull)
+{
+    printf("Culling: %llu objects tested over %llu frames, %llu culled (%.1f%%)\n",
+           (unsigned long long)cull->tested, (unsigned long long)cull->frames, (unsigned long long)cull->culled,
+           cull->tested ? 100.0 * cull->culled / cull->tested : 0.0);
+}
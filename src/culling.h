@@ -0,0 +1,56 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <stdint.h>
+
+#include "openxr/openxr.h"
+
+#define CULL_MAX_VIEWS 4
+
+// Planes are (normal, distance) with inward normals, a point p is inside when
+// dot(normal, p) + distance >= 0. A far plane is left out when far_z is infinite.
+typedef struct frustum_t
+{
+    float planes[6][4];
+    uint32_t plane_count;
+} frustum_t;
+
+// Bounding spheres of one frame's objects, tested against every view at once.
+// Spheres are stored as separate x/y/z/radius arrays so four are tested per SIMD instruction.
+typedef struct cull_t
+{
+    frustum_t combined; // contains every view frustum, objects outside it are invisible in all views
+    frustum_t views[CULL_MAX_VIEWS];
+    uint32_t view_count;
+
+    uint32_t capacity;
+    uint32_t count;
+    float *center_x;
+    float *center_y;
+    float *center_z;
+    float *radius;
+    uint8_t *view_masks; // bit v is set when the object is visible in view v
+
+    // counters, last frame and totals
+    uint32_t tested_last;
+    uint32_t culled_last;
+    uint64_t frames;
+    uint64_t tested;
+    uint64_t culled;
+} cull_t;
+
+int cull_init(cull_t *cull, uint32_t capacity);
+void cull_free(cull_t *cull);
+
+void frustum_from_view(frustum_t *frustum, const XrPosef *pose, const XrFovf *fov, float near_z, float far_z);
+
+// Starts a frame, builds each view's frustum and one conservative frustum around all of them
+void cull_begin(cull_t *cull, const XrView *views, uint32_t view_count, float near_z, float far_z);
+// Adds a bounding sphere, returns its index or -1 when full
+int cull_add_sphere(cull_t *cull, const float center[3], float radius);
+// Fills view_masks: every sphere is tested against the combined frustum, the survivors against each view
+void cull_run(cull_t *cull);
+
+void cull_print_stats(const cull_t *cull);
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef _WIN32
+
+#include "egl_context.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <EGL/eglext.h>
+
+static int has_extension(const char *extensions, const char *name)
+{
+    size_t length = strlen(name);
+    for (const char *found = extensions ? strstr(extensions, name) : NULL; found; found = strstr(found + length, name))
+    {
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static EGLDisplay open_display(void)
+{
+    const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (has_extension(client_extensions, "EGL_MESA_platform_surfaceless"))
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display)
+        {
+            EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            if (display != EGL_NO_DISPLAY)
+            {
+                return display;
+            }
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+int egl_context_create(egl_context_t *egl, int min_major, int min_minor)
+{
+    memset(egl, 0, sizeof(*egl));
+    egl->surface = EGL_NO_SURFACE;
+
+    egl->display = open_display();
+    EGLint major, minor;
+    if (egl->display == EGL_NO_DISPLAY || !eglInitialize(egl->display, &major, &minor))
+    {
+        printf("Failed to initialize EGL\n");
+        return 0;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        printf("EGL does not support desktop OpenGL\n");
+        return 0;
+    }
+
+    // rendering goes to the swapchain images, the default framebuffer is never drawn to
+    int surfaceless = has_extension(eglQueryString(egl->display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE};
+    EGLint config_count = 0;
+    if (!eglChooseConfig(egl->display, config_attribs, &egl->config, 1, &config_count) || config_count == 0)
+    {
+        printf("No EGL config for desktop OpenGL\n");
+        return 0;
+    }
+
+    static const int versions[][2] = {{4, 6}, {4, 5}, {4, 4}, {4, 3}};
+    for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]) && !egl->context; i++)
+    {
+        if (versions[i][0] < min_major || (versions[i][0] == min_major && versions[i][1] < min_minor))
+        {
+            break;
+        }
+
+        EGLint context_attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, versions[i][0],
+            EGL_CONTEXT_MINOR_VERSION, versions[i][1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE};
+        egl->context = eglCreateContext(egl->display, egl->config, EGL_NO_CONTEXT, context_attribs);
+        if (egl->context == EGL_NO_CONTEXT)
+        {
+            egl->context = NULL;
+        }
+    }
+
+    if (!egl->context)
+    {
+        printf("Failed to create an OpenGL %d.%d context\n", min_major, min_minor);
+        return 0;
+    }
+
+    if (!surfaceless)
+    {
+        EGLint pbuffer_attribs[] = {EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE};
+        egl->surface = eglCreatePbufferSurface(egl->display, egl->config, pbuffer_attribs);
+        if (egl->surface == EGL_NO_SURFACE)
+        {
+            printf("Failed to create an EGL pbuffer\n");
+            return 0;
+        }
+    }
+
+    if (!eglMakeCurrent(egl->display, egl->surface, egl->surface, egl->context))
+    {
+        printf("Failed to make the EGL context current\n");
+        return 0;
+    }
+
+    printf("EGL %d.%d, %s\n", major, minor, surfaceless ? "surfaceless" : "pbuffer");
+    return 1;
+}
+
+int egl_context_make_current(egl_context_t *egl, int current)
+{
+    if (current)
+    {
+        return eglMakeCurrent(egl->display, egl->surface, egl->surface, egl->context) == EGL_TRUE;
+    }
+    return eglMakeCurrent(egl->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT) == EGL_TRUE;
+}
+
+void egl_context_destroy(egl_context_t *egl)
+{
+    if (egl->display == EGL_NO_DISPLAY || !egl->display)
+    {
+        return;
+    }
+
+    eglMakeCurrent(egl->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (egl->surface != EGL_NO_SURFACE)
+    {
+        eglDestroySurface(egl->display, egl->surface);
+    }
+    if (egl->context)
+    {
+        eglDestroyContext(egl->display, egl->context);
+    }
+    eglTerminate(egl->display);
+    memset(egl, 0, sizeof(*egl));
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef EGL_CONTEXT_H
+#define EGL_CONTEXT_H
+
+#ifndef _WIN32
+
+#include <EGL/egl.h>
+
+// An OpenGL context without a window for the Linux build. It uses the surfaceless platform
+// when EGL offers it, so it needs neither X11 nor a GPU and runs on Mesa llvmpipe, and a
+// pbuffer only when the driver cannot make a context current without a surface.
+typedef struct egl_context_t
+{
+    EGLDisplay display;
+    EGLConfig config;
+    EGLContext context;
+    EGLSurface surface; // EGL_NO_SURFACE when surfaceless
+} egl_context_t;
+
+// Creates a core context of the newest version from 4.6 down to min_major.min_minor and makes
+// it current, returns 0 on failure
+int egl_context_create(egl_context_t *egl, int min_major, int min_minor);
+void egl_context_destroy(egl_context_t *egl);
+
+// Makes the context current on the calling thread, or releases it from it so another thread can
+int egl_context_make_current(egl_context_t *egl, int current);
+
+#endif
+
+#endif
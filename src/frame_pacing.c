@@ -0,0 +1,153 @@
+#include "frame_pacing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void frame_pacing_init(frame_pacing_t *pacing)
+{
+    memset(pacing, 0, sizeof(*pacing));
+}
+
+static void add_wait(frame_pacing_stats_t *stats, uint64_t wait_ns, int should_render, uint32_t intervals)
+{
+    stats->frames++;
+    stats->skipped_renders += !should_render;
+    stats->wait_total_ns += wait_ns;
+    stats->wait_max_ns = wait_ns > stats->wait_max_ns ? wait_ns : stats->wait_max_ns;
+
+    if (intervals > 0)
+    {
+        stats->missed_frames += intervals - 1;
+        stats->interval_histogram[(intervals < FRAME_PACING_INTERVAL_BUCKETS ? intervals : FRAME_PACING_INTERVAL_BUCKETS) - 1]++;
+    }
+}
+
+void frame_pacing_wait(frame_pacing_t *pacing, uint64_t wait_ns, int64_t display_time, int64_t display_period, int should_render)
+{
+    uint32_t intervals = 0;
+    if (pacing->last_display_time != 0 && display_period > 0)
+    {
+        // rounded, the runtime's predictions jitter by a fraction of a period
+        int64_t gap = display_time - pacing->last_display_time;
+        int64_t periods = (gap + display_period / 2) / display_period;
+        intervals = periods < 1 ? 1 : (uint32_t)periods;
+    }
+
+    pacing->last_display_time = display_time;
+    pacing->period_ns = display_period;
+
+    add_wait(&pacing->total, wait_ns, should_render, intervals);
+    add_wait(&pacing->interval, wait_ns, should_render, intervals);
+}
+
+static void add_work(frame_pacing_stats_t *stats, uint64_t work_ns, int64_t period_ns)
+{
+    stats->work_total_ns += work_ns;
+
+    uint64_t bucket = work_ns / 500000;
+    stats->work_histogram[bucket < FRAME_PACING_WORK_BUCKETS ? bucket : FRAME_PACING_WORK_BUCKETS - 1]++;
+
+    if (period_ns > 0 && work_ns > (uint64_t)period_ns)
+    {
+        uint64_t overrun_ns = work_ns - (uint64_t)period_ns;
+        stats->overruns++;
+        stats->overrun_max_ns = overrun_ns > stats->overrun_max_ns ? overrun_ns : stats->overrun_max_ns;
+    }
+}
+
+int frame_pacing_end(frame_pacing_t *pacing, uint64_t work_ns)
+{
+    add_work(&pacing->total, work_ns, pacing->period_ns);
+    add_work(&pacing->interval, work_ns, pacing->period_ns);
+    return pacing->period_ns > 0 && work_ns > (uint64_t)pacing->period_ns;
+}
+
+void frame_pacing_restart(frame_pacing_t *pacing)
+{
+    pacing->last_display_time = 0;
+}
+
+// Upper edge of the bucket holding the given share of frames
+static double work_percentile_ms(const frame_pacing_stats_t *stats, double share)
+{
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < FRAME_PACING_WORK_BUCKETS; i++)
+    {
+        count += stats->work_histogram[i];
+    }
+
+    uint64_t target = (uint64_t)(count * share);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < FRAME_PACING_WORK_BUCKETS; i++)
+    {
+        seen += stats->work_histogram[i];
+        if (seen > target)
+        {
+            return (i + 1) * 0.5;
+        }
+    }
+    return FRAME_PACING_WORK_BUCKETS * 0.5;
+}
+
+static void print_stats(const frame_pacing_stats_t *stats, int64_t period_ns, const char *label)
+{
+    if (stats->frames == 0)
+    {
+        return;
+    }
+
+    uint64_t displayed = stats->frames + stats->missed_frames;
+    printf("Frame pacing, %s: %llu frames at %.2f Hz, %llu missed (%.2f%%), %llu not rendered, %llu over budget\n",
+           label, (unsigned long long)stats->frames, period_ns > 0 ? 1e9 / period_ns : 0.0,
+           (unsigned long long)stats->missed_frames, displayed ? 100.0 * stats->missed_frames / displayed : 0.0,
+           (unsigned long long)stats->skipped_renders, (unsigned long long)stats->overruns);
+    printf("\twait avg %.3f ms max %.3f ms, work avg %.3f ms p50 <%.1f ms p99 <%.1f ms, worst overrun %.3f ms\n",
+           stats->wait_total_ns / 1e6 / stats->frames, stats->wait_max_ns / 1e6,
+           stats->work_total_ns / 1e6 / stats->frames, work_percentile_ms(stats, 0.5), work_percentile_ms(stats, 0.99),
+           stats->overrun_max_ns / 1e6);
+
+    printf("\tdisplay intervals:");
+    for (uint32_t i = 0; i < FRAME_PACING_INTERVAL_BUCKETS; i++)
+    {
+        printf(" %u%s: %llu", i + 1, i + 1 == FRAME_PACING_INTERVAL_BUCKETS ? "+" : "", (unsigned long long)stats->interval_histogram[i]);
+    }
+    printf("\n");
+}
+
+void frame_pacing_report(frame_pacing_t *pacing, uint64_t now_ns)
+{
+    if (pacing->report_ns == 0)
+    {
+        pacing->report_ns = now_ns + FRAME_PACING_REPORT_SECONDS * 1000000000ull;
+        return;
+    }
+
+    if (now_ns < pacing->report_ns)
+    {
+        return;
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "last %d s", FRAME_PACING_REPORT_SECONDS);
+    print_stats(&pacing->interval, pacing->period_ns, label);
+    memset(&pacing->interval, 0, sizeof(pacing->interval));
+    pacing->report_ns = now_ns + FRAME_PACING_REPORT_SECONDS * 1000000000ull;
+}
+
+void frame_pacing_print_stats(const frame_pacing_t *pacing)
+{
+    print_stats(&pacing->total, pacing->period_ns, "session");
+
+    // the whole session's CPU frame work, 0.5 ms buckets
+    const frame_pacing_stats_t *stats = &pacing->total;
+    printf("\twork histogram:");
+    for (uint32_t i = 0; i < FRAME_PACING_WORK_BUCKETS; i++)
+    {
+        if (stats->work_histogram[i])
+        {
+            printf(" %s%.1f: %llu", i + 1 == FRAME_PACING_WORK_BUCKETS ? ">=" : "<", i + 1 == FRAME_PACING_WORK_BUCKETS ? i * 0.5 : (i + 1) * 0.5,
+                   (unsigned long long)stats->work_histogram[i]);
+        }
+    }
+    printf("\n");
+}
@@ -0,0 +1,56 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <stdint.h>
+
+// Seconds between periodic reports
+#define FRAME_PACING_REPORT_SECONDS 10
+// 0.5 ms buckets of the CPU frame work histogram, the last one holds everything longer
+#define FRAME_PACING_WORK_BUCKETS 64
+// Display intervals of 1, 2, 3 and 4 or more periods
+#define FRAME_PACING_INTERVAL_BUCKETS 4
+
+typedef struct frame_pacing_stats_t
+{
+    uint64_t frames;
+    uint64_t skipped_renders; // shouldRender was false
+    uint64_t missed_frames;   // display periods passed without a new frame
+    uint64_t overruns;        // CPU work longer than the display period
+
+    uint64_t wait_total_ns;
+    uint64_t wait_max_ns;
+    uint64_t work_total_ns;
+    uint64_t overrun_max_ns;
+
+    uint64_t work_histogram[FRAME_PACING_WORK_BUCKETS];
+    uint64_t interval_histogram[FRAME_PACING_INTERVAL_BUCKETS];
+} frame_pacing_stats_t;
+
+// Frame pacing telemetry from what xrWaitFrame reports. A frame is missed when the predicted
+// display times of successive frames are more than one display period apart, which is the
+// runtime showing an old frame again whatever the cause.
+typedef struct frame_pacing_t
+{
+    frame_pacing_stats_t total;
+    frame_pacing_stats_t interval; // since the last periodic report
+
+    int64_t last_display_time; // XrTime, 0 before the first frame
+    int64_t period_ns;
+    uint64_t report_ns; // CPU clock of the next periodic report
+} frame_pacing_t;
+
+void frame_pacing_init(frame_pacing_t *pacing);
+
+// After xrWaitFrame returns, with the time it blocked and the frame state it returned
+void frame_pacing_wait(frame_pacing_t *pacing, uint64_t wait_ns, int64_t display_time, int64_t display_period, int should_render);
+// After xrEndFrame, with the CPU time since xrWaitFrame returned. Returns 1 if it overran the period.
+int frame_pacing_end(frame_pacing_t *pacing, uint64_t work_ns);
+
+// The session stopped, the next frame starts a new sequence rather than missing the ones between
+void frame_pacing_restart(frame_pacing_t *pacing);
+
+// Prints and resets the interval statistics every FRAME_PACING_REPORT_SECONDS
+void frame_pacing_report(frame_pacing_t *pacing, uint64_t now_ns);
+void frame_pacing_print_stats(const frame_pacing_t *pacing);
+
+#endif
@@ -0,0 +1,85 @@
+#include "frame_queue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+
+int frame_queue_init(frame_queue_t *queue)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->mutex = SDL_CreateMutex();
+    queue->changed = SDL_CreateCond();
+    if (!queue->mutex || !queue->changed)
+    {
+        printf("Failed to create frame queue: %s\n", SDL_GetError());
+        frame_queue_free(queue);
+        return 0;
+    }
+    return 1;
+}
+
+void frame_queue_free(frame_queue_t *queue)
+{
+    if (queue->changed)
+    {
+        SDL_DestroyCond(queue->changed);
+    }
+    if (queue->mutex)
+    {
+        SDL_DestroyMutex(queue->mutex);
+    }
+    memset(queue, 0, sizeof(*queue));
+}
+
+void frame_queue_push(frame_queue_t *queue, void *item)
+{
+    SDL_LockMutex(queue->mutex);
+    if (queue->count == FRAME_QUEUE_CAPACITY)
+    {
+        uint64_t wait_start = clock_ns();
+        while (queue->count == FRAME_QUEUE_CAPACITY)
+        {
+            SDL_CondWait(queue->changed, queue->mutex);
+        }
+        queue->push_wait_ns += clock_ns() - wait_start;
+    }
+
+    queue->items[(queue->first + queue->count) % FRAME_QUEUE_CAPACITY] = item;
+    queue->count++;
+    SDL_CondBroadcast(queue->changed);
+    SDL_UnlockMutex(queue->mutex);
+}
+
+void *frame_queue_pop(frame_queue_t *queue)
+{
+    SDL_LockMutex(queue->mutex);
+    if (queue->count == 0 && !queue->closed)
+    {
+        uint64_t wait_start = clock_ns();
+        while (queue->count == 0 && !queue->closed)
+        {
+            SDL_CondWait(queue->changed, queue->mutex);
+        }
+        queue->pop_wait_ns += clock_ns() - wait_start;
+    }
+
+    void *item = NULL;
+    if (queue->count > 0)
+    {
+        item = queue->items[queue->first];
+        queue->first = (queue->first + 1) % FRAME_QUEUE_CAPACITY;
+        queue->count--;
+        SDL_CondBroadcast(queue->changed);
+    }
+    SDL_UnlockMutex(queue->mutex);
+    return item;
+}
+
+void frame_queue_close(frame_queue_t *queue)
+{
+    SDL_LockMutex(queue->mutex);
+    queue->closed = 1;
+    SDL_CondBroadcast(queue->changed);
+    SDL_UnlockMutex(queue->mutex);
+}
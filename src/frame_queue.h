@@ -0,0 +1,37 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <stdint.h>
+
+#include "SDL2/SDL.h"
+
+#define FRAME_QUEUE_CAPACITY 4
+
+// Bounded blocking FIFO of pointers between two threads. Frame packets go from the simulation
+// thread to the render thread through one, and come back empty through another, so the packets
+// in flight, and with them the latency the pipeline adds, are fixed.
+typedef struct frame_queue_t
+{
+    SDL_mutex *mutex;
+    SDL_cond *changed;
+    void *items[FRAME_QUEUE_CAPACITY];
+    uint32_t first;
+    uint32_t count;
+    int closed;
+
+    // time spent blocked, by the side that pushes and the side that pops
+    uint64_t push_wait_ns;
+    uint64_t pop_wait_ns;
+} frame_queue_t;
+
+int frame_queue_init(frame_queue_t *queue);
+void frame_queue_free(frame_queue_t *queue);
+
+// Blocks while the queue is full
+void frame_queue_push(frame_queue_t *queue, void *item);
+// Blocks while the queue is empty, returns NULL once it is closed and drained
+void *frame_queue_pop(frame_queue_t *queue);
+// Wakes the popping side for good, items already queued are still handed out
+void frame_queue_close(frame_queue_t *queue);
+
+#endif
@@ -0,0 +1,879 @@
+#include "gltf.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+#include "cpu_profiler.h"
+#include "json.h"
+#include "mat4_simd.h"
+#include "mathc.h"
+
+#define GLB_MAGIC 0x46546c67      // "glTF"
+#define GLB_CHUNK_JSON 0x4e4f534a // "JSON"
+#define GLB_CHUNK_BIN 0x004e4942  // "BIN\0"
+
+#define GLTF_MAX_PATH 1024
+#define GLTF_MAX_NODE_DEPTH 64
+
+typedef struct gltf_buffer_t
+{
+    uint8_t *data;
+    size_t size;
+    int owned; // the GLB binary chunk points into the file data instead
+} gltf_buffer_t;
+
+typedef struct gltf_t
+{
+    const char *path;
+    uint8_t *file;
+    size_t file_size;
+    json_t json;
+    gltf_buffer_t *buffers;
+    uint32_t buffer_count;
+} gltf_t;
+
+typedef struct gltf_accessor_t
+{
+    const uint8_t *data;
+    uint32_t count;
+    uint32_t components;
+    uint32_t component_type;
+    uint32_t component_size;
+    uint32_t stride;
+    int normalized;
+} gltf_accessor_t;
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = length > 0 ? malloc((size_t)length) : NULL;
+    if (data && fread(data, 1, (size_t)length, f) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(f);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+static int base64_value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+' || c == '-')
+        return 62;
+    if (c == '/' || c == '_')
+        return 63;
+    return -1;
+}
+
+static uint8_t *base64_decode(const char *text, size_t length, size_t *size)
+{
+    uint8_t *data = malloc(length / 4 * 3 + 3);
+    if (!data)
+    {
+        return NULL;
+    }
+
+    size_t out = 0;
+    uint32_t bits = 0;
+    int bit_count = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        int value = base64_value(text[i]);
+        if (value < 0)
+        {
+            // padding ends the data
+            break;
+        }
+
+        bits = (bits << 6) | (uint32_t)value;
+        bit_count += 6;
+        if (bit_count >= 8)
+        {
+            bit_count -= 8;
+            data[out++] = (uint8_t)(bits >> bit_count);
+        }
+    }
+
+    *size = out;
+    return data;
+}
+
+// glTF counts, sizes, offsets and indices are non-negative integers. Anything else, NaN or a
+// value past the type included, is rejected before the cast, where it would be undefined.
+static int to_uint32(double number, uint32_t *value)
+{
+    if (!(number >= 0.0 && number <= (double)UINT32_MAX && number == floor(number)))
+    {
+        return 0;
+    }
+    *value = (uint32_t)number;
+    return 1;
+}
+
+// The integer at key, or fallback if there is no key. Returns 0 if it is not one.
+static int find_uint32(const json_t *json, int object, const char *key, uint32_t fallback, uint32_t *value)
+{
+    int token = json_find(json, object, key);
+    if (token < 0)
+    {
+        *value = fallback;
+        return 1;
+    }
+    return to_uint32(json_number(json, token, -1), value);
+}
+
+// An index into another array, -1 if the token is missing or not an index
+static int token_index(const json_t *json, int token)
+{
+    uint32_t index;
+    return token >= 0 && to_uint32(json_number(json, token, -1), &index) && index <= INT_MAX ? (int)index : -1;
+}
+
+static int find_index(const json_t *json, int object, const char *key)
+{
+    return token_index(json, json_find(json, object, key));
+}
+
+static int load_buffers(gltf_t *gltf, const uint8_t *glb_bin, size_t glb_bin_size)
+{
+    const json_t *json = &gltf->json;
+    int buffers = json_find(json, 0, "buffers");
+    gltf->buffer_count = buffers >= 0 ? json->tokens[buffers].count : 0;
+    if (gltf->buffer_count == 0)
+    {
+        return 1;
+    }
+
+    gltf->buffers = calloc(gltf->buffer_count, sizeof(gltf_buffer_t));
+    if (!gltf->buffers)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < gltf->buffer_count; i++)
+    {
+        int buffer = json_at(json, buffers, i);
+        gltf_buffer_t *out = &gltf->buffers[i];
+        uint32_t byte_length;
+        if (!find_uint32(json, buffer, "byteLength", 0, &byte_length))
+        {
+            printf("%s: buffer %u has an invalid byteLength\n", gltf->path, i);
+            return 0;
+        }
+
+        int uri = json_find(json, buffer, "uri");
+        if (uri < 0)
+        {
+            // only the first buffer of a GLB may omit the uri, it is the binary chunk
+            if (i != 0 || !glb_bin)
+            {
+                printf("%s: buffer %u has no data\n", gltf->path, i);
+                return 0;
+            }
+            out->data = (uint8_t *)glb_bin;
+            out->size = glb_bin_size;
+        }
+        else
+        {
+            const json_token_t *t = &json->tokens[uri];
+            const char *text = &json->text[t->start];
+            const char *comma = memchr(text, ',', t->length);
+            if (t->length > 5 && memcmp(text, "data:", 5) == 0 && comma)
+            {
+                size_t header_length = (size_t)(comma - text) + 1;
+                out->data = base64_decode(comma + 1, t->length - header_length, &out->size);
+            }
+            else
+            {
+                // external file, relative to the glTF file
+                char uri_path[GLTF_MAX_PATH];
+                char full_path[GLTF_MAX_PATH];
+                if (!json_string(json, uri, uri_path, sizeof(uri_path)))
+                {
+                    return 0;
+                }
+
+                const char *slash = strrchr(gltf->path, '/');
+                const char *backslash = strrchr(gltf->path, '\\');
+                if (backslash > slash)
+                {
+                    slash = backslash;
+                }
+                int dir_length = slash ? (int)(slash - gltf->path) + 1 : 0;
+                int length = snprintf(full_path, sizeof(full_path), "%.*s%s", dir_length, gltf->path, uri_path);
+                if (length < 0 || length >= (int)sizeof(full_path))
+                {
+                    printf("%s: path of buffer %u is too long\n", gltf->path, i);
+                    return 0;
+                }
+
+                out->data = read_file(full_path, &out->size);
+            }
+
+            if (!out->data)
+            {
+                printf("%s: failed to load buffer %u\n", gltf->path, i);
+                return 0;
+            }
+            out->owned = 1;
+        }
+
+        if (out->size < byte_length)
+        {
+            printf("%s: buffer %u is shorter than its byteLength\n", gltf->path, i);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int gltf_open(gltf_t *gltf, const char *path)
+{
+    memset(gltf, 0, sizeof(*gltf));
+    gltf->path = path;
+
+    gltf->file = read_file(path, &gltf->file_size);
+    if (!gltf->file)
+    {
+        printf("Failed to read %s\n", path);
+        return 0;
+    }
+
+    const char *json_text = (const char *)gltf->file;
+    size_t json_length = gltf->file_size;
+    const uint8_t *bin = NULL;
+    size_t bin_size = 0;
+
+    uint32_t header[3];
+    if (gltf->file_size >= 12)
+    {
+        memcpy(header, gltf->file, sizeof(header));
+    }
+
+    if (gltf->file_size >= 20 && header[0] == GLB_MAGIC)
+    {
+        // GLB: 12 byte header, then chunks of (length, type, data)
+        size_t offset = 12;
+        json_text = NULL;
+        while (offset + 8 <= gltf->file_size && offset + 8 <= header[2])
+        {
+            uint32_t chunk[2];
+            memcpy(chunk, gltf->file + offset, sizeof(chunk));
+            if (offset + 8 + chunk[0] > gltf->file_size)
+            {
+                break;
+            }
+
+            if (chunk[1] == GLB_CHUNK_JSON && !json_text)
+            {
+                json_text = (const char *)gltf->file + offset + 8;
+                json_length = chunk[0];
+            }
+            else if (chunk[1] == GLB_CHUNK_BIN && !bin)
+            {
+                bin = gltf->file + offset + 8;
+                bin_size = chunk[0];
+            }
+            offset += 8 + ((chunk[0] + 3) & ~3u);
+        }
+
+        if (!json_text)
+        {
+            printf("%s: GLB without a JSON chunk\n", path);
+            return 0;
+        }
+    }
+
+    if (!json_parse(&gltf->json, json_text, json_length) || gltf->json.tokens[0].type != JSON_OBJECT)
+    {
+        printf("%s: invalid JSON\n", path);
+        return 0;
+    }
+
+    return load_buffers(gltf, bin, bin_size);
+}
+
+static void gltf_close(gltf_t *gltf)
+{
+    for (uint32_t i = 0; i < gltf->buffer_count; i++)
+    {
+        if (gltf->buffers[i].owned)
+        {
+            free(gltf->buffers[i].data);
+        }
+    }
+    free(gltf->buffers);
+    json_free(&gltf->json);
+    free(gltf->file);
+    memset(gltf, 0, sizeof(*gltf));
+}
+
+static uint32_t component_size(uint32_t component_type)
+{
+    switch (component_type)
+    {
+    case 5120: // BYTE
+    case 5121: // UNSIGNED_BYTE
+        return 1;
+    case 5122: // SHORT
+    case 5123: // UNSIGNED_SHORT
+        return 2;
+    case 5125: // UNSIGNED_INT
+    case 5126: // FLOAT
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static uint32_t type_components(const json_t *json, int type)
+{
+    static const struct
+    {
+        const char *name;
+        uint32_t components;
+    } types[] = {{"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4}, {"MAT2", 4}, {"MAT3", 9}, {"MAT4", 16}};
+
+    char name[16];
+    if (!json_string(json, type, name, sizeof(name)))
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        if (strcmp(name, types[i].name) == 0)
+        {
+            return types[i].components;
+        }
+    }
+    return 0;
+}
+
+static int get_accessor(const gltf_t *gltf, int index, gltf_accessor_t *out)
+{
+    const json_t *json = &gltf->json;
+    int accessor = json_at(json, json_find(json, 0, "accessors"), (uint32_t)index);
+    if (accessor < 0)
+    {
+        return 0;
+    }
+
+    // sparse accessors and accessors without a buffer view are not supported
+    int view = json_at(json, json_find(json, 0, "bufferViews"), (uint32_t)find_index(json, accessor, "bufferView"));
+    if (view < 0 || json_find(json, accessor, "sparse") >= 0)
+    {
+        return 0;
+    }
+
+    if (!find_uint32(json, accessor, "count", 0, &out->count) ||
+        !find_uint32(json, accessor, "componentType", 0, &out->component_type))
+    {
+        return 0;
+    }
+    out->components = type_components(json, json_find(json, accessor, "type"));
+    out->component_size = component_size(out->component_type);
+    out->normalized = json_find_number(json, accessor, "normalized", 0) != 0;
+    if (out->components == 0 || out->component_size == 0)
+    {
+        return 0;
+    }
+
+    uint32_t buffer, view_offset, view_length, accessor_offset;
+    uint32_t element_size = out->components * out->component_size;
+    if (!find_uint32(json, view, "buffer", UINT32_MAX, &buffer) ||
+        !find_uint32(json, view, "byteOffset", 0, &view_offset) ||
+        !find_uint32(json, view, "byteLength", 0, &view_length) ||
+        !find_uint32(json, accessor, "byteOffset", 0, &accessor_offset) ||
+        !find_uint32(json, view, "byteStride", element_size, &out->stride))
+    {
+        return 0;
+    }
+
+    // the ranges are checked by subtracting so that no sum or product can wrap around
+    if (buffer >= gltf->buffer_count || view_length > gltf->buffers[buffer].size ||
+        view_offset > gltf->buffers[buffer].size - view_length)
+    {
+        return 0;
+    }
+
+    if (out->count > 0)
+    {
+        if (accessor_offset > view_length || element_size > view_length - accessor_offset)
+        {
+            return 0;
+        }
+        size_t room = view_length - accessor_offset - element_size;
+        if (out->stride != 0 && out->count - 1 > room / out->stride)
+        {
+            return 0;
+        }
+    }
+
+    out->data = gltf->buffers[buffer].data + view_offset + accessor_offset;
+    return 1;
+}
+
+static float accessor_float(const gltf_accessor_t *accessor, uint32_t element, uint32_t component)
+{
+    const uint8_t *p = accessor->data + (size_t)element * accessor->stride + component * accessor->component_size;
+    switch (accessor->component_type)
+    {
+    case 5126:
+    {
+        float f;
+        memcpy(&f, p, sizeof(f));
+        return f;
+    }
+    case 5121:
+        return accessor->normalized ? *p / 255.0f : (float)*p;
+    case 5123:
+    {
+        uint16_t u;
+        memcpy(&u, p, sizeof(u));
+        return accessor->normalized ? u / 65535.0f : (float)u;
+    }
+    case 5120:
+    {
+        float f = (float)(int8_t)*p;
+        return accessor->normalized ? (f / 127.0f < -1.0f ? -1.0f : f / 127.0f) : f;
+    }
+    case 5122:
+    {
+        int16_t s;
+        memcpy(&s, p, sizeof(s));
+        return accessor->normalized ? (s / 32767.0f < -1.0f ? -1.0f : s / 32767.0f) : (float)s;
+    }
+    default:
+        return 0.0f;
+    }
+}
+
+static uint32_t accessor_uint(const gltf_accessor_t *accessor, uint32_t element)
+{
+    const uint8_t *p = accessor->data + (size_t)element * accessor->stride;
+    switch (accessor->component_type)
+    {
+    case 5121:
+        return *p;
+    case 5123:
+    {
+        uint16_t u;
+        memcpy(&u, p, sizeof(u));
+        return u;
+    }
+    case 5125:
+    {
+        uint32_t u;
+        memcpy(&u, p, sizeof(u));
+        return u;
+    }
+    default:
+        return UINT32_MAX;
+    }
+}
+
+// Growable output mesh
+typedef struct mesh_builder_t
+{
+    mesh_data_t *mesh;
+    uint32_t vertex_capacity;
+    uint32_t index_capacity;
+} mesh_builder_t;
+
+static int builder_reserve(mesh_builder_t *builder, uint32_t vertex_count, uint32_t index_count)
+{
+    mesh_data_t *mesh = builder->mesh;
+    if (mesh->vertex_count + vertex_count > builder->vertex_capacity)
+    {
+        uint32_t capacity = builder->vertex_capacity ? builder->vertex_capacity : 1024;
+        while (capacity < mesh->vertex_count + vertex_count)
+        {
+            capacity *= 2;
+        }
+        mesh_vertex_t *vertices = realloc(mesh->vertices, capacity * sizeof(mesh_vertex_t));
+        if (!vertices)
+        {
+            return 0;
+        }
+        mesh->vertices = vertices;
+        builder->vertex_capacity = capacity;
+    }
+
+    if (mesh->index_count + index_count > builder->index_capacity)
+    {
+        uint32_t capacity = builder->index_capacity ? builder->index_capacity : 1024;
+        while (capacity < mesh->index_count + index_count)
+        {
+            capacity *= 2;
+        }
+        uint32_t *indices = realloc(mesh->indices, capacity * sizeof(uint32_t));
+        if (!indices)
+        {
+            return 0;
+        }
+        mesh->indices = indices;
+        builder->index_capacity = capacity;
+    }
+
+    return 1;
+}
+
+static int decode_primitive(const gltf_t *gltf, int primitive, const float world[16], mesh_builder_t *builder)
+{
+    const json_t *json = &gltf->json;
+
+    // only triangle lists, points and lines are skipped
+    uint32_t mode;
+    if (!find_uint32(json, primitive, "mode", 4, &mode) || mode != 4)
+    {
+        return 1;
+    }
+
+    int attributes = json_find(json, primitive, "attributes");
+    gltf_accessor_t positions;
+    if (!get_accessor(gltf, find_index(json, attributes, "POSITION"), &positions) || positions.components != 3)
+    {
+        printf("%s: primitive without usable POSITION\n", gltf->path);
+        return 0;
+    }
+
+    gltf_accessor_t uvs;
+    int has_uvs = get_accessor(gltf, find_index(json, attributes, "TEXCOORD_0"), &uvs) && uvs.components == 2 && uvs.count == positions.count;
+
+    gltf_accessor_t indices;
+    int has_indices = json_find(json, primitive, "indices") >= 0;
+    if (has_indices && (!get_accessor(gltf, find_index(json, primitive, "indices"), &indices) || indices.components != 1))
+    {
+        printf("%s: primitive with unusable indices\n", gltf->path);
+        return 0;
+    }
+
+    uint32_t index_count = has_indices ? indices.count : positions.count;
+    index_count -= index_count % 3;
+    if (!builder_reserve(builder, positions.count, index_count))
+    {
+        return 0;
+    }
+
+    mesh_data_t *mesh = builder->mesh;
+    uint32_t base = mesh->vertex_count;
+    for (uint32_t i = 0; i < positions.count; i++)
+    {
+        float p[3] = {accessor_float(&positions, i, 0), accessor_float(&positions, i, 1), accessor_float(&positions, i, 2)};
+        mesh_vertex_t *v = &mesh->vertices[base + i];
+        for (int k = 0; k < 3; k++)
+        {
+            v->position[k] = world[k] * p[0] + world[4 + k] * p[1] + world[8 + k] * p[2] + world[12 + k];
+        }
+        v->uv[0] = has_uvs ? accessor_float(&uvs, i, 0) : 0.0f;
+        v->uv[1] = has_uvs ? accessor_float(&uvs, i, 1) : 0.0f;
+    }
+    mesh->vertex_count += positions.count;
+
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        uint32_t index = has_indices ? accessor_uint(&indices, i) : i;
+        if (index >= positions.count)
+        {
+            printf("%s: index out of range\n", gltf->path);
+            return 0;
+        }
+        mesh->indices[mesh->index_count++] = base + index;
+    }
+
+    return 1;
+}
+
+static void node_local_matrix(const json_t *json, int node, float local[16])
+{
+    int matrix = json_find(json, node, "matrix");
+    if (matrix >= 0 && json->tokens[matrix].count == 16)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            local[i] = (float)json_number(json, json_at(json, matrix, i), 0);
+        }
+        return;
+    }
+
+    int t = json_find(json, node, "translation");
+    int r = json_find(json, node, "rotation");
+    int s = json_find(json, node, "scale");
+    float translation[3] = {0, 0, 0};
+    float rotation[4] = {0, 0, 0, 1};
+    float scale[3] = {1, 1, 1};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        translation[i] = (float)json_number(json, json_at(json, t, i), translation[i]);
+        scale[i] = (float)json_number(json, json_at(json, s, i), scale[i]);
+    }
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        rotation[i] = (float)json_number(json, json_at(json, r, i), rotation[i]);
+    }
+
+    mat4_trs(local, translation, rotation, scale);
+}
+
+static int decode_node(const gltf_t *gltf, int node_index, const float parent[16], int depth, mesh_builder_t *builder)
+{
+    const json_t *json = &gltf->json;
+    int node = json_at(json, json_find(json, 0, "nodes"), (uint32_t)node_index);
+    if (node < 0 || depth > GLTF_MAX_NODE_DEPTH)
+    {
+        return 0;
+    }
+
+    float local[16];
+    float world[16];
+    node_local_matrix(json, node, local);
+    mat4_multiply_simd(world, parent, local);
+
+    int mesh = json_at(json, json_find(json, 0, "meshes"), (uint32_t)find_index(json, node, "mesh"));
+    int primitives = json_find(json, mesh, "primitives");
+    for (uint32_t i = 0; primitives >= 0 && i < json->tokens[primitives].count; i++)
+    {
+        if (!decode_primitive(gltf, json_at(json, primitives, i), world, builder))
+        {
+            return 0;
+        }
+    }
+
+    int children = json_find(json, node, "children");
+    for (uint32_t i = 0; children >= 0 && i < json->tokens[children].count; i++)
+    {
+        if (!decode_node(gltf, token_index(json, json_at(json, children, i)), world, depth + 1, builder))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int gltf_load(const char *path, mesh_data_t *mesh)
+{
+    memset(mesh, 0, sizeof(*mesh));
+
+    gltf_t gltf;
+    if (!gltf_open(&gltf, path))
+    {
+        gltf_close(&gltf);
+        return 0;
+    }
+
+    const json_t *json = &gltf.json;
+    mesh_builder_t builder = {.mesh = mesh};
+    float identity[16];
+    mat4_identity(identity);
+
+    int ok = 1;
+    int scene_index = json_find(json, 0, "scene") >= 0 ? find_index(json, 0, "scene") : 0;
+    int scene = json_at(json, json_find(json, 0, "scenes"), (uint32_t)scene_index);
+    if (scene >= 0)
+    {
+        int nodes = json_find(json, scene, "nodes");
+        for (uint32_t i = 0; ok && nodes >= 0 && i < json->tokens[nodes].count; i++)
+        {
+            ok = decode_node(&gltf, token_index(json, json_at(json, nodes, i)), identity, 0, &builder);
+        }
+    }
+    else
+    {
+        // no scene, every mesh once at the origin
+        int meshes = json_find(json, 0, "meshes");
+        for (uint32_t m = 0; ok && meshes >= 0 && m < json->tokens[meshes].count; m++)
+        {
+            int primitives = json_find(json, json_at(json, meshes, m), "primitives");
+            for (uint32_t i = 0; ok && primitives >= 0 && i < json->tokens[primitives].count; i++)
+            {
+                ok = decode_primitive(&gltf, json_at(json, primitives, i), identity, &builder);
+            }
+        }
+    }
+
+    gltf_close(&gltf);
+
+    if (ok && mesh->index_count == 0)
+    {
+        printf("%s: no triangles\n", path);
+        ok = 0;
+    }
+
+    if (!ok)
+    {
+        mesh_data_free(mesh);
+    }
+    return ok;
+}
+
+static int SDLCALL gltf_stream_worker(void *userdata)
+{
+    gltf_stream_t *stream = userdata;
+    cpu_profiler_thread_name("gltf_loader");
+
+    cpu_zone_begin("gltf decode", -1);
+    int ok = gltf_load(stream->path, &stream->data) && mesh_optimize(&stream->data, NULL);
+    if (ok && mesh_index_type(stream->data.vertex_count) == GL_UNSIGNED_SHORT)
+    {
+        stream->short_indices = mesh_short_indices(stream->data.indices, stream->data.index_count);
+        ok = stream->short_indices != NULL;
+    }
+    cpu_zone_end();
+
+    stream->decode_failed = !ok;
+    stream->decode_ns = clock_ns() - stream->start_ns;
+    SDL_AtomicSet(&stream->decoded, 1);
+    return 0;
+}
+
+int gltf_stream_start(gltf_stream_t *stream, const char *path)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->path = path;
+    stream->state = GLTF_STREAM_DECODING;
+    stream->start_ns = clock_ns();
+
+    stream->thread = SDL_CreateThread(gltf_stream_worker, "gltf_loader", stream);
+    if (!stream->thread)
+    {
+        printf("Failed to create glTF loader thread: %s\n", SDL_GetError());
+        stream->state = GLTF_STREAM_FAILED;
+        return 0;
+    }
+
+    return 1;
+}
+
+// Copies up to budget bytes from src into dst at offset through this frame's ring region
+static size_t upload_chunk(gpu_ring_t *ring, GLuint dst, const uint8_t *src, size_t size, size_t *uploaded, size_t budget)
+{
+    size_t chunk = size - *uploaded;
+    if (chunk > budget)
+    {
+        chunk = budget;
+    }
+
+    gpu_ring_alloc_t alloc;
+    if (chunk == 0 || !gpu_ring_alloc(ring, (GLsizeiptr)chunk, 16, &alloc))
+    {
+        return 0;
+    }
+
+    memcpy(alloc.ptr, src + *uploaded, chunk);
+    glCopyNamedBufferSubData(ring->buffer, dst, alloc.offset, (GLintptr)*uploaded, (GLsizeiptr)chunk);
+    *uploaded += chunk;
+    return chunk;
+}
+
+gltf_stream_state_t gltf_stream_update(gltf_stream_t *stream, gpu_ring_t *ring, size_t budget)
+{
+    if (stream->state == GLTF_STREAM_DECODING)
+    {
+        if (!SDL_AtomicGet(&stream->decoded))
+        {
+            return stream->state;
+        }
+
+        SDL_WaitThread(stream->thread, NULL);
+        stream->thread = NULL;
+
+        if (stream->decode_failed)
+        {
+            printf("Failed to load %s\n", stream->path);
+            stream->state = GLTF_STREAM_FAILED;
+            return stream->state;
+        }
+
+        // storage only, the contents arrive over the next frames
+        GLenum index_type = stream->short_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        mesh_create(&stream->mesh, NULL, stream->data.vertex_count, NULL, stream->data.index_count, index_type);
+        stream->mesh.radius = mesh_data_radius(&stream->data);
+        stream->state = GLTF_STREAM_UPLOADING;
+    }
+
+    if (stream->state != GLTF_STREAM_UPLOADING)
+    {
+        return stream->state;
+    }
+
+    uint64_t frame_start = clock_ns();
+
+    size_t vertex_size = (size_t)stream->data.vertex_count * sizeof(mesh_vertex_t);
+    const uint8_t *index_data = stream->short_indices ? (const uint8_t *)stream->short_indices : (const uint8_t *)stream->data.indices;
+    size_t index_size = (size_t)stream->data.index_count * (stream->short_indices ? sizeof(uint16_t) : sizeof(uint32_t));
+
+    size_t frame_bytes = upload_chunk(ring, stream->mesh.vertex_buffer, (const uint8_t *)stream->data.vertices, vertex_size, &stream->vertex_bytes_uploaded, budget);
+    if (frame_bytes < budget)
+    {
+        frame_bytes += upload_chunk(ring, stream->mesh.index_buffer, index_data, index_size, &stream->index_bytes_uploaded, budget - frame_bytes);
+    }
+
+    uint64_t frame_ns = clock_ns() - frame_start;
+    stream->upload_frames++;
+    stream->upload_ns += frame_ns;
+    if (frame_bytes > stream->max_frame_upload_bytes)
+    {
+        stream->max_frame_upload_bytes = frame_bytes;
+    }
+    if (frame_ns > stream->max_frame_upload_ns)
+    {
+        stream->max_frame_upload_ns = frame_ns;
+    }
+
+    if (stream->vertex_bytes_uploaded == vertex_size && stream->index_bytes_uploaded == index_size)
+    {
+        stream->state = GLTF_STREAM_READY;
+
+        printf("Streamed %s: %u vertices, %u indices in %.1f ms (decode %.1f ms), upload %u frames, max %.1f KiB and %.3f ms per frame\n",
+               stream->path, stream->data.vertex_count, stream->data.index_count,
+               (clock_ns() - stream->start_ns) / 1e6, stream->decode_ns / 1e6,
+               stream->upload_frames, stream->max_frame_upload_bytes / 1024.0, stream->max_frame_upload_ns / 1e6);
+
+        mesh_data_free(&stream->data);
+        free(stream->short_indices);
+        stream->short_indices = NULL;
+    }
+
+    return stream->state;
+}
+
+void gltf_stream_free(gltf_stream_t *stream)
+{
+    if (stream->thread)
+    {
+        SDL_WaitThread(stream->thread, NULL);
+    }
+
+    if (stream->mesh.vertex_buffer)
+    {
+        mesh_free(&stream->mesh);
+    }
+
+    mesh_data_free(&stream->data);
+    free(stream->short_indices);
+    memset(stream, 0, sizeof(*stream));
+}
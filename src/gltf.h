@@ -0,0 +1,53 @@
+#ifndef GLTF_H
+#define GLTF_H
+
+#include <stdint.h>
+
+#include "SDL2/SDL.h"
+#include "gpu_ring.h"
+#include "mesh.h"
+
+// Decodes every triangle primitive of the default scene of a .gltf or .glb file into one
+// mesh, with node transforms baked into the positions. Only POSITION and TEXCOORD_0 are read.
+int gltf_load(const char *path, mesh_data_t *mesh);
+
+typedef enum gltf_stream_state_t
+{
+    GLTF_STREAM_DECODING,
+    GLTF_STREAM_UPLOADING,
+    GLTF_STREAM_READY,
+    GLTF_STREAM_FAILED,
+} gltf_stream_state_t;
+
+// A glTF model loaded in the background: a worker thread reads, decodes and optimizes it,
+// then the render thread uploads it a bounded number of bytes per frame
+typedef struct gltf_stream_t
+{
+    const char *path;
+    gltf_stream_state_t state;
+    SDL_Thread *thread;
+    SDL_atomic_t decoded; // set by the worker when data is complete, or it failed
+    int decode_failed;
+
+    mesh_data_t data;
+    uint16_t *short_indices;
+    mesh_t mesh;
+    size_t vertex_bytes_uploaded;
+    size_t index_bytes_uploaded;
+
+    // metrics
+    uint64_t start_ns;
+    uint64_t decode_ns;
+    uint64_t upload_ns;
+    uint32_t upload_frames;
+    size_t max_frame_upload_bytes;
+    uint64_t max_frame_upload_ns;
+} gltf_stream_t;
+
+int gltf_stream_start(gltf_stream_t *stream, const char *path);
+// Call once per frame on the GL thread, copies at most budget bytes through the ring.
+// Returns the stream state after the update.
+gltf_stream_state_t gltf_stream_update(gltf_stream_t *stream, gpu_ring_t *ring, size_t budget);
+void gltf_stream_free(gltf_stream_t *stream);
+
+#endif
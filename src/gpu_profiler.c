@@ -0,0 +1,292 @@
+#include "gpu_profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+
+void gpu_profiler_init(gpu_profiler_t *profiler)
+{
+    memset(profiler, 0, sizeof(*profiler));
+    for (uint32_t i = 0; i < GPU_PROFILER_FRAMES; i++)
+    {
+        glGenQueries(GPU_PROFILER_MAX_MARKS * 2, profiler->frames[i].queries);
+    }
+}
+
+void gpu_profiler_free(gpu_profiler_t *profiler)
+{
+    for (uint32_t i = 0; i < GPU_PROFILER_FRAMES; i++)
+    {
+        glDeleteQueries(GPU_PROFILER_MAX_MARKS * 2, profiler->frames[i].queries);
+    }
+    memset(profiler, 0, sizeof(*profiler));
+}
+
+static void calibrate(gpu_profiler_t *profiler)
+{
+    // GL_TIMESTAMP read this way is the GPU clock once earlier commands reach the GPU,
+    // without waiting for them to finish
+    GLint64 gpu_ns = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+    profiler->gpu_to_cpu_ns = (int64_t)clock_ns() - (int64_t)gpu_ns;
+    profiler->calibrate_countdown = GPU_PROFILER_CALIBRATE_FRAMES;
+}
+
+void gpu_profiler_begin_frame(gpu_profiler_t *profiler, int64_t display_time)
+{
+    profiler->active = 0;
+    profiler->open_count = 0;
+    profiler->open_overflow = 0;
+
+    gpu_profiler_frame_t *frame = &profiler->frames[profiler->next];
+    if (frame->pending)
+    {
+        // the GPU is more than GPU_PROFILER_FRAMES behind, skip rather than wait
+        profiler->frames_skipped++;
+        return;
+    }
+
+    if (profiler->calibrate_countdown == 0)
+    {
+        calibrate(profiler);
+    }
+    profiler->calibrate_countdown--;
+
+    frame->mark_count = 0;
+    frame->cpu_ns = clock_ns();
+    frame->display_time = display_time;
+    frame->gpu_to_cpu_ns = profiler->gpu_to_cpu_ns;
+    profiler->active = 1;
+}
+
+void gpu_profiler_end_frame(gpu_profiler_t *profiler)
+{
+    if (!profiler->active)
+    {
+        return;
+    }
+
+    gpu_profiler_frame_t *frame = &profiler->frames[profiler->next];
+    while (profiler->open_count > 0)
+    {
+        gpu_profiler_end(profiler);
+    }
+
+    if (frame->mark_count > 0)
+    {
+        frame->pending = 1;
+        profiler->next = (profiler->next + 1) % GPU_PROFILER_FRAMES;
+    }
+    profiler->active = 0;
+}
+
+static int find_zone(gpu_profiler_t *profiler, const char *name, int index)
+{
+    for (uint32_t i = 0; i < profiler->zone_count; i++)
+    {
+        gpu_zone_t *zone = &profiler->zones[i];
+        if (zone->index == index && (zone->name == name || strcmp(zone->name, name) == 0))
+        {
+            return (int)i;
+        }
+    }
+
+    if (profiler->zone_count == GPU_PROFILER_MAX_ZONES)
+    {
+        return -1;
+    }
+
+    gpu_zone_t *zone = &profiler->zones[profiler->zone_count];
+    zone->name = name;
+    zone->index = index;
+    return (int)profiler->zone_count++;
+}
+
+void gpu_profiler_begin(gpu_profiler_t *profiler, const char *name, int index)
+{
+    if (!profiler->active)
+    {
+        return;
+    }
+
+    gpu_profiler_frame_t *frame = &profiler->frames[profiler->next];
+    if (profiler->open_count == GPU_PROFILER_MAX_DEPTH)
+    {
+        profiler->marks_dropped++;
+        profiler->open_overflow++;
+        return;
+    }
+
+    int zone = find_zone(profiler, name, index);
+    if (zone < 0 || frame->mark_count == GPU_PROFILER_MAX_MARKS)
+    {
+        // keep begin and end balanced, the matching end pops this
+        profiler->marks_dropped++;
+        profiler->open[profiler->open_count++] = UINT32_MAX;
+        return;
+    }
+
+    uint32_t mark = frame->mark_count++;
+    frame->marks[mark].zone = (uint32_t)zone;
+    frame->marks[mark].depth = profiler->open_count;
+    glQueryCounter(frame->queries[mark * 2], GL_TIMESTAMP);
+    frame->last_query = mark * 2;
+    profiler->open[profiler->open_count++] = mark;
+}
+
+void gpu_profiler_end(gpu_profiler_t *profiler)
+{
+    if (!profiler->active || profiler->open_count == 0)
+    {
+        return;
+    }
+
+    if (profiler->open_overflow > 0)
+    {
+        profiler->open_overflow--;
+        return;
+    }
+
+    uint32_t mark = profiler->open[--profiler->open_count];
+    if (mark == UINT32_MAX)
+    {
+        return;
+    }
+
+    gpu_profiler_frame_t *frame = &profiler->frames[profiler->next];
+    glQueryCounter(frame->queries[mark * 2 + 1], GL_TIMESTAMP);
+    frame->last_query = mark * 2 + 1;
+}
+
+static void add_sample(gpu_zone_t *zone, double ms)
+{
+    zone->history[zone->history_next] = (float)ms;
+    zone->history_next = (zone->history_next + 1) % GPU_PROFILER_HISTORY;
+    if (zone->history_count < GPU_PROFILER_HISTORY)
+    {
+        zone->history_count++;
+    }
+    zone->total_ms += ms;
+    zone->samples++;
+}
+
+int gpu_profiler_poll(gpu_profiler_t *profiler)
+{
+    int found = 0;
+
+    // results come back in submission order, stop at the first frame that is not ready
+    while (profiler->frames[profiler->oldest].pending)
+    {
+        gpu_profiler_frame_t *frame = &profiler->frames[profiler->oldest];
+        GLint available = 0;
+        glGetQueryObjectiv(frame->queries[frame->last_query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        for (uint32_t m = 0; m < frame->mark_count; m++)
+        {
+            gpu_profiler_mark_t *mark = &frame->marks[m];
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame->queries[m * 2], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame->queries[m * 2 + 1], GL_QUERY_RESULT, &end);
+            mark->begin_ns = (uint64_t)((int64_t)begin + frame->gpu_to_cpu_ns);
+            mark->end_ns = (uint64_t)((int64_t)end + frame->gpu_to_cpu_ns);
+            add_sample(&profiler->zones[mark->zone], end > begin ? (end - begin) / 1e6 : 0.0);
+        }
+
+        profiler->last = *frame;
+        profiler->frames_resolved++;
+        found++;
+
+        frame->pending = 0;
+        profiler->oldest = (profiler->oldest + 1) % GPU_PROFILER_FRAMES;
+    }
+
+    return found;
+}
+
+static int compare_float(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+int gpu_profiler_zone_stats(const gpu_zone_t *zone, double *average_ms, double *p50_ms, double *p95_ms, double *p99_ms)
+{
+    uint32_t count = zone->history_count;
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    float sorted[GPU_PROFILER_HISTORY];
+    memcpy(sorted, zone->history, count * sizeof(float));
+    qsort(sorted, count, sizeof(float), compare_float);
+
+    double total = 0.0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        total += sorted[i];
+    }
+
+    *average_ms = total / count;
+    *p50_ms = sorted[(count - 1) * 50 / 100];
+    *p95_ms = sorted[(count - 1) * 95 / 100];
+    *p99_ms = sorted[(count - 1) * 99 / 100];
+    return 1;
+}
+
+void gpu_profiler_print_stats(const gpu_profiler_t *profiler)
+{
+    printf("GPU profile: %llu frames resolved, %llu skipped, %llu zones dropped, last %u frames per zone:\n",
+           (unsigned long long)profiler->frames_resolved, (unsigned long long)profiler->frames_skipped,
+           (unsigned long long)profiler->marks_dropped, GPU_PROFILER_HISTORY);
+    printf("\t%-10s %5s %8s %8s %8s %8s %8s\n", "zone", "index", "avg ms", "p50", "p95", "p99", "all avg");
+
+    for (uint32_t i = 0; i < profiler->zone_count; i++)
+    {
+        const gpu_zone_t *zone = &profiler->zones[i];
+        double average, p50, p95, p99;
+        if (gpu_profiler_zone_stats(zone, &average, &p50, &p95, &p99))
+        {
+            printf("\t%-10s %5d %8.3f %8.3f %8.3f %8.3f %8.3f\n", zone->name, zone->index,
+                   average, p50, p95, p99, zone->total_ms / zone->samples);
+        }
+    }
+}
+
+void gpu_profiler_print_frame(const gpu_profiler_t *profiler)
+{
+    const gpu_profiler_frame_t *frame = &profiler->last;
+    if (profiler->frames_resolved == 0)
+    {
+        return;
+    }
+
+    // everything relative to the CPU starting the frame
+    printf("GPU timeline of the newest measured frame, ms after the CPU began it:\n");
+    for (uint32_t m = 0; m < frame->mark_count; m++)
+    {
+        const gpu_profiler_mark_t *mark = &frame->marks[m];
+        const gpu_zone_t *zone = &profiler->zones[mark->zone];
+        printf("\t%*s%s %d: %8.3f .. %8.3f\n", (int)mark->depth * 2, "", zone->name, zone->index,
+               ((int64_t)mark->begin_ns - (int64_t)frame->cpu_ns) / 1e6, ((int64_t)mark->end_ns - (int64_t)frame->cpu_ns) / 1e6);
+    }
+
+    if (profiler->xr_clock_known && frame->mark_count > 0)
+    {
+        int64_t display_ns = frame->display_time + profiler->xr_to_cpu_ns;
+        uint64_t gpu_end_ns = 0;
+        for (uint32_t m = 0; m < frame->mark_count; m++)
+        {
+            gpu_end_ns = frame->marks[m].end_ns > gpu_end_ns ? frame->marks[m].end_ns : gpu_end_ns;
+        }
+        printf("\tpredicted display at %8.3f, the GPU finished %.3f ms before it\n",
+               (display_ns - (int64_t)frame->cpu_ns) / 1e6, (display_ns - (int64_t)gpu_end_ns) / 1e6);
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+// Frames a result may take to come back before its slot is needed again
+#define GPU_PROFILER_FRAMES 4
+// Distinct zones, a zone is a name and an index such as the view
+#define GPU_PROFILER_MAX_ZONES 32
+// Zones recorded in one frame
+#define GPU_PROFILER_MAX_MARKS 32
+// Nesting depth of open zones
+#define GPU_PROFILER_MAX_DEPTH 4
+// Samples kept per zone for the rolling average and percentiles
+#define GPU_PROFILER_HISTORY 256
+// Frames between re-reading the GPU clock against the CPU clock, they drift apart slowly
+#define GPU_PROFILER_CALIBRATE_FRAMES 60
+
+typedef struct gpu_zone_t
+{
+    const char *name;
+    int index;
+
+    float history[GPU_PROFILER_HISTORY]; // ms, a ring
+    uint32_t history_count;
+    uint32_t history_next;
+
+    double total_ms;
+    uint64_t samples;
+} gpu_zone_t;
+
+// One timestamp pair per recorded zone
+typedef struct gpu_profiler_mark_t
+{
+    uint32_t zone;
+    uint32_t depth;
+    uint64_t begin_ns; // on the CPU clock once resolved
+    uint64_t end_ns;
+} gpu_profiler_mark_t;
+
+typedef struct gpu_profiler_frame_t
+{
+    GLuint queries[GPU_PROFILER_MAX_MARKS * 2]; // begin and end timestamp of each mark
+    gpu_profiler_mark_t marks[GPU_PROFILER_MAX_MARKS];
+    uint32_t mark_count;
+    uint32_t last_query; // the last timestamp written, when it is available all of them are
+    int pending;
+
+    uint64_t cpu_ns;      // CPU clock when the frame began
+    int64_t display_time; // XrTime the frame is predicted to be displayed at
+    int64_t gpu_to_cpu_ns;
+} gpu_profiler_frame_t;
+
+// Times named GPU passes with GL_TIMESTAMP queries. Results are read back a few frames later
+// without stalling and moved onto the CPU clock, and onto XrTime when the caller provides
+// the offset between the two, so CPU work, GPU passes and display time share one timeline.
+typedef struct gpu_profiler_t
+{
+    gpu_profiler_frame_t frames[GPU_PROFILER_FRAMES];
+    uint32_t next;   // slot of the next frame
+    uint32_t oldest; // oldest slot that may still be pending
+    int active;      // a frame was begun with a free slot
+
+    uint32_t open[GPU_PROFILER_MAX_DEPTH]; // marks begun and not yet ended
+    uint32_t open_count;
+    uint32_t open_overflow; // zones begun past GPU_PROFILER_MAX_DEPTH
+
+    gpu_zone_t zones[GPU_PROFILER_MAX_ZONES];
+    uint32_t zone_count;
+
+    int64_t gpu_to_cpu_ns;
+    uint32_t calibrate_countdown;
+    int64_t xr_to_cpu_ns; // set by the caller, XrTime plus this is the CPU clock
+    int xr_clock_known;
+
+    gpu_profiler_frame_t last; // newest resolved frame
+
+    // statistics
+    uint64_t frames_resolved;
+    uint64_t frames_skipped; // every slot was still in flight
+    uint64_t marks_dropped;  // more zones than GPU_PROFILER_MAX_MARKS or _ZONES
+} gpu_profiler_t;
+
+void gpu_profiler_init(gpu_profiler_t *profiler);
+void gpu_profiler_free(gpu_profiler_t *profiler);
+
+void gpu_profiler_begin_frame(gpu_profiler_t *profiler, int64_t display_time);
+void gpu_profiler_end_frame(gpu_profiler_t *profiler);
+
+// Zones may nest, each begin needs its end within the same frame
+void gpu_profiler_begin(gpu_profiler_t *profiler, const char *name, int index);
+void gpu_profiler_end(gpu_profiler_t *profiler);
+
+// Reads back every finished frame, returns how many
+int gpu_profiler_poll(gpu_profiler_t *profiler);
+
+// Rolling statistics of one zone in ms, returns 0 if it has no samples
+int gpu_profiler_zone_stats(const gpu_zone_t *zone, double *average_ms, double *p50_ms, double *p95_ms, double *p99_ms);
+
+void gpu_profiler_print_stats(const gpu_profiler_t *profiler);
+// Prints the newest resolved frame on the CPU and XrTime timeline
+void gpu_profiler_print_frame(const gpu_profiler_t *profiler);
+
+#endif
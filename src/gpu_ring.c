@@ -0,0 +1,157 @@
+#include "gpu_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+
+int gpu_ring_init(gpu_ring_t *ring, GLsizeiptr frame_size, uint32_t frame_count)
+{
+    memset(ring, 0, sizeof(*ring));
+
+    if (frame_count == 0 || frame_count > GPU_RING_MAX_FRAMES)
+    {
+        return 0;
+    }
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ring->uniform_alignment);
+    if (ring->uniform_alignment <= 0)
+    {
+        ring->uniform_alignment = 256;
+    }
+
+    // keep every region start aligned for any use of the buffer
+    frame_size = (frame_size + 255) / 256 * 256;
+
+    ring->frame_count = frame_count;
+    ring->frame_size = frame_size;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, frame_size * frame_count, NULL, flags);
+    ring->mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frame_size * frame_count, flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (!ring->mapped)
+    {
+        glDeleteBuffers(1, &ring->buffer);
+        ring->buffer = 0;
+        return 0;
+    }
+
+    // start on the last region so the first begin_frame moves to region 0
+    ring->frame_index = frame_count - 1;
+    ring->head = frame_size;
+
+    return 1;
+}
+
+void gpu_ring_free(gpu_ring_t *ring)
+{
+    for (uint32_t i = 0; i < ring->frame_count; i++)
+    {
+        if (ring->fences[i])
+        {
+            glDeleteSync(ring->fences[i]);
+        }
+    }
+
+    if (ring->mapped)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    glDeleteBuffers(1, &ring->buffer);
+    memset(ring, 0, sizeof(*ring));
+}
+
+void gpu_ring_begin_frame(gpu_ring_t *ring)
+{
+    ring->frame_index = (ring->frame_index + 1) % ring->frame_count;
+    ring->head = 0;
+    ring->frames++;
+    ring->wait_ns_last = 0;
+
+    GLsync fence = ring->fences[ring->frame_index];
+    if (!fence)
+    {
+        return;
+    }
+
+    // the region was last used frame_count frames ago, usually that work has long finished
+    GLenum wait_result = glClientWaitSync(fence, 0, 0);
+    if (wait_result == GL_TIMEOUT_EXPIRED)
+    {
+        uint64_t wait_start = clock_ns();
+        GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        do
+        {
+            wait_result = glClientWaitSync(fence, wait_flags, 1000000);
+            wait_flags = 0;
+        } while (wait_result == GL_TIMEOUT_EXPIRED);
+
+        ring->wait_ns_last = clock_ns() - wait_start;
+        ring->wait_frames++;
+        ring->wait_ns_total += ring->wait_ns_last;
+        if (ring->wait_ns_last > ring->wait_ns_max)
+        {
+            ring->wait_ns_max = ring->wait_ns_last;
+        }
+    }
+
+    if (wait_result == GL_WAIT_FAILED)
+    {
+        printf("Failed to wait for frame fence\n");
+    }
+
+    glDeleteSync(fence);
+    ring->fences[ring->frame_index] = NULL;
+}
+
+void gpu_ring_end_frame(gpu_ring_t *ring)
+{
+    if (ring->fences[ring->frame_index])
+    {
+        glDeleteSync(ring->fences[ring->frame_index]);
+    }
+    ring->fences[ring->frame_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+int gpu_ring_alloc(gpu_ring_t *ring, GLsizeiptr size, GLsizeiptr alignment, gpu_ring_alloc_t *alloc)
+{
+    GLsizeiptr start = (ring->head + alignment - 1) / alignment * alignment;
+    if (start + size > ring->frame_size)
+    {
+        return 0;
+    }
+
+    ring->head = start + size;
+
+    alloc->offset = ring->frame_index * ring->frame_size + start;
+    alloc->ptr = ring->mapped + alloc->offset;
+    alloc->size = size;
+    return 1;
+}
+
+GLintptr gpu_ring_push_uniforms(gpu_ring_t *ring, const void *data, GLsizeiptr size)
+{
+    gpu_ring_alloc_t alloc;
+    if (!gpu_ring_alloc(ring, size, ring->uniform_alignment, &alloc))
+    {
+        return -1;
+    }
+
+    memcpy(alloc.ptr, data, size);
+    return alloc.offset;
+}
+
+void gpu_ring_print_stats(const gpu_ring_t *ring)
+{
+    printf("GPU ring: %u frames in flight of %.2f MiB, waited on fences in %llu of %llu frames, total %.3f ms, max %.3f ms\n",
+           ring->frame_count, ring->frame_size / (1024.0 * 1024.0),
+           (unsigned long long)ring->wait_frames, (unsigned long long)ring->frames,
+           ring->wait_ns_total / 1e6, ring->wait_ns_max / 1e6);
+}
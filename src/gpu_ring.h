@@ -0,0 +1,57 @@
+#ifndef GPU_RING_H
+#define GPU_RING_H
+
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+#define GPU_RING_MAX_FRAMES 4
+
+// A sub-allocation from the ring, ptr is write-only mapped GPU memory valid until the
+// frame that allocated it comes around again
+typedef struct gpu_ring_alloc_t
+{
+    void *ptr;
+    GLintptr offset;
+    GLsizeiptr size;
+} gpu_ring_alloc_t;
+
+// One persistently and coherently mapped buffer split into a region per frame in flight.
+// Each region is fenced at the end of its frame and waited on before it is reused, so
+// streaming per-frame data never hits the implicit sync of glBufferData/glBufferSubData.
+typedef struct gpu_ring_t
+{
+    GLuint buffer;
+    uint8_t *mapped;
+    GLint uniform_alignment;
+
+    uint32_t frame_count;
+    uint32_t frame_index;
+    GLsizeiptr frame_size;
+    GLsizeiptr head; // offset of the next free byte in the current frame's region
+    GLsync fences[GPU_RING_MAX_FRAMES];
+
+    // fence wait statistics
+    uint64_t frames;
+    uint64_t wait_frames;
+    uint64_t wait_ns_last;
+    uint64_t wait_ns_max;
+    uint64_t wait_ns_total;
+} gpu_ring_t;
+
+int gpu_ring_init(gpu_ring_t *ring, GLsizeiptr frame_size, uint32_t frame_count);
+void gpu_ring_free(gpu_ring_t *ring);
+
+// Moves to the next frame's region, waiting for the GPU to finish with it if necessary
+void gpu_ring_begin_frame(gpu_ring_t *ring);
+// Fences the current region, call after the last command using this frame's allocations
+void gpu_ring_end_frame(gpu_ring_t *ring);
+
+// Returns 0 if the current frame's region has no room left
+int gpu_ring_alloc(gpu_ring_t *ring, GLsizeiptr size, GLsizeiptr alignment, gpu_ring_alloc_t *alloc);
+// Allocates and copies data with uniform buffer offset alignment, returns the offset or -1
+GLintptr gpu_ring_push_uniforms(gpu_ring_t *ring, const void *data, GLsizeiptr size);
+
+void gpu_ring_print_stats(const gpu_ring_t *ring);
+
+#endif
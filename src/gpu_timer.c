@@ -0,0 +1,68 @@
+#include "gpu_timer.h"
+
+#include <string.h>
+
+void gpu_timer_init(gpu_timer_t *timer)
+{
+    memset(timer, 0, sizeof(*timer));
+    glGenQueries(GPU_TIMER_FRAMES, timer->queries);
+}
+
+void gpu_timer_free(gpu_timer_t *timer)
+{
+    glDeleteQueries(GPU_TIMER_FRAMES, timer->queries);
+    memset(timer, 0, sizeof(*timer));
+}
+
+void gpu_timer_begin(gpu_timer_t *timer)
+{
+    timer->active = 0;
+    if (timer->pending[timer->next])
+    {
+        // the GPU is more than GPU_TIMER_FRAMES behind, skip rather than wait
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, timer->queries[timer->next]);
+    timer->active = 1;
+}
+
+void gpu_timer_end(gpu_timer_t *timer)
+{
+    if (!timer->active)
+    {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    timer->pending[timer->next] = 1;
+    timer->next = (timer->next + 1) % GPU_TIMER_FRAMES;
+    timer->active = 0;
+}
+
+int gpu_timer_poll(gpu_timer_t *timer, double *gpu_ms)
+{
+    int found = 0;
+
+    // results come back in submission order, stop at the first one that is not ready
+    while (timer->pending[timer->oldest])
+    {
+        GLuint query = timer->queries[timer->oldest];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_ns);
+        *gpu_ms = elapsed_ns / 1e6;
+        found = 1;
+
+        timer->pending[timer->oldest] = 0;
+        timer->oldest = (timer->oldest + 1) % GPU_TIMER_FRAMES;
+    }
+
+    return found;
+}
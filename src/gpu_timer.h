@@ -0,0 +1,31 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+// Frames a result may take to come back before its query slot is needed again
+#define GPU_TIMER_FRAMES 4
+
+// Measures the GPU time of a frame with GL_TIME_ELAPSED queries. Results are read back a few
+// frames later without stalling, a frame whose slot is still busy simply goes unmeasured.
+typedef struct gpu_timer_t
+{
+    GLuint queries[GPU_TIMER_FRAMES];
+    int pending[GPU_TIMER_FRAMES];
+    uint32_t next;   // slot of the next frame
+    uint32_t oldest; // oldest slot that may still be pending
+    int active;      // a query was begun this frame
+} gpu_timer_t;
+
+void gpu_timer_init(gpu_timer_t *timer);
+void gpu_timer_free(gpu_timer_t *timer);
+
+void gpu_timer_begin(gpu_timer_t *timer);
+void gpu_timer_end(gpu_timer_t *timer);
+
+// Returns 1 and the newest available frame time if any finished since the last poll
+int gpu_timer_poll(gpu_timer_t *timer, double *gpu_ms);
+
+#endif
@@ -0,0 +1,195 @@
+#include "haptics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+
+int haptics_init(haptics_t *haptics, XrSession session, XrAction action, const XrPath *subaction_paths, uint32_t subaction_count)
+{
+    memset(haptics, 0, sizeof(*haptics));
+    haptics->session = session;
+    haptics->action = action;
+    haptics->subaction_count = subaction_count < HAPTICS_MAX_SUBACTIONS ? subaction_count : HAPTICS_MAX_SUBACTIONS;
+    memcpy(haptics->subaction_paths, subaction_paths, haptics->subaction_count * sizeof(XrPath));
+
+    haptics->mutex = SDL_CreateMutex();
+    if (!haptics->mutex)
+    {
+        printf("Failed to create haptics mutex: %s\n", SDL_GetError());
+        return 0;
+    }
+    return 1;
+}
+
+void haptics_free(haptics_t *haptics)
+{
+    if (haptics->mutex)
+    {
+        SDL_DestroyMutex(haptics->mutex);
+    }
+    haptics->mutex = NULL;
+}
+
+// Folds effect b into a, the stronger one sets how it feels and the later end is kept
+static int merge_effect(haptics_effect_t *a, const haptics_effect_t *b)
+{
+    int changed = 0;
+    if (b->amplitude > a->amplitude)
+    {
+        a->amplitude = b->amplitude;
+        a->frequency = b->frequency;
+        changed = 1;
+    }
+    if (b->end_ns > a->end_ns)
+    {
+        a->end_ns = b->end_ns;
+    }
+    return changed;
+}
+
+void haptics_request(haptics_t *haptics, uint32_t subaction, float amplitude, float frequency, uint64_t duration_ns)
+{
+    if (subaction >= haptics->subaction_count || amplitude <= 0.0f || duration_ns == 0)
+    {
+        return;
+    }
+
+    haptics_effect_t request = {
+        .amplitude = amplitude > 1.0f ? 1.0f : amplitude,
+        .frequency = frequency,
+        .end_ns = clock_ns() + duration_ns,
+    };
+
+    SDL_LockMutex(haptics->mutex);
+    merge_effect(&haptics->channels[subaction].pending, &request);
+    haptics->requests++;
+    SDL_UnlockMutex(haptics->mutex);
+}
+
+static void apply_effect(haptics_t *haptics, uint32_t subaction, uint64_t now_ns)
+{
+    haptics_channel_t *channel = &haptics->channels[subaction];
+    uint64_t duration_ns = channel->effect.end_ns - now_ns;
+    duration_ns = duration_ns > HAPTICS_BATCH_NS ? duration_ns : HAPTICS_BATCH_NS;
+
+    XrHapticVibration vibration = {
+        .type = XR_TYPE_HAPTIC_VIBRATION,
+        .amplitude = channel->effect.amplitude,
+        .duration = (XrDuration)duration_ns,
+        .frequency = channel->effect.frequency,
+    };
+    XrHapticActionInfo action_info = {
+        .type = XR_TYPE_HAPTIC_ACTION_INFO,
+        .action = haptics->action,
+        .subactionPath = haptics->subaction_paths[subaction],
+    };
+
+    haptics->applies++;
+    if (xrApplyHapticFeedback(haptics->session, &action_info, (const XrHapticBaseHeader *)&vibration) != XR_SUCCESS)
+    {
+        haptics->failures++;
+    }
+    channel->sent_end_ns = now_ns + duration_ns;
+}
+
+static void stop_effect(haptics_t *haptics, uint32_t subaction, uint64_t now_ns)
+{
+    haptics_channel_t *channel = &haptics->channels[subaction];
+
+    // a vibration that already ran out needs no call
+    if (channel->sent_end_ns > now_ns)
+    {
+        XrHapticActionInfo action_info = {
+            .type = XR_TYPE_HAPTIC_ACTION_INFO,
+            .action = haptics->action,
+            .subactionPath = haptics->subaction_paths[subaction],
+        };
+
+        haptics->stops++;
+        if (xrStopHapticFeedback(haptics->session, &action_info) != XR_SUCCESS)
+        {
+            haptics->failures++;
+        }
+    }
+
+    memset(&channel->effect, 0, sizeof(channel->effect));
+    channel->sent_end_ns = 0;
+}
+
+void haptics_update(haptics_t *haptics)
+{
+    haptics_effect_t pending[HAPTICS_MAX_SUBACTIONS];
+    SDL_LockMutex(haptics->mutex);
+    for (uint32_t i = 0; i < haptics->subaction_count; i++)
+    {
+        pending[i] = haptics->channels[i].pending;
+        memset(&haptics->channels[i].pending, 0, sizeof(haptics->channels[i].pending));
+    }
+    SDL_UnlockMutex(haptics->mutex);
+
+    uint64_t now_ns = clock_ns();
+    for (uint32_t i = 0; i < haptics->subaction_count; i++)
+    {
+        haptics_effect_t *effect = &haptics->channels[i].effect;
+
+        int changed = 0;
+        if (pending[i].end_ns > now_ns)
+        {
+            if (effect->end_ns <= now_ns)
+            {
+                // nothing left of the playing effect to merge with
+                *effect = pending[i];
+                changed = 1;
+            }
+            else
+            {
+                changed = merge_effect(effect, &pending[i]);
+            }
+        }
+
+        if (effect->end_ns > now_ns)
+        {
+            // extending the effect only costs a call once it outlasts the batch already sent
+            if (changed || effect->end_ns > haptics->channels[i].sent_end_ns)
+            {
+                apply_effect(haptics, i, now_ns);
+            }
+        }
+        else if (effect->end_ns != 0)
+        {
+            stop_effect(haptics, i, now_ns);
+        }
+    }
+}
+
+void haptics_stop(haptics_t *haptics)
+{
+    SDL_LockMutex(haptics->mutex);
+    for (uint32_t i = 0; i < haptics->subaction_count; i++)
+    {
+        memset(&haptics->channels[i].pending, 0, sizeof(haptics->channels[i].pending));
+    }
+    SDL_UnlockMutex(haptics->mutex);
+
+    uint64_t now_ns = clock_ns();
+    for (uint32_t i = 0; i < haptics->subaction_count; i++)
+    {
+        if (haptics->channels[i].effect.end_ns != 0)
+        {
+            stop_effect(haptics, i, now_ns);
+        }
+    }
+}
+
+void haptics_print_stats(const haptics_t *haptics)
+{
+    if (haptics->requests == 0)
+    {
+        return;
+    }
+
+    printf("Haptics: %llu requests sent as %llu vibrations and %llu stops, %llu failed\n",
+           (unsigned long long)haptics->requests, (unsigned long long)haptics->applies,
+           (unsigned long long)haptics->stops, (unsigned long long)haptics->failures);
+}
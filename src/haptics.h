@@ -0,0 +1,62 @@
+#ifndef HAPTICS_H
+#define HAPTICS_H
+
+#include <stdint.h>
+
+#include "SDL2/SDL.h"
+#include "openxr/openxr.h"
+
+#define HAPTICS_MAX_SUBACTIONS 2
+// A vibration that keeps being asked for is sent this far ahead, so a held effect costs one
+// runtime call per batch rather than one per frame
+#define HAPTICS_BATCH_NS 100000000ull
+
+// One vibration, or the merge of every request overlapping it
+typedef struct haptics_effect_t
+{
+    float amplitude;
+    float frequency; // XR_FREQUENCY_UNSPECIFIED or Hz
+    uint64_t end_ns; // clock_ns() it should stop at, 0 for none
+} haptics_effect_t;
+
+typedef struct haptics_channel_t
+{
+    haptics_effect_t pending; // requested since the last update, guarded by the mutex
+    haptics_effect_t effect;  // playing
+    uint64_t sent_end_ns;     // the runtime stops on its own here
+} haptics_channel_t;
+
+// Vibrations on one haptic output action, one channel per subaction path. Any thread may ask
+// for one; requests overlapping the playing effect are merged into it, the stronger amplitude
+// winning, and only a change reaches the runtime. The effect is stopped when the last request
+// runs out rather than when the batch sent ahead does.
+typedef struct haptics_t
+{
+    XrSession session;
+    XrAction action;
+    uint32_t subaction_count;
+    XrPath subaction_paths[HAPTICS_MAX_SUBACTIONS];
+    haptics_channel_t channels[HAPTICS_MAX_SUBACTIONS];
+    SDL_mutex *mutex;
+
+    uint64_t requests; // guarded by the mutex
+    uint64_t applies;
+    uint64_t stops;
+    uint64_t failures;
+} haptics_t;
+
+// Returns 0 and prints why on failure
+int haptics_init(haptics_t *haptics, XrSession session, XrAction action, const XrPath *subaction_paths, uint32_t subaction_count);
+void haptics_free(haptics_t *haptics);
+
+// Asks for a vibration on one subaction path from now on for duration_ns
+void haptics_request(haptics_t *haptics, uint32_t subaction, float amplitude, float frequency, uint64_t duration_ns);
+
+// Sends what changed since the last update to the runtime, call regularly from one thread
+void haptics_update(haptics_t *haptics);
+// Stops every effect, e.g. before the session ends
+void haptics_stop(haptics_t *haptics);
+
+void haptics_print_stats(const haptics_t *haptics);
+
+#endif
@@ -0,0 +1,256 @@
+#include "input.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+#include "cpu_profiler.h"
+
+// The atomic index of a triple buffer holds the newest slot, flagged until the reader takes it
+#define INPUT_SLOT_MASK 3
+#define INPUT_SLOT_FRESH 4
+
+// Publishes the written slot as the newest, returns the slot to write next
+static int publish_slot(SDL_atomic_t *latest, int written)
+{
+    return SDL_AtomicSet(latest, written | INPUT_SLOT_FRESH) & INPUT_SLOT_MASK;
+}
+
+// Takes the newest slot if it is one the reader has not seen, returns the slot to read
+static int take_slot(SDL_atomic_t *latest, int reading)
+{
+    if ((SDL_AtomicGet(latest) & INPUT_SLOT_FRESH) == 0)
+    {
+        return reading;
+    }
+    return SDL_AtomicSet(latest, reading) & INPUT_SLOT_MASK;
+}
+
+void input_init(input_t *input, XrSession session, XrActionSet action_set, XrSpace base_space, const XrPath *subaction_paths, uint32_t subaction_count)
+{
+    memset(input, 0, sizeof(*input));
+    input->session = session;
+    input->action_set = action_set;
+    input->base_space = base_space;
+    input->subaction_count = subaction_count < INPUT_MAX_SUBACTIONS ? subaction_count : INPUT_MAX_SUBACTIONS;
+    memcpy(input->subaction_paths, subaction_paths, input->subaction_count * sizeof(XrPath));
+
+    // each side starts with a slot of its own, the third is the newest
+    input->sample_slot = 0;
+    input->read_slot = 1;
+    SDL_AtomicSet(&input->latest_snapshot, 2);
+    input->frame_time_write_slot = 0;
+    input->frame_time_read_slot = 1;
+    SDL_AtomicSet(&input->latest_frame_time, 2);
+}
+
+int input_add_float_action(input_t *input, XrAction action)
+{
+    if (input->float_count == INPUT_MAX_FLOAT_ACTIONS)
+    {
+        return -1;
+    }
+
+    input->float_actions[input->float_count] = action;
+    return (int)input->float_count++;
+}
+
+int input_add_pose_action(input_t *input, XrAction action, const XrSpace *spaces)
+{
+    if (input->pose_count == INPUT_MAX_POSE_ACTIONS)
+    {
+        return -1;
+    }
+
+    input->pose_actions[input->pose_count] = action;
+    memcpy(input->pose_spaces[input->pose_count], spaces, input->subaction_count * sizeof(XrSpace));
+    return (int)input->pose_count++;
+}
+
+void input_sample(input_t *input, XrTime pose_time)
+{
+    uint64_t start_ns = clock_ns();
+    input_snapshot_t *snapshot = &input->snapshots[input->sample_slot];
+
+    const XrActiveActionSet active_action_set = {
+        .actionSet = input->action_set,
+        .subactionPath = XR_NULL_PATH,
+    };
+    XrActionsSyncInfo sync_info = {
+        .type = XR_TYPE_ACTIONS_SYNC_INFO,
+        .countActiveActionSets = 1,
+        .activeActionSets = &active_action_set,
+    };
+    snapshot->synced = xrSyncActions(input->session, &sync_info) == XR_SUCCESS;
+    if (!snapshot->synced)
+    {
+        input->sync_failures++;
+    }
+
+    snapshot->sequence = ++input->sequence;
+    snapshot->sampled_ns = start_ns;
+    snapshot->pose_time = pose_time;
+
+    // a failed query reads as an inactive action or an untracked pose
+    for (uint32_t s = 0; s < input->subaction_count; s++)
+    {
+        for (uint32_t a = 0; a < input->float_count; a++)
+        {
+            XrActionStateGetInfo get_info = {
+                .type = XR_TYPE_ACTION_STATE_GET_INFO,
+                .action = input->float_actions[a],
+                .subactionPath = input->subaction_paths[s],
+            };
+            XrActionStateFloat *value = &snapshot->floats[a][s];
+            *value = (XrActionStateFloat){.type = XR_TYPE_ACTION_STATE_FLOAT};
+            if (xrGetActionStateFloat(input->session, &get_info, value) != XR_SUCCESS)
+            {
+                *value = (XrActionStateFloat){.type = XR_TYPE_ACTION_STATE_FLOAT};
+            }
+        }
+
+        for (uint32_t a = 0; a < input->pose_count; a++)
+        {
+            XrActionStateGetInfo get_info = {
+                .type = XR_TYPE_ACTION_STATE_GET_INFO,
+                .action = input->pose_actions[a],
+                .subactionPath = input->subaction_paths[s],
+            };
+            XrActionStatePose *pose = &snapshot->poses[a][s];
+            *pose = (XrActionStatePose){.type = XR_TYPE_ACTION_STATE_POSE};
+            if (xrGetActionStatePose(input->session, &get_info, pose) != XR_SUCCESS)
+            {
+                pose->isActive = XR_FALSE;
+            }
+
+            XrSpaceLocation *location = &snapshot->locations[a][s];
+            *location = (XrSpaceLocation){.type = XR_TYPE_SPACE_LOCATION};
+            if (xrLocateSpace(input->pose_spaces[a][s], input->base_space, pose_time, location) != XR_SUCCESS)
+            {
+                location->locationFlags = 0;
+            }
+        }
+    }
+
+    uint64_t sample_ns = clock_ns() - start_ns;
+    input->samples++;
+    input->sample_total_ns += sample_ns;
+    input->sample_max_ns = sample_ns > input->sample_max_ns ? sample_ns : input->sample_max_ns;
+
+    input->sample_slot = publish_slot(&input->latest_snapshot, input->sample_slot);
+}
+
+static int input_thread_main(void *data)
+{
+    input_t *input = data;
+    cpu_profiler_thread_name("input");
+
+    uint64_t next_ns = clock_ns();
+    while (SDL_AtomicGet(&input->running))
+    {
+        input->frame_time_read_slot = take_slot(&input->latest_frame_time, input->frame_time_read_slot);
+        const input_frame_time_t *frame_time = &input->frame_times[input->frame_time_read_slot];
+
+        // nothing to predict poses for before the first frame
+        if (frame_time->display_time != 0)
+        {
+            cpu_zone_begin("input sample", -1);
+            input_sample(input, frame_time->display_time + (XrTime)(clock_ns() - frame_time->set_ns));
+            cpu_zone_end();
+        }
+
+        if (input->tick_callback)
+        {
+            input->tick_callback(input->tick_data);
+        }
+
+        // a late sample moves the schedule rather than being made up for with a burst
+        next_ns += input->interval_ns;
+        uint64_t now_ns = clock_ns();
+        if (next_ns > now_ns)
+        {
+            SDL_Delay((Uint32)((next_ns - now_ns + 500000) / 1000000));
+        }
+        else
+        {
+            next_ns = now_ns;
+        }
+    }
+    return 0;
+}
+
+int input_start(input_t *input, int rate_hz)
+{
+    rate_hz = rate_hz < 1 ? 1 : (rate_hz > 1000 ? 1000 : rate_hz);
+    input->interval_ns = 1000000000ull / (uint64_t)rate_hz;
+
+    SDL_AtomicSet(&input->running, 1);
+    input->thread = SDL_CreateThread(input_thread_main, "input", input);
+    if (!input->thread)
+    {
+        printf("Failed to create input thread: %s\n", SDL_GetError());
+        SDL_AtomicSet(&input->running, 0);
+        return 0;
+    }
+
+    printf("Sampling input at %d Hz on its own thread\n", rate_hz);
+    return 1;
+}
+
+void input_set_tick_callback(input_t *input, input_tick_callback_t callback, void *data)
+{
+    input->tick_callback = callback;
+    input->tick_data = data;
+}
+
+void input_stop(input_t *input)
+{
+    if (!input->thread)
+    {
+        return;
+    }
+
+    SDL_AtomicSet(&input->running, 0);
+    SDL_WaitThread(input->thread, NULL);
+    input->thread = NULL;
+}
+
+void input_set_frame_time(input_t *input, XrTime display_time)
+{
+    input_frame_time_t *frame_time = &input->frame_times[input->frame_time_write_slot];
+    frame_time->display_time = display_time;
+    frame_time->set_ns = clock_ns();
+    input->frame_time_write_slot = publish_slot(&input->latest_frame_time, input->frame_time_write_slot);
+}
+
+const input_snapshot_t *input_read(input_t *input)
+{
+    input->read_slot = take_slot(&input->latest_snapshot, input->read_slot);
+    const input_snapshot_t *snapshot = &input->snapshots[input->read_slot];
+
+    if (snapshot->sequence != 0)
+    {
+        uint64_t age_ns = clock_ns() - snapshot->sampled_ns;
+        input->reads++;
+        input->age_total_ns += age_ns;
+        input->age_max_ns = age_ns > input->age_max_ns ? age_ns : input->age_max_ns;
+    }
+    return snapshot;
+}
+
+void input_print_stats(const input_t *input)
+{
+    if (input->samples == 0)
+    {
+        return;
+    }
+
+    printf("Input: %llu samples, %llu not synced, %.3f ms per sample avg, %.3f ms max\n",
+           (unsigned long long)input->samples, (unsigned long long)input->sync_failures,
+           input->sample_total_ns / 1e6 / input->samples, input->sample_max_ns / 1e6);
+    if (input->reads)
+    {
+        printf("\tsnapshots read %llu times, %.3f ms old on average, %.3f ms at most\n",
+               (unsigned long long)input->reads, input->age_total_ns / 1e6 / input->reads, input->age_max_ns / 1e6);
+    }
+}
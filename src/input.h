@@ -0,0 +1,113 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+
+#include "SDL2/SDL.h"
+#include "openxr/openxr.h"
+
+#define INPUT_MAX_SUBACTIONS 2
+#define INPUT_MAX_FLOAT_ACTIONS 4
+#define INPUT_MAX_POSE_ACTIONS 4
+
+// Every action value of one xrSyncActions, per subaction path, and the pose action spaces
+// located at one time. A snapshot is never written once it is published.
+typedef struct input_snapshot_t
+{
+    uint64_t sequence;   // 0 before the first sample
+    uint64_t sampled_ns; // clock_ns() at xrSyncActions
+    XrTime pose_time;    // the poses are predicted for this time
+    int synced;          // xrSyncActions returned XR_SUCCESS, the values are current
+    XrActionStateFloat floats[INPUT_MAX_FLOAT_ACTIONS][INPUT_MAX_SUBACTIONS];
+    XrActionStatePose poses[INPUT_MAX_POSE_ACTIONS][INPUT_MAX_SUBACTIONS];
+    XrSpaceLocation locations[INPUT_MAX_POSE_ACTIONS][INPUT_MAX_SUBACTIONS];
+} input_snapshot_t;
+
+// Called on the sampling thread once per tick, for other work that should leave the frame loop
+typedef void (*input_tick_callback_t)(void *data);
+
+// Display times the sampling thread predicts its poses from
+typedef struct input_frame_time_t
+{
+    XrTime display_time;
+    uint64_t set_ns;
+} input_frame_time_t;
+
+// Samples the actions of one action set into snapshots, either when the simulation asks or on
+// a thread of its own at a fixed rate. Snapshots are triple buffered between the one thread
+// that samples and the one that reads: each side owns a slot and swaps it with the newest
+// through an atomic index, so neither ever waits for the other and a read never sees a
+// snapshot that is half written.
+typedef struct input_t
+{
+    XrSession session;
+    XrActionSet action_set;
+    XrSpace base_space;
+    uint32_t subaction_count;
+    XrPath subaction_paths[INPUT_MAX_SUBACTIONS];
+    uint32_t float_count;
+    XrAction float_actions[INPUT_MAX_FLOAT_ACTIONS];
+    uint32_t pose_count;
+    XrAction pose_actions[INPUT_MAX_POSE_ACTIONS];
+    XrSpace pose_spaces[INPUT_MAX_POSE_ACTIONS][INPUT_MAX_SUBACTIONS];
+
+    input_snapshot_t snapshots[3];
+    SDL_atomic_t latest_snapshot;
+    int sample_slot; // owned by the sampling side
+    int read_slot;   // owned by the reading side
+    uint64_t sequence;
+
+    // the reading side's newest display time, for the sampling thread
+    input_frame_time_t frame_times[3];
+    SDL_atomic_t latest_frame_time;
+    int frame_time_write_slot;
+    int frame_time_read_slot;
+
+    SDL_Thread *thread;
+    SDL_atomic_t running;
+    uint64_t interval_ns;
+    input_tick_callback_t tick_callback;
+    void *tick_data;
+
+    // sampling side statistics
+    uint64_t samples;
+    uint64_t sync_failures;
+    uint64_t sample_total_ns;
+    uint64_t sample_max_ns;
+
+    // reading side statistics, the age of a snapshot when it is read
+    uint64_t reads;
+    uint64_t age_total_ns;
+    uint64_t age_max_ns;
+} input_t;
+
+// The subaction paths are the ones every action is read for, e.g. the two hands
+void input_init(input_t *input, XrSession session, XrActionSet action_set, XrSpace base_space, const XrPath *subaction_paths, uint32_t subaction_count);
+
+// Return the index of the action in the snapshot arrays, or -1 if there is no room. A pose
+// action takes one action space per subaction path. Add every action before sampling starts.
+int input_add_float_action(input_t *input, XrAction action);
+int input_add_pose_action(input_t *input, XrAction action, const XrSpace *spaces);
+
+// Syncs the actions, reads them all, locates the poses at pose_time and publishes the result.
+// Call from the simulation thread, or let input_start() call it.
+void input_sample(input_t *input, XrTime pose_time);
+
+// Samples rate_hz times a second on a new thread, at most 1000. The poses are predicted as far
+// ahead of each sample as the last display time given to input_set_frame_time() was ahead of
+// the call. Returns 0 if the thread could not be created.
+int input_start(input_t *input, int rate_hz);
+// Set before input_start(), the callback then runs on every tick of the thread
+void input_set_tick_callback(input_t *input, input_tick_callback_t callback, void *data);
+// Waits for the sampling thread to finish, call before the session is destroyed
+void input_stop(input_t *input);
+
+// The reading side's display time, call once per frame after xrWaitFrame when sampling on a thread
+void input_set_frame_time(input_t *input, XrTime display_time);
+
+// The newest published snapshot, valid until the next call
+const input_snapshot_t *input_read(input_t *input);
+
+void input_print_stats(const input_t *input);
+
+#endif
@@ -0,0 +1,87 @@
+#include "instancing.h"
+
+#include <stddef.h>
+#include <string.h>
+
+void instance_batch_init(instance_batch_t *batch, uint32_t capacity)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->capacity = capacity;
+}
+
+void instance_batch_bind_attributes(void)
+{
+    // a mat4 attribute is fed as four vec4 columns
+    for (int i = 0; i < 4; i++)
+    {
+        GLuint location = INSTANCE_MODEL_LOCATION + i;
+        glVertexAttribFormat(location, 4, GL_FLOAT, GL_FALSE, offsetof(instance_data_t, model) + i * 4 * sizeof(float));
+        glVertexAttribBinding(location, INSTANCE_BUFFER_BINDING);
+        glEnableVertexAttribArray(location);
+    }
+
+    glVertexAttribFormat(INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, offsetof(instance_data_t, color));
+    glVertexAttribBinding(INSTANCE_COLOR_LOCATION, INSTANCE_BUFFER_BINDING);
+    glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+
+    glVertexBindingDivisor(INSTANCE_BUFFER_BINDING, 1);
+}
+
+int instance_batch_begin(instance_batch_t *batch, gpu_ring_t *ring)
+{
+    batch->count = 0;
+    batch->instances = NULL;
+
+    gpu_ring_alloc_t alloc;
+    if (!gpu_ring_alloc(ring, batch->capacity * sizeof(instance_data_t), 16, &alloc))
+    {
+        return 0;
+    }
+
+    batch->instances = alloc.ptr;
+    batch->buffer = ring->buffer;
+    batch->offset = alloc.offset;
+    return 1;
+}
+
+instance_data_t *instance_batch_push(instance_batch_t *batch)
+{
+    if (!batch->instances || batch->count == batch->capacity)
+    {
+        return NULL;
+    }
+
+    return &batch->instances[batch->count++];
+}
+
+uint32_t instance_batch_push_array(instance_batch_t *batch, const instance_data_t *instances, uint32_t count)
+{
+    if (!batch->instances)
+    {
+        return 0;
+    }
+
+    uint32_t space = batch->capacity - batch->count;
+    count = count < space ? count : space;
+    memcpy(&batch->instances[batch->count], instances, count * sizeof(instance_data_t));
+    batch->count += count;
+    return count;
+}
+
+void instance_batch_draw(instance_batch_t *batch, const mesh_t *mesh)
+{
+    instance_batch_draw_range(batch, mesh, 0, batch->count);
+}
+
+void instance_batch_draw_range(instance_batch_t *batch, const mesh_t *mesh, uint32_t first, uint32_t count)
+{
+    if (count == 0 || first + count > batch->count)
+    {
+        return;
+    }
+
+    // offsetting the binding instead of a base instance keeps this at GL 4.3
+    mesh_bind(mesh);
+    glBindVertexBuffer(INSTANCE_BUFFER_BINDING, batch->buffer, batch->offset + first * sizeof(instance_data_t), sizeof(instance_data_t));
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->index_count, mesh->index_type, NULL, count);
+}
@@ -0,0 +1,52 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <stdint.h>
+
+#include "glad/glad.h"
+#include "gpu_ring.h"
+#include "mesh.h"
+
+// Vertex attribute locations used by the per-instance data, a mat4 takes four locations
+#define INSTANCE_MODEL_LOCATION 6
+#define INSTANCE_COLOR_LOCATION 10
+// Vertex buffer binding the instance attributes read from, the mesh attributes use their own
+#define INSTANCE_BUFFER_BINDING 1
+
+// Per-instance data as laid out in the instance buffer.
+// A color of (0, 0, 0) is replaced by the mesh UV color in the shader.
+typedef struct instance_data_t
+{
+    float model[16];
+    float color[4];
+} instance_data_t;
+
+// Instances of one mesh, written straight into a frame's region of the GPU ring.
+// Fill it once per frame, then draw it in every render pass.
+typedef struct instance_batch_t
+{
+    uint32_t capacity;
+    uint32_t count;
+    instance_data_t *instances; // write-only mapped memory, build instances locally and copy them in
+    GLuint buffer;
+    GLintptr offset;
+} instance_batch_t;
+
+void instance_batch_init(instance_batch_t *batch, uint32_t capacity);
+
+// Sets up the per-instance attributes of the currently bound vertex array
+void instance_batch_bind_attributes(void);
+
+// Allocates room for capacity instances from this frame's ring region, returns 0 if it is full
+int instance_batch_begin(instance_batch_t *batch, gpu_ring_t *ring);
+// Returns the next free instance, or NULL if the batch is full
+instance_data_t *instance_batch_push(instance_batch_t *batch);
+// Copies in instances built elsewhere with one memcpy, returns how many fit
+uint32_t instance_batch_push_array(instance_batch_t *batch, const instance_data_t *instances, uint32_t count);
+
+// Draws every instance of the mesh with one call, the mesh is bound to the current vertex array
+void instance_batch_draw(instance_batch_t *batch, const mesh_t *mesh);
+// Draws count instances starting at first, e.g. the ones visible in one view
+void instance_batch_draw_range(instance_batch_t *batch, const mesh_t *mesh, uint32_t first, uint32_t count);
+
+#endif
@@ -0,0 +1,361 @@
+#include "json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Deepest nesting accepted, guards the recursive parser against hostile input
+#define JSON_MAX_DEPTH 64
+
+typedef struct json_parser_t
+{
+    json_t *json;
+    const char *text;
+    size_t length;
+    size_t pos;
+} json_parser_t;
+
+static void skip_whitespace(json_parser_t *p)
+{
+    while (p->pos < p->length && (p->text[p->pos] == ' ' || p->text[p->pos] == '\t' || p->text[p->pos] == '\n' || p->text[p->pos] == '\r'))
+    {
+        p->pos++;
+    }
+}
+
+static int add_token(json_parser_t *p, json_type_t type, uint32_t start)
+{
+    json_t *json = p->json;
+    if (json->count == json->capacity)
+    {
+        uint32_t capacity = json->capacity ? json->capacity * 2 : 256;
+        json_token_t *tokens = realloc(json->tokens, capacity * sizeof(json_token_t));
+        if (!tokens)
+        {
+            return -1;
+        }
+        json->tokens = tokens;
+        json->capacity = capacity;
+    }
+
+    json->tokens[json->count] = (json_token_t){.type = type, .start = start};
+    return (int)json->count++;
+}
+
+static int parse_value(json_parser_t *p, int depth);
+
+static int parse_string(json_parser_t *p)
+{
+    // opening quote already checked
+    p->pos++;
+    int token = add_token(p, JSON_STRING, (uint32_t)p->pos);
+    if (token < 0)
+    {
+        return 0;
+    }
+
+    while (p->pos < p->length && p->text[p->pos] != '"')
+    {
+        if (p->text[p->pos] == '\\')
+        {
+            p->pos++;
+        }
+        p->pos++;
+    }
+
+    if (p->pos >= p->length)
+    {
+        return 0;
+    }
+
+    json_token_t *t = &p->json->tokens[token];
+    t->length = (uint32_t)(p->pos - t->start);
+    t->next = token + 1;
+    p->pos++;
+    return 1;
+}
+
+static int parse_container(json_parser_t *p, int depth, json_type_t type)
+{
+    char close = type == JSON_OBJECT ? '}' : ']';
+    int token = add_token(p, type, (uint32_t)p->pos);
+    if (token < 0)
+    {
+        return 0;
+    }
+    p->pos++;
+
+    uint32_t count = 0;
+    skip_whitespace(p);
+    if (p->pos < p->length && p->text[p->pos] == close)
+    {
+        p->pos++;
+    }
+    else
+    {
+        for (;;)
+        {
+            skip_whitespace(p);
+            if (type == JSON_OBJECT)
+            {
+                if (p->pos >= p->length || p->text[p->pos] != '"' || !parse_string(p))
+                {
+                    return 0;
+                }
+
+                skip_whitespace(p);
+                if (p->pos >= p->length || p->text[p->pos] != ':')
+                {
+                    return 0;
+                }
+                p->pos++;
+            }
+
+            if (!parse_value(p, depth + 1))
+            {
+                return 0;
+            }
+            count++;
+
+            skip_whitespace(p);
+            if (p->pos < p->length && p->text[p->pos] == ',')
+            {
+                p->pos++;
+                continue;
+            }
+            if (p->pos < p->length && p->text[p->pos] == close)
+            {
+                p->pos++;
+                break;
+            }
+            return 0;
+        }
+    }
+
+    json_token_t *t = &p->json->tokens[token];
+    t->count = count;
+    t->length = (uint32_t)(p->pos - t->start);
+    t->next = p->json->count;
+    return 1;
+}
+
+static int parse_literal(json_parser_t *p, json_type_t type, const char *literal)
+{
+    size_t length = strlen(literal);
+    if (p->pos + length > p->length || memcmp(&p->text[p->pos], literal, length) != 0)
+    {
+        return 0;
+    }
+
+    int token = add_token(p, type, (uint32_t)p->pos);
+    if (token < 0)
+    {
+        return 0;
+    }
+
+    p->json->tokens[token].length = (uint32_t)length;
+    p->json->tokens[token].next = token + 1;
+    p->pos += length;
+    return 1;
+}
+
+static int parse_number(json_parser_t *p)
+{
+    size_t start = p->pos;
+    while (p->pos < p->length && strchr("+-0123456789.eE", p->text[p->pos]))
+    {
+        p->pos++;
+    }
+
+    if (p->pos == start)
+    {
+        return 0;
+    }
+
+    int token = add_token(p, JSON_NUMBER, (uint32_t)start);
+    if (token < 0)
+    {
+        return 0;
+    }
+
+    p->json->tokens[token].length = (uint32_t)(p->pos - start);
+    p->json->tokens[token].next = token + 1;
+    return 1;
+}
+
+static int parse_value(json_parser_t *p, int depth)
+{
+    if (depth > JSON_MAX_DEPTH)
+    {
+        return 0;
+    }
+
+    skip_whitespace(p);
+    if (p->pos >= p->length)
+    {
+        return 0;
+    }
+
+    switch (p->text[p->pos])
+    {
+    case '{':
+        return parse_container(p, depth, JSON_OBJECT);
+    case '[':
+        return parse_container(p, depth, JSON_ARRAY);
+    case '"':
+        return parse_string(p);
+    case 't':
+        return parse_literal(p, JSON_BOOL, "true");
+    case 'f':
+        return parse_literal(p, JSON_BOOL, "false");
+    case 'n':
+        return parse_literal(p, JSON_NULL, "null");
+    default:
+        return parse_number(p);
+    }
+}
+
+int json_parse(json_t *json, const char *text, size_t length)
+{
+    memset(json, 0, sizeof(*json));
+    json->text = text;
+
+    json_parser_t parser = {.json = json, .text = text, .length = length};
+    if (!parse_value(&parser, 0))
+    {
+        json_free(json);
+        return 0;
+    }
+
+    return 1;
+}
+
+void json_free(json_t *json)
+{
+    free(json->tokens);
+    memset(json, 0, sizeof(*json));
+}
+
+int json_find(const json_t *json, int object, const char *key)
+{
+    if (object < 0 || json->tokens[object].type != JSON_OBJECT)
+    {
+        return -1;
+    }
+
+    size_t key_length = strlen(key);
+    uint32_t t = object + 1;
+    for (uint32_t i = 0; i < json->tokens[object].count; i++)
+    {
+        const json_token_t *k = &json->tokens[t];
+        if (k->length == key_length && memcmp(&json->text[k->start], key, key_length) == 0)
+        {
+            return (int)t + 1;
+        }
+        t = json->tokens[t + 1].next;
+    }
+
+    return -1;
+}
+
+int json_at(const json_t *json, int array, uint32_t index)
+{
+    if (array < 0 || json->tokens[array].type != JSON_ARRAY || index >= json->tokens[array].count)
+    {
+        return -1;
+    }
+
+    uint32_t t = array + 1;
+    for (uint32_t i = 0; i < index; i++)
+    {
+        t = json->tokens[t].next;
+    }
+    return (int)t;
+}
+
+double json_number(const json_t *json, int token, double fallback)
+{
+    if (token < 0)
+    {
+        return fallback;
+    }
+
+    const json_token_t *t = &json->tokens[token];
+    if (t->type == JSON_BOOL)
+    {
+        return json->text[t->start] == 't' ? 1.0 : 0.0;
+    }
+    if (t->type != JSON_NUMBER)
+    {
+        return fallback;
+    }
+
+    char number[64];
+    size_t length = t->length < sizeof(number) - 1 ? t->length : sizeof(number) - 1;
+    memcpy(number, &json->text[t->start], length);
+    number[length] = '\0';
+    return strtod(number, NULL);
+}
+
+double json_find_number(const json_t *json, int object, const char *key, double fallback)
+{
+    return json_number(json, json_find(json, object, key), fallback);
+}
+
+int json_string(const json_t *json, int token, char *out, size_t out_size)
+{
+    if (token < 0 || json->tokens[token].type != JSON_STRING || out_size == 0)
+    {
+        return 0;
+    }
+
+    const json_token_t *t = &json->tokens[token];
+    const char *s = &json->text[t->start];
+    size_t o = 0;
+    for (uint32_t i = 0; i < t->length; i++)
+    {
+        char c = s[i];
+        if (c == '\\' && i + 1 < t->length)
+        {
+            c = s[++i];
+            switch (c)
+            {
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'u':
+                // only ASCII code points are decoded, which is all paths and names need here
+                if (i + 4 < t->length)
+                {
+                    char hex[5] = {s[i + 1], s[i + 2], s[i + 3], s[i + 4], '\0'};
+                    long code = strtol(hex, NULL, 16);
+                    c = code < 0x80 ? (char)code : '?';
+                    i += 4;
+                }
+                break;
+            default: // '"', '\\' and '/' map to themselves
+                break;
+            }
+        }
+
+        if (o + 1 >= out_size)
+        {
+            return 0;
+        }
+        out[o++] = c;
+    }
+
+    out[o] = '\0';
+    return 1;
+}
@@ -0,0 +1,51 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal JSON reader, the text is tokenized into a flat array in document order and values
+// are looked up by token index. Strings are not unescaped until copied out.
+typedef enum json_type_t
+{
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+} json_type_t;
+
+typedef struct json_token_t
+{
+    json_type_t type;
+    uint32_t start;  // offset into the text, strings start after the opening quote
+    uint32_t length; // strings exclude the quotes
+    uint32_t count;  // array elements or object key/value pairs
+    uint32_t next;   // index of the first token after this value and all of its children
+} json_token_t;
+
+typedef struct json_t
+{
+    const char *text;
+    json_token_t *tokens;
+    uint32_t count;
+    uint32_t capacity;
+} json_t;
+
+// The text must outlive the json_t, token 0 is the root value
+int json_parse(json_t *json, const char *text, size_t length);
+void json_free(json_t *json);
+
+// Returns the value token for key in an object, or -1
+int json_find(const json_t *json, int object, const char *key);
+// Returns the token of an array element, or -1
+int json_at(const json_t *json, int array, uint32_t index);
+
+double json_number(const json_t *json, int token, double fallback);
+// Shorthand for json_number(json, json_find(json, object, key), fallback)
+double json_find_number(const json_t *json, int object, const char *key, double fallback);
+// Copies the unescaped string, returns 0 if the token is not a string or does not fit
+int json_string(const json_t *json, int token, char *out, size_t out_size);
+
+#endif
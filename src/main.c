@@ -1,69 +1,314 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+// Windows renders through an SDL window, Linux headless through EGL with XR_MNDX_egl_enable
+#ifdef _WIN32
 #define WIN_32_LEAN_AND_MEAN
 #include <windows.h>
-
 #define XR_USE_PLATFORM_WIN32
+#else
+#include <signal.h>
+#include <time.h>
+#include <EGL/egl.h>
+#define XR_USE_PLATFORM_EGL
+#define XR_USE_TIMESPEC
+#endif
+
 #define XR_USE_GRAPHICS_API_OPENGL
 #include "openxr/openxr.h"
 #include "openxr/openxr_platform.h"
 
 #include "glad/glad.h"
 #include "mathc.h"
+#include "mat4_simd.h"
+#include "instancing.h"
+#include "mesh.h"
+#include "mesh_file.h"
+#include "clock.h"
+#include "program.h"
+#include "gpu_ring.h"
+#include "gltf.h"
+#include "culling.h"
+#include "bvh.h"
+#include "gpu_timer.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "frame_pacing.h"
+#include "pose_trace.h"
+#include "frame_queue.h"
+#include "haptics.h"
+#include "input.h"
+#include "resolution.h"
+#include "view_cache.h"
+#include "egl_context.h"
 #include "SDL2/SDL.h"
+#ifdef _WIN32
 #include "SDL2/SDL_syswm.h"
+#endif
 
 // Capacities / Constants
 #define MAX_VIEWS 4
 #define MAX_FORMATS 32
 #define MAX_SWAPCHAIN_IMAGES 16
+#define MAX_ENABLED_EXTENSIONS 8
+
+// Render scale range of dynamic resolution, relative to the recommended image size
+#define MIN_RENDER_SCALE 0.5f
+#define MAX_RENDER_SCALE 1.5f
+
+// Upper bound of --cubes, every cube costs an instance in each frame packet and a BVH leaf
+#define MAX_CUBES 1000000
 
 #define HAND_LEFT_INDEX 0
 #define HAND_RIGHT_INDEX 1
 #define HAND_COUNT 2
 
-static void mat4_proj_xr(float result[16], XrFovf fov, float near_z, float far_z)
-{
-    const float tan_left = tanf(fov.angleLeft);
-    const float tan_right = tanf(fov.angleRight);
+#define FRAME_UNIFORMS_BINDING 0
 
-    const float tan_down = tanf(fov.angleDown);
-    const float tan_up = tanf(fov.angleUp);
+// GL_OVR_multiview2 is not part of the generated glad loader, so we fetch it ourselves
+typedef void(APIENTRYP PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews);
+static PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC glFramebufferTextureMultiviewOVR;
 
-    const float tan_width = tan_right - tan_left;
-    const float tan_height = (tan_up - tan_down);
+static void *gl_proc_address(const char *name)
+{
+#ifdef _WIN32
+    return SDL_GL_GetProcAddress(name);
+#else
+    return (void *)eglGetProcAddress(name);
+#endif
+}
 
-    const float offset_z = near_z;
+static int gl_extension_supported(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && strcmp(extension, name) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+// there is no window to close, Ctrl+C ends the session cleanly instead
+static volatile sig_atomic_t interrupted;
 
-    result[0] = 2 / tan_width;
-    result[4] = 0;
-    result[8] = (tan_right + tan_left) / tan_width;
-    result[12] = 0;
+static void on_interrupt(int signal_number)
+{
+    interrupted = 1;
+}
+#endif
 
-    result[1] = 0;
-    result[5] = 2 / tan_height;
-    result[9] = (tan_up + tan_down) / tan_height;
-    result[13] = 0;
+// Command line options
+typedef struct options_t
+{
+    int no_multiview; // force the per-view render path even if GL_OVR_multiview2 is available
+    int no_reverse_z; // use the standard [-1, 1] projection with a far plane
+    int no_dynamic_resolution; // always render the recommended image size
+    int no_quad_views; // render two stereo views even if the runtime offers foveated quad views
+    int cube_count;   // extra cubes spawned to stress the draw path
+    const char *mesh_path; // mesh file drawn in place of the cube
+    const char *gltf_path; // glTF model streamed in while the app runs
+    int upload_budget_kb;  // most model data uploaded per frame
+    const char *trace_path; // CPU profiler trace written at exit, F12 writes one any time
+    int frame_limit;        // frames before the app asks to exit, 0 runs until closed
+    const char *record_poses_path; // head and hand poses of every frame written here
+    const char *replay_poses_path; // poses read from here in place of tracking, exits at the end
+    int no_late_latch; // draw the controllers where the simulation thread located them
+    int input_rate;    // actions sampled this many times a second on their own thread, 0 once per frame
+} options_t;
+static options_t options = {.upload_budget_kb = 1024};
+
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [--no-multiview] [--no-reverse-z] [--no-dynamic-resolution] [--no-quad-views] [--no-late-latch] [--input-rate HZ] [--cubes N] [--mesh file.xrm] [--gltf file.glb] [--upload-budget KB] [--trace file.json] [--frames N] [--record-poses file.xpt] [--replay-poses file.xpt]\n", program);
+}
 
-    result[2] = 0;
-    result[6] = 0;
-    result[10] = -(far_z + offset_z) / (far_z - near_z);
-    result[14] = -(far_z * (near_z + offset_z)) / (far_z - near_z);
+static int parse_options(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--no-multiview") == 0)
+        {
+            options.no_multiview = 1;
+        }
+        else if (strcmp(argv[i], "--no-reverse-z") == 0)
+        {
+            options.no_reverse_z = 1;
+        }
+        else if (strcmp(argv[i], "--no-dynamic-resolution") == 0)
+        {
+            options.no_dynamic_resolution = 1;
+        }
+        else if (strcmp(argv[i], "--no-quad-views") == 0)
+        {
+            options.no_quad_views = 1;
+        }
+        else if (strcmp(argv[i], "--no-late-latch") == 0)
+        {
+            options.no_late_latch = 1;
+        }
+        else if (strcmp(argv[i], "--input-rate") == 0 && i + 1 < argc)
+        {
+            options.input_rate = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cubes") == 0 && i + 1 < argc)
+        {
+            char *end;
+            long cube_count = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || cube_count < 0 || cube_count > MAX_CUBES)
+            {
+                printf("--cubes takes a count from 0 to %d, not %s\n", MAX_CUBES, argv[i]);
+                print_usage(argv[0]);
+                return 0;
+            }
+            options.cube_count = (int)cube_count;
+        }
+        else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+        {
+            options.mesh_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--gltf") == 0 && i + 1 < argc)
+        {
+            options.gltf_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            options.frame_limit = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--record-poses") == 0 && i + 1 < argc)
+        {
+            options.record_poses_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay-poses") == 0 && i + 1 < argc)
+        {
+            options.replay_poses_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            options.trace_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--upload-budget") == 0 && i + 1 < argc)
+        {
+            options.upload_budget_kb = atoi(argv[++i]);
+            if (options.upload_budget_kb < 1)
+            {
+                options.upload_budget_kb = 1;
+            }
+        }
+        else
+        {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
 
-    result[3] = 0;
-    result[7] = 0;
-    result[11] = -1;
-    result[15] = 0;
+    if (options.record_poses_path && options.replay_poses_path)
+    {
+        printf("--record-poses and --replay-poses can not be used together\n");
+        return 0;
+    }
+    return 1;
 }
 
+// Per-frame shader data, std140 layout of the FrameData uniform block shared by all views
+typedef struct frame_uniforms_t
+{
+    float view[MAX_VIEWS][16];
+    float proj[MAX_VIEWS][16];
+    float time[4]; // x = predicted display time in seconds
+} frame_uniforms_t;
+
+// One being simulated, one queued and one being rendered
+#define FRAME_PACKETS 3
+
+// Everything the render thread needs for one frame, built by the simulation thread after
+// xrWaitFrame. Packets are reused, the render thread's results are read when one comes back.
+typedef struct frame_packet_t
+{
+    XrFrameState frame_state;
+    uint64_t frame_start_ns; // xrWaitFrame returned
+    XrViewState view_state;
+    XrView views[MAX_VIEWS];
+    frame_uniforms_t uniforms;
+
+    // visible instances, copied into the frame ring on the render thread
+    instance_data_t *instances;
+    uint32_t instance_count;
+    uint32_t view_first_instance[MAX_VIEWS];
+    uint32_t view_instance_count[MAX_VIEWS];
+
+    // the controller blocks among the instances, -1 if not drawn, and when their poses were located
+    int32_t hand_instances[HAND_COUNT];
+    uint64_t hand_located_ns; // 0 leaves them where they were located
+
+    // filled in by the render thread
+    int submitted;
+    uint64_t work_ns; // xrWaitFrame returning to xrEndFrame returning
+    uint64_t late_latch_ns; // how much newer the drawn controller poses are, 0 if not latched
+} frame_packet_t;
+
+// A scene object, culled by its bounding sphere before its instance is written
+typedef struct scene_object_t
+{
+    float position[3];
+    float orientation[4];
+    float scale[3];
+    float color[4];
+} scene_object_t;
+
 // Static application state
 typedef struct state_t
 {
+#ifdef _WIN32
     SDL_Window *desktop_window;
     SDL_GLContext *gl_context;
+#else
+    egl_context_t egl;
+#endif
 
     float near_z;
     float far_z;
+    int reverse_z;
+    float depth_near_z; // view distances at depth 0 and 1, for the compositor
+    float depth_far_z;
+    int depth_layer; // XR_KHR_composition_layer_depth is enabled, depth is submitted with each view
+
+    // swapchains are allocated at the largest render scale, each frame renders a sub-rectangle
+    uint32_t swapchain_widths[MAX_VIEWS];
+    uint32_t swapchain_heights[MAX_VIEWS];
+    int render_widths[MAX_VIEWS];
+    int render_heights[MAX_VIEWS];
+    gpu_timer_t gpu_timer;
+    gpu_profiler_t gpu_profiler;
+    resolution_t resolution;
+    double gpu_ms_total; // measured frames, to compare quad views against stereo
+    uint64_t gpu_frames;
+    double stereo_pixel_ratio; // pixels rendered per pixel a stereo view at focus density would need
+    frame_pacing_t pacing;
+    pose_trace_t pose_trace;
+
+    // the render thread owns the GL context and everything from xrBeginFrame to xrEndFrame
+    frame_packet_t packets[FRAME_PACKETS];
+    frame_queue_t ready_packets; // simulated, waiting to be rendered
+    frame_queue_t free_packets;  // rendered, waiting to be reused
+    frame_packet_t *building;    // the packet the simulation thread is filling
+    SDL_Thread *render_thread;
+    SDL_atomic_t render_failed;
+    size_t upload_budget;
+    uint64_t frames_submitted;
+
+    // controller poses located again on the render thread, see late_latch_hands()
+    int hand_objects[HAND_COUNT]; // scene objects of the controller blocks being built, -1 if none
+    uint64_t late_latch_frames;
+    uint64_t late_latch_total_ns;
+    uint64_t late_latch_max_ns;
 
     XrInstance instance;
     XrSystemId system_id;
@@ -72,10 +317,17 @@ typedef struct state_t
     XrSession session;
     XrSpace play_space;
 
+    // stereo, or with XR_VARJO_quad_views a wide context view and a high density focus view per eye
+    XrViewConfigurationType view_type;
     uint32_t view_count;
     XrViewConfigurationView view_confs[MAX_VIEWS];
     XrView views[MAX_VIEWS];
     XrCompositionLayerProjectionView proj_views[MAX_VIEWS];
+    view_cache_t view_cache;
+
+    // when set, a single array swapchain holds every view and each eye is one layer of it
+    int multiview;
+    GLuint mirror_framebuffer;
 
     uint32_t swapchain_count;
     XrSwapchain swapchains[MAX_VIEWS];
@@ -103,76 +355,224 @@ typedef struct state_t
 
     XrSpace hand_pose_spaces[HAND_COUNT];
 
-    GLuint shader;
+    // every frame reads its action values from one snapshot of these
+    input_t input;
+    int grab_input;
+    int hand_pose_input;
+    haptics_t haptics; // updated on the input thread when there is one
+
+    program_t program;
+    GLint view_index_location;
+    gpu_ring_t frame_ring;
     GLuint vao;
+    mesh_t cube_mesh;
+    instance_batch_t cubes;
+    gltf_stream_t gltf;
+    instance_batch_t models;
+
+    // the cube batch is built from the scene objects that survive culling, ordered so
+    // each view's visible instances are one contiguous range
+    cull_t cull;
+    scene_object_t *scene_objects;
+    uint32_t *scene_order; // visible objects sorted by the views they are visible in
+
+    // static stress test cubes, queried instead of scanned
+    bvh_t scene_bvh;
+    uint32_t *scene_query;
 } state_t;
 static state_t state;
 
-static void render_block(float position[3], float orientation[4], float radii[3], int modelLoc)
+static const float hand_colors[HAND_COUNT][4] = {
+    {1.0, 0.5, 0.5, 1.0},
+    {0.5, 1.0, 0.5, 1.0},
+};
+static const float hand_scale[3] = {.05f, .05f, .2f};
+
+// Position of stress test cube i in a lattice filling a 4m box around the play space center,
+// returns its size
+static float lattice_cube(int i, float position[3])
 {
-    float model[16];
-    float scale[16];
-    float rotation[16];
-    float translation[16];
-
-    mat4_identity(translation);
-    mat4_translation(translation, translation, position);
-    mat4_rotation_quat(rotation, orientation);
-    mat4_identity(scale);
-    mat4_scaling(scale, scale, radii);
-    mat4_multiply(model, rotation, scale);
-    mat4_multiply(model, translation, model);
-
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    int side = (int)ceilf(cbrtf((float)options.cube_count));
+    float spacing = 4.0f / side;
+    float offset = (side - 1) * spacing / 2.0f;
+
+    int x = i % side;
+    int y = (i / side) % side;
+    int z = i / (side * side);
+    position[0] = x * spacing - offset;
+    position[1] = 1.5f + y * spacing - offset;
+    position[2] = z * spacing - offset;
+    return spacing / 2.0f;
 }
 
-void render_rotated_cube(float position[3], float cube_size, float rot, int modelLoc)
+// Returns the scene object index, or -1 if the scene is full
+static int push_block(float position[3], float orientation[4], const float radii[3], const float color[4])
 {
-    float model[16];
-    float scale[16];
-    float rotation[16];
-    float translation[16];
-
-    mat4_identity(translation);
-    mat4_translation(translation, translation, position);
-    mat4_identity(rotation);
-    mat4_rotation_y(rotation, to_radians(rot));
-    mat4_identity(scale);
-    mat4_scaling(scale, scale, (float[3]){cube_size / 2.0f, cube_size / 2.0f, cube_size / 2.0f});
-    mat4_multiply(model, rotation, scale);
-    mat4_multiply(model, translation, model);
-
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    int index = cull_add_sphere(&state.cull, position, state.cube_mesh.radius * fmaxf(radii[0], fmaxf(radii[1], radii[2])));
+    if (index < 0)
+        return -1;
+
+    scene_object_t *object = &state.scene_objects[index];
+    memcpy(object->position, position, sizeof(object->position));
+    memcpy(object->orientation, orientation, sizeof(object->orientation));
+    memcpy(object->scale, radii, sizeof(object->scale));
+    memcpy(object->color, color, sizeof(object->color));
+    return index;
 }
 
-void render_frame(int w, int h, XrTime predictedDisplayTime, int view_index, XrSpaceLocation *hand_locations, float proj[16], float view[16], GLuint framebuffer, GLuint image, GLuint depthbuffer)
+static void push_rotated_cube(float position[3], float cube_size, float rot, const float color[4])
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    float orientation[4];
+    quat_from_axis_angle(orientation, (float[3]){0, 1, 0}, to_radians(rot));
+    push_block(position, orientation, (float[3]){cube_size / 2.0f, cube_size / 2.0f, cube_size / 2.0f}, color);
+}
 
-    glViewport(0, 0, w, h);
-    glScissor(0, 0, w, h);
+static void push_instance(uint32_t object_index)
+{
+    frame_packet_t *packet = state.building;
+    if (packet->instance_count == state.cubes.capacity)
+        return;
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthbuffer, 0);
+    for (int hand = 0; hand < HAND_COUNT; hand++)
+    {
+        if (state.hand_objects[hand] == (int)object_index)
+            packet->hand_instances[hand] = (int32_t)packet->instance_count;
+    }
 
-    glClearColor(0.2f, 0.0f, 0.2f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const scene_object_t *object = &state.scene_objects[object_index];
+    instance_data_t *instance = &packet->instances[packet->instance_count++];
+    mat4_trs(instance->model, object->position, object->orientation, object->scale);
+    memcpy(instance->color, object->color, sizeof(instance->color));
+}
 
-    glUseProgram(state.shader);
-    glBindVertexArray(state.vao);
+// Instances are grouped by the set of views that see them, in these orders, so every view's
+// instances form one range. Stereo is exact: left only, both, right only. Quad views are
+// left, right, left focus, right focus, and each focus view lies inside its eye's context
+// view, so only the right focus range also spans the few objects seen by both contexts alone.
+static const uint8_t stereo_mask_order[] = {1, 3, 2};
+static const uint8_t quad_mask_order[] = {1, 5, 7, 15, 3, 11, 10, 2};
+
+// Culls the scene objects and writes instances for the visible ones
+static void push_visible_objects(void)
+{
+    cull_run(&state.cull);
+
+    frame_packet_t *packet = state.building;
+
+    const uint8_t *masks = state.cull.view_masks;
+    uint32_t view_count = state.cull.view_count;
+    uint32_t mask_count = 1u << view_count;
+
+    if (state.multiview)
+    {
+        // one pass draws all views at once, so they share the union
+        for (uint32_t i = 0; i < state.cull.count; i++)
+        {
+            if (masks[i])
+                push_instance(i);
+        }
+
+        for (uint32_t v = 0; v < view_count; v++)
+        {
+            packet->view_first_instance[v] = 0;
+            packet->view_instance_count[v] = packet->instance_count;
+        }
+        return;
+    }
+
+    // the preferred order first, then any other combination of views
+    const uint8_t *order = view_count == 4 ? quad_mask_order : stereo_mask_order;
+    uint32_t order_count = view_count == 4 ? sizeof(quad_mask_order) : (view_count == 2 ? sizeof(stereo_mask_order) : 0);
+    uint8_t sequence[1 << CULL_MAX_VIEWS];
+    uint32_t sequence_count = 0;
+    uint8_t listed[1 << CULL_MAX_VIEWS] = {0};
+    for (uint32_t g = 0; g < order_count + mask_count; g++)
+    {
+        uint8_t mask = g < order_count ? order[g] : (uint8_t)(g - order_count);
+        if (mask != 0 && !listed[mask])
+        {
+            listed[mask] = 1;
+            sequence[sequence_count++] = mask;
+        }
+    }
+
+    // counting sort of the visible objects by group
+    uint32_t group_end[1 << CULL_MAX_VIEWS] = {0};
+    for (uint32_t i = 0; i < state.cull.count; i++)
+    {
+        group_end[masks[i]]++;
+    }
+
+    uint32_t group_start[1 << CULL_MAX_VIEWS];
+    uint32_t visible_count = 0;
+    for (uint32_t s = 0; s < sequence_count; s++)
+    {
+        group_start[sequence[s]] = visible_count;
+        visible_count += group_end[sequence[s]];
+        group_end[sequence[s]] = group_start[sequence[s]];
+    }
+
+    for (uint32_t i = 0; i < state.cull.count; i++)
+    {
+        if (masks[i])
+            state.scene_order[group_end[masks[i]]++] = i;
+    }
 
-    int modelLoc = glGetUniformLocation(state.shader, "model");
-    int colorLoc = glGetUniformLocation(state.shader, "uniformColor");
-    int viewLoc = glGetUniformLocation(state.shader, "view");
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view);
-    int projLoc = glGetUniformLocation(state.shader, "proj");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, proj);
+    for (uint32_t k = 0; k < visible_count; k++)
+    {
+        push_instance(state.scene_order[k]);
+    }
+
+    for (uint32_t v = 0; v < view_count; v++)
+    {
+        uint32_t first = UINT32_MAX;
+        uint32_t end = 0;
+        for (uint32_t s = 0; s < sequence_count; s++)
+        {
+            uint8_t mask = sequence[s];
+            if ((mask >> v) & 1 && group_end[mask] > group_start[mask])
+            {
+                first = group_start[mask] < first ? group_start[mask] : first;
+                end = group_end[mask] > end ? group_end[mask] : end;
+            }
+        }
+
+        // a full batch drops the tail
+        end = end < packet->instance_count ? end : packet->instance_count;
+        packet->view_first_instance[v] = first < end ? first : 0;
+        packet->view_instance_count[v] = first < end ? end - first : 0;
+    }
+}
+
+// Fills the packet's instances once per frame, every render pass then draws them with one call
+static void build_scene(frame_packet_t *packet, XrTime predictedDisplayTime, XrSpaceLocation *hand_locations)
+{
+    state.building = packet;
+    packet->instance_count = 0;
+    packet->hand_instances[HAND_LEFT_INDEX] = -1;
+    packet->hand_instances[HAND_RIGHT_INDEX] = -1;
+
+    cull_begin(&state.cull, state.views, state.view_count, state.near_z, state.far_z);
+
+    // each controller points at the first stress test cube along its -z axis
+    int hand_targets[HAND_COUNT] = {-1, -1};
+    for (int hand = 0; hand < HAND_COUNT && options.cube_count > 0; hand++)
+    {
+        if ((hand_locations[hand].locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) == 0)
+            continue;
+
+        const XrQuaternionf *q = &hand_locations[hand].pose.orientation;
+        float direction[3] = {
+            -2.0f * (q->x * q->z + q->w * q->y),
+            -2.0f * (q->y * q->z - q->w * q->x),
+            -(1.0f - 2.0f * (q->x * q->x + q->y * q->y)),
+        };
+        hand_targets[hand] = bvh_raycast(&state.scene_bvh, (float *)&hand_locations[hand].pose.position, direction, 10.0f, NULL);
+    }
 
     {
         // the special color value (0, 0, 0) will get replaced by some UV color in the shader
-        glUniform3f(colorLoc, 0.0, 0.0, 0.0);
+        const float uv_color[4] = {0.0, 0.0, 0.0, 1.0};
 
         double display_time_seconds = ((double)predictedDisplayTime) / (1000. * 1000. * 1000.);
         const float rotations_per_sec = .25;
@@ -180,25 +580,32 @@ void render_frame(int w, int h, XrTime predictedDisplayTime, int view_index, XrS
 
         float dist = 1.5f;
         float height = 0.5f;
-        render_rotated_cube((float[3]){0, height, -dist}, 0.33f, angle, modelLoc);
-        render_rotated_cube((float[3]){0, height, dist}, 0.33f, angle, modelLoc);
-        render_rotated_cube((float[3]){dist, height, 0}, 0.33f, angle, modelLoc);
-        render_rotated_cube((float[3]){-dist, height, 0}, 0.33f, angle, modelLoc);
-        render_rotated_cube((float[3]){0, height, 0}, 10.0f, 0, modelLoc);
+        push_rotated_cube((float[3]){0, height, -dist}, 0.33f, angle, uv_color);
+        push_rotated_cube((float[3]){0, height, dist}, 0.33f, angle, uv_color);
+        push_rotated_cube((float[3]){dist, height, 0}, 0.33f, angle, uv_color);
+        push_rotated_cube((float[3]){-dist, height, 0}, 0.33f, angle, uv_color);
+        push_rotated_cube((float[3]){0, height, 0}, 10.0f, 0, uv_color);
+
+        // stress test cubes, only the ones in the combined frustum reach the per-view test
+        if (options.cube_count > 0)
+        {
+            uint32_t candidate_count = bvh_query_frustum(&state.scene_bvh, &state.cull.combined, state.scene_query, (uint32_t)options.cube_count);
+            for (uint32_t c = 0; c < candidate_count; c++)
+            {
+                int i = (int)state.scene_query[c];
+                const float *color = i == hand_targets[0] ? hand_colors[0] : (i == hand_targets[1] ? hand_colors[1] : uv_color);
+
+                float position[3];
+                float size = lattice_cube(i, position);
+                push_rotated_cube(position, size, angle, color);
+            }
+        }
     }
 
-    // render controllers
+    // controllers
     for (int hand = 0; hand < 2; hand++)
     {
-        if (hand == 0)
-        {
-            glUniform3f(colorLoc, 1.0, 0.5, 0.5);
-        }
-        else
-        {
-            glUniform3f(colorLoc, 0.5, 1.0, 0.5);
-        }
-
+        state.hand_objects[hand] = -1;
         bool hand_location_valid =
             //(spaceLocation[hand].locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
             (hand_locations[hand].locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0;
@@ -207,15 +614,129 @@ void render_frame(int w, int h, XrTime predictedDisplayTime, int view_index, XrS
         if (!hand_location_valid)
             continue;
 
-        float scale[3] = {.05f, .05f, .2f};
-        render_block((float *)&hand_locations[hand].pose.position, (float *)&hand_locations[hand].pose.orientation, scale, modelLoc);
+        state.hand_objects[hand] = push_block((float *)&hand_locations[hand].pose.position, (float *)&hand_locations[hand].pose.orientation, hand_scale, hand_colors[hand]);
+    }
+
+    push_visible_objects();
+}
+
+// Prints the quad view pixels against stereo views as sharp as the focus views, which is what they save
+static void print_quad_view_pixels(void)
+{
+    double quad_pixels = 0.0;
+    double stereo_pixels = 0.0;
+    for (uint32_t eye = 0; eye < 2; eye++)
+    {
+        const XrFovf *context = &state.views[eye].fov;
+        const XrFovf *focus = &state.views[eye + 2].fov;
+        const XrViewConfigurationView *context_conf = &state.view_confs[eye];
+        const XrViewConfigurationView *focus_conf = &state.view_confs[eye + 2];
+
+        // pixels per unit of tangent on the focus image plane
+        double density_x = focus_conf->recommendedImageRectWidth / (tan(focus->angleRight) - tan(focus->angleLeft));
+        double density_y = focus_conf->recommendedImageRectHeight / (tan(focus->angleUp) - tan(focus->angleDown));
+        double stereo_width = density_x * (tan(context->angleRight) - tan(context->angleLeft));
+        double stereo_height = density_y * (tan(context->angleUp) - tan(context->angleDown));
+
+        quad_pixels += (double)context_conf->recommendedImageRectWidth * context_conf->recommendedImageRectHeight;
+        quad_pixels += (double)focus_conf->recommendedImageRectWidth * focus_conf->recommendedImageRectHeight;
+        stereo_pixels += stereo_width * stereo_height;
+
+        printf("Quad views, eye %u: context %ux%u + focus %ux%u, stereo at focus density %.0fx%.0f\n", eye,
+               context_conf->recommendedImageRectWidth, context_conf->recommendedImageRectHeight,
+               focus_conf->recommendedImageRectWidth, focus_conf->recommendedImageRectHeight, stereo_width, stereo_height);
+    }
+
+    state.stereo_pixel_ratio = stereo_pixels > 0.0 ? quad_pixels / stereo_pixels : 1.0;
+    printf("Quad views: %.1f Mpixels per frame against %.1f Mpixels for stereo, %.0f%%\n",
+           quad_pixels / 1e6, stereo_pixels / 1e6, 100.0 * state.stereo_pixel_ratio);
+}
+
+// Sets the rectangle rendered and submitted for every view to scale times the recommended size
+static void set_render_scale(float scale)
+{
+    for (uint32_t i = 0; i < state.view_count; i++)
+    {
+        // even sizes keep the mirror blit and any later downsampling exact
+        int w = (int)(state.view_confs[i].recommendedImageRectWidth * scale) & ~1;
+        int h = (int)(state.view_confs[i].recommendedImageRectHeight * scale) & ~1;
+        w = w < 16 ? 16 : (w > (int)state.swapchain_widths[i] ? (int)state.swapchain_widths[i] : w);
+        h = h < 16 ? 16 : (h > (int)state.swapchain_heights[i] ? (int)state.swapchain_heights[i] : h);
+
+        state.render_widths[i] = w;
+        state.render_heights[i] = h;
+        state.proj_views[i].subImage.imageRect.extent.width = w;
+        state.proj_views[i].subImage.imageRect.extent.height = h;
+        state.depth_infos[i].subImage.imageRect.extent.width = w;
+        state.depth_infos[i].subImage.imageRect.extent.height = h;
+    }
+}
+
+// Renders view_count views starting at view_index in one pass, reading their matrices from the
+// FrameData block bound for this frame. With more than one view the framebuffer is a multiview
+// framebuffer and the shader picks the matrices by gl_ViewID_OVR.
+void render_frame(const frame_packet_t *packet, int w, int h, int view_index, int view_count, GLuint framebuffer, GLuint image, GLuint depthbuffer)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    glViewport(0, 0, w, h);
+    glScissor(0, 0, w, h);
+
+    if (state.multiview)
+    {
+        glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, image, 0, 0, view_count);
+        glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthbuffer, 0, 0, view_count);
+    }
+    else
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthbuffer, 0);
+    }
+
+    gpu_profiler_begin(&state.gpu_profiler, "clear", view_index);
+    glClearColor(0.2f, 0.0f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gpu_profiler_end(&state.gpu_profiler);
+
+    gpu_profiler_begin(&state.gpu_profiler, "scene", view_index);
+
+    glUseProgram(state.program.id);
+    glBindVertexArray(state.vao);
+
+    if (!state.multiview)
+    {
+        glUniform1i(state.view_index_location, view_index);
     }
 
+    if (state.multiview)
+    {
+        instance_batch_draw(&state.cubes, &state.cube_mesh);
+    }
+    else
+    {
+        instance_batch_draw_range(&state.cubes, &state.cube_mesh, packet->view_first_instance[view_index], packet->view_instance_count[view_index]);
+    }
+    if (state.gltf.state == GLTF_STREAM_READY)
+    {
+        instance_batch_draw(&state.models, &state.gltf.mesh);
+    }
+    gpu_profiler_end(&state.gpu_profiler);
+
     // blit left eye to desktop window
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+#ifdef _WIN32
     if (view_index == 0)
     {
-        glBlitNamedFramebuffer((GLuint)framebuffer,             // readFramebuffer
+        gpu_profiler_begin(&state.gpu_profiler, "mirror", view_index);
+        // blits from a multiview framebuffer are invalid, so read layer 0 through a plain one
+        GLuint read_framebuffer = framebuffer;
+        if (state.multiview)
+        {
+            glNamedFramebufferTextureLayer(state.mirror_framebuffer, GL_COLOR_ATTACHMENT0, image, 0, 0);
+            read_framebuffer = state.mirror_framebuffer;
+        }
+
+        glBlitNamedFramebuffer((GLuint)read_framebuffer,        // readFramebuffer
                                (GLuint)0,                       // backbuffer     // drawFramebuffer
                                (GLint)0,                        // srcX0
                                (GLint)0,                        // srcY0
@@ -228,13 +749,455 @@ void render_frame(int w, int h, XrTime predictedDisplayTime, int view_index, XrS
                                (GLbitfield)GL_COLOR_BUFFER_BIT, // mask
                                (GLenum)GL_LINEAR);              // filter
 
+        gpu_profiler_end(&state.gpu_profiler);
+
         SDL_GL_SwapWindow(state.desktop_window);
     }
+#endif
+}
+
+// Locates the controllers again just before the first pass draws them and rewrites their
+// instances in the frame ring, which is coherently mapped, so the draws read the newer pose.
+// Every pass of a frame has to show the same pose, so it is done once, before any draw has been
+// issued that could still be reading the old one.
+static void late_latch_hands(frame_packet_t *packet)
+{
+    if (packet->hand_located_ns == 0)
+    {
+        return;
+    }
+
+    cpu_zone_begin("late latch", -1);
+    uint64_t located_ns = clock_ns();
+    int latched = 0;
+    for (int hand = 0; hand < HAND_COUNT; hand++)
+    {
+        int32_t index = packet->hand_instances[hand];
+        if (index < 0 || (uint32_t)index >= state.cubes.count)
+        {
+            continue;
+        }
+
+        // the block keeps the bounds it was culled with, a few mm of movement never matters
+        XrSpaceLocation location = {.type = XR_TYPE_SPACE_LOCATION};
+        XrResult result = xrLocateSpace(state.hand_pose_spaces[hand], state.play_space, packet->frame_state.predictedDisplayTime, &location);
+        if (result != XR_SUCCESS || (location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) == 0)
+        {
+            continue;
+        }
+
+        float model[16];
+        mat4_trs(model, (float *)&location.pose.position, (float *)&location.pose.orientation, hand_scale);
+        memcpy(state.cubes.instances[index].model, model, sizeof(model));
+        latched = 1;
+    }
+    cpu_zone_end();
+
+    packet->late_latch_ns = latched ? located_ns - packet->hand_located_ns : 0;
+}
+
+static int make_gl_current(int current)
+{
+#ifdef _WIN32
+    return SDL_GL_MakeCurrent(state.desktop_window, current ? state.gl_context : NULL) == 0;
+#else
+    return egl_context_make_current(&state.egl, current);
+#endif
+}
+
+// Everything from xrBeginFrame to xrEndFrame for one simulated frame, on the render thread
+static void render_packet(frame_packet_t *packet)
+{
+    const XrFrameState *frame_state = &packet->frame_state;
+    cpu_zone_begin("render frame", -1);
+
+    // Begin frame
+    XrFrameBeginInfo frame_begin_info = {.type = XR_TYPE_FRAME_BEGIN_INFO};
+    cpu_zone_begin("xrBeginFrame", -1);
+    XrResult result = xrBeginFrame(state.session, &frame_begin_info);
+    cpu_zone_end();
+    if (result != XR_SUCCESS)
+    {
+        printf("Failed to begin frame\n");
+        SDL_AtomicSet(&state.render_failed, 1);
+        cpu_zone_end();
+        return;
+    }
+
+    // Reuse the oldest region of the frame ring, waits only if the GPU is frames behind
+    gpu_ring_begin_frame(&state.frame_ring);
+
+    for (int i = 0; i < state.view_count; i++)
+    {
+        state.proj_views[i].pose = packet->views[i].pose;
+        state.proj_views[i].fov = packet->views[i].fov;
+    }
+
+    if (frame_state->shouldRender)
+    {
+        // one upload shared by every view and pass of this frame
+        GLintptr frame_uniforms_offset = gpu_ring_push_uniforms(&state.frame_ring, &packet->uniforms, sizeof(packet->uniforms));
+        if (frame_uniforms_offset >= 0)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, state.frame_ring.buffer, frame_uniforms_offset, sizeof(packet->uniforms));
+        }
+
+        if (options.gltf_path)
+        {
+            gltf_stream_update(&state.gltf, &state.frame_ring, state.upload_budget);
+        }
+
+        if (instance_batch_begin(&state.cubes, &state.frame_ring))
+        {
+            instance_batch_push_array(&state.cubes, packet->instances, packet->instance_count);
+        }
+        else
+        {
+            printf("Frame ring is out of space for instances\n");
+        }
+
+        // the streamed model, once all of it is on the GPU
+        if (state.gltf.state == GLTF_STREAM_READY && instance_batch_begin(&state.models, &state.frame_ring))
+        {
+            instance_data_t *instance = instance_batch_push(&state.models);
+            float model[16];
+            mat4_identity(model);
+            mat4_translation(model, model, (float[3]){0, 0, -2});
+
+            memcpy(instance->model, model, sizeof(model));
+            memcpy(instance->color, (float[4]){0, 0, 0, 1}, sizeof(instance->color));
+        }
+
+        // GPU time of a frame from a few frames ago sets this frame's resolution
+        double gpu_ms;
+        if (gpu_timer_poll(&state.gpu_timer, &gpu_ms))
+        {
+            state.gpu_ms_total += gpu_ms;
+            state.gpu_frames++;
+            if (!options.no_dynamic_resolution)
+            {
+                resolution_update(&state.resolution, gpu_ms, frame_state->predictedDisplayPeriod / 1e6);
+            }
+        }
+        resolution_frame(&state.resolution);
+        set_render_scale(state.resolution.scale);
+
+        gpu_profiler_poll(&state.gpu_profiler);
+
+        gpu_timer_begin(&state.gpu_timer);
+        gpu_profiler_begin_frame(&state.gpu_profiler, frame_state->predictedDisplayTime);
+        gpu_profiler_begin(&state.gpu_profiler, "frame", 0);
+    }
+
+    // Render each swapchain, which is one eye, or both eyes at once with multiview
+    for (int i = 0; i < state.swapchain_count; i++)
+    {
+        if (!frame_state->shouldRender)
+        {
+            printf("shouldRender = false, Skipping rendering work\n");
+            continue;
+        }
+
+        uint32_t acquired_index;
+        XrSwapchainImageAcquireInfo acquire_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+        result = xrAcquireSwapchainImage(state.swapchains[i], &acquire_info, &acquired_index);
+        if (result != XR_SUCCESS)
+        {
+            printf("Failed to acquire swapchain image\n");
+            break;
+        }
+
+        uint32_t depth_acquired_index = UINT32_MAX;
+        XrSwapchainImageAcquireInfo depth_acquire_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+        result = xrAcquireSwapchainImage(state.depths[i], &depth_acquire_info, &depth_acquired_index);
+        if (result != XR_SUCCESS)
+        {
+            printf("Failed to acquire swapchain image\n");
+            break;
+        }
+
+        XrSwapchainImageWaitInfo wait_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO, .timeout = 1000};
+        result = xrWaitSwapchainImage(state.swapchains[i], &wait_info);
+        if (result != XR_SUCCESS)
+        {
+            printf("Failed to wait for swapchain image\n");
+            break;
+        }
+
+        XrSwapchainImageWaitInfo depth_wait_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO, .timeout = 1000};
+        result = xrWaitSwapchainImage(state.depths[i], &depth_wait_info);
+        if (result != XR_SUCCESS)
+        {
+            printf("Failed to wait for swapchain image\n");
+            break;
+        }
+
+        int w = state.render_widths[i];
+        int h = state.render_heights[i];
+
+        int pass_view_count = state.multiview ? state.view_count : 1;
+
+        GLuint framebuffer = state.framebuffers[i][acquired_index];
+        GLuint swap_image = state.swapchain_images[i][acquired_index].image;
+        GLuint depth_image = state.depth_images[i][depth_acquired_index].image;
+
+        // the swapchain waits are behind us, nothing blocks between here and the draws
+        if (i == 0)
+        {
+            late_latch_hands(packet);
+        }
+
+        cpu_zone_begin("render view", i);
+        gpu_profiler_begin(&state.gpu_profiler, "view", i);
+        render_frame(packet, w, h, i, pass_view_count, framebuffer, swap_image, depth_image);
+        gpu_profiler_end(&state.gpu_profiler);
+        cpu_zone_end();
+
+        XrSwapchainImageReleaseInfo release_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO, .next = NULL};
+        result = xrReleaseSwapchainImage(state.swapchains[i], &release_info);
+        if (result != XR_SUCCESS)
+        {
+            printf("Failed to release for swapchain image\n");
+            break;
+        }
+
+        XrSwapchainImageReleaseInfo depth_release_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+        result = xrReleaseSwapchainImage(state.depths[i], &depth_release_info);
+        if (result != XR_SUCCESS)
+        {
+            printf("Failed to release for swapchain image\n");
+            break;
+        }
+    }
+
+    if (frame_state->shouldRender)
+    {
+        gpu_profiler_end(&state.gpu_profiler);
+        gpu_profiler_end_frame(&state.gpu_profiler);
+        gpu_timer_end(&state.gpu_timer);
+    }
+    gpu_ring_end_frame(&state.frame_ring);
+
+    XrCompositionLayerProjection projection_layer = {
+        .type = XR_TYPE_COMPOSITION_LAYER_PROJECTION,
+        .layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT,
+        .space = state.play_space,
+        .viewCount = state.view_count,
+        .views = state.proj_views,
+    };
+
+    int submitted_layer_count = 1;
+    const XrCompositionLayerBaseHeader *submitted_layers[1] = {(const XrCompositionLayerBaseHeader *const)&projection_layer};
+
+    if ((packet->view_state.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT) == 0)
+    {
+        printf("submitting 0 layers because orientation is invalid\n");
+        submitted_layer_count = 0;
+    }
+
+    if (!frame_state->shouldRender)
+    {
+        printf("submitting 0 layers because shouldRender = false\n");
+        submitted_layer_count = 0;
+    }
+
+    XrFrameEndInfo frame_end_info = {
+        .type = XR_TYPE_FRAME_END_INFO,
+        .displayTime = frame_state->predictedDisplayTime,
+        .layerCount = submitted_layer_count,
+        .layers = submitted_layers,
+        .environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE,
+    };
+
+    cpu_zone_begin("xrEndFrame", -1);
+    result = xrEndFrame(state.session, &frame_end_info);
+    cpu_zone_end();
+    cpu_zone_end();
+    if (result != XR_SUCCESS)
+    {
+        printf("Failed to end frame\n");
+        SDL_AtomicSet(&state.render_failed, 1);
+        return;
+    }
+
+    // marked in the trace so the zones around it show what took the time
+    packet->submitted = 1;
+    packet->work_ns = clock_ns() - packet->frame_start_ns;
+    if (frame_state->predictedDisplayPeriod > 0 && packet->work_ns > (uint64_t)frame_state->predictedDisplayPeriod)
+    {
+        cpu_profiler_instant("over budget", -1);
+    }
+}
+
+static int render_thread_main(void *data)
+{
+    cpu_profiler_thread_name("render");
+    if (!make_gl_current(1))
+    {
+        printf("Failed to make the GL context current on the render thread\n");
+        SDL_AtomicSet(&state.render_failed, 1);
+    }
+
+    // after a failure packets still come back, unrendered, so the simulation thread never blocks
+    frame_packet_t *packet;
+    while ((packet = frame_queue_pop(&state.ready_packets)) != NULL)
+    {
+        if (!SDL_AtomicGet(&state.render_failed))
+        {
+            render_packet(packet);
+        }
+        frame_queue_push(&state.free_packets, packet);
+    }
+
+    make_gl_current(0);
+    return 0;
+}
+
+// Accounts for a packet the render thread has handed back, before it is filled again
+static void retire_packet(frame_packet_t *packet)
+{
+    if (!packet->submitted)
+    {
+        return;
+    }
+
+    packet->submitted = 0;
+    state.frames_submitted++;
+    if (packet->late_latch_ns > 0)
+    {
+        state.late_latch_frames++;
+        state.late_latch_total_ns += packet->late_latch_ns;
+        state.late_latch_max_ns = packet->late_latch_ns > state.late_latch_max_ns ? packet->late_latch_ns : state.late_latch_max_ns;
+    }
+    frame_pacing_end(&state.pacing, packet->work_ns);
+    frame_pacing_report(&state.pacing, clock_ns());
+}
+
+// Blocks until the render thread has ended every frame handed to it
+static void wait_for_render(void)
+{
+    frame_packet_t *packets[FRAME_PACKETS];
+    for (int i = 0; i < FRAME_PACKETS; i++)
+    {
+        packets[i] = frame_queue_pop(&state.free_packets);
+        retire_packet(packets[i]);
+    }
+    for (int i = 0; i < FRAME_PACKETS; i++)
+    {
+        frame_queue_push(&state.free_packets, packets[i]);
+    }
+}
+
+// Lets the render thread finish what is queued, then takes the GL context back from it
+static void stop_render_thread(void)
+{
+    if (!state.render_thread)
+    {
+        return;
+    }
+
+    frame_queue_close(&state.ready_packets);
+    SDL_WaitThread(state.render_thread, NULL);
+    state.render_thread = NULL;
+    make_gl_current(1);
+}
+
+static void haptics_tick(void *data)
+{
+    haptics_update(data);
 }
 
 // #undef main
-int main()
+int main(int argc, char *argv[])
 {
+    if (!parse_options(argc, argv))
+    {
+        return 1;
+    }
+
+    cpu_profiler_init();
+    cpu_profiler_thread_name("main");
+    printf("Using %s matrix kernels\n", mat4_simd_name(mat4_simd_init()));
+
+    // Optional extensions are enabled when the runtime offers them
+    uint32_t extension_count = 0;
+    XrResult result = xrEnumerateInstanceExtensionProperties(NULL, 0, &extension_count, NULL);
+    XrExtensionProperties *extension_props = calloc(extension_count ? extension_count : 1, sizeof(XrExtensionProperties));
+    if (result != XR_SUCCESS || !extension_props)
+    {
+        printf("Failed to enumerate instance extensions\n");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < extension_count; i++)
+    {
+        extension_props[i].type = XR_TYPE_EXTENSION_PROPERTIES;
+    }
+
+    result = xrEnumerateInstanceExtensionProperties(NULL, extension_count, &extension_count, extension_props);
+    if (result != XR_SUCCESS)
+    {
+        printf("Failed to enumerate instance extensions\n");
+        return 1;
+    }
+
+    const char *enabled_extensions[MAX_ENABLED_EXTENSIONS];
+    int quad_views_extension = 0;
+    int convert_time_extension = 0;
+    int egl_extension = 0;
+    uint32_t enabled_extension_count = 0;
+    enabled_extensions[enabled_extension_count++] = XR_KHR_OPENGL_ENABLE_EXTENSION_NAME;
+
+    for (uint32_t i = 0; i < extension_count; i++)
+    {
+        // lets the compositor reproject missed frames positionally instead of rotation only
+        if (strcmp(extension_props[i].extensionName, XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME) == 0)
+        {
+            state.depth_layer = 1;
+            enabled_extensions[enabled_extension_count++] = XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME;
+        }
+
+        // maps the CPU clock to XrTime, so GPU timings can be placed relative to display time
+#ifdef _WIN32
+        if (strcmp(extension_props[i].extensionName, XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME) == 0)
+        {
+            convert_time_extension = 1;
+            enabled_extensions[enabled_extension_count++] = XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME;
+        }
+#else
+        if (strcmp(extension_props[i].extensionName, XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME) == 0)
+        {
+            convert_time_extension = 1;
+            enabled_extensions[enabled_extension_count++] = XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME;
+        }
+
+        // lets the session use a windowless EGL context
+        if (strcmp(extension_props[i].extensionName, XR_MNDX_EGL_ENABLE_EXTENSION_NAME) == 0)
+        {
+            egl_extension = 1;
+            enabled_extensions[enabled_extension_count++] = XR_MNDX_EGL_ENABLE_EXTENSION_NAME;
+        }
+#endif
+
+        // adds the quad view configuration, enabling it does not make it the one used
+        if (!options.no_quad_views && strcmp(extension_props[i].extensionName, XR_VARJO_QUAD_VIEWS_EXTENSION_NAME) == 0)
+        {
+            quad_views_extension = 1;
+            enabled_extensions[enabled_extension_count++] = XR_VARJO_QUAD_VIEWS_EXTENSION_NAME;
+        }
+    }
+    free(extension_props);
+
+#ifndef _WIN32
+    if (!egl_extension)
+    {
+        printf("Runtime does not support XR_MNDX_egl_enable\n");
+        return 1;
+    }
+#endif
+
+    printf("Depth layer: %s\n", state.depth_layer ? "enabled" : "not supported by the runtime");
+
     // Create Instance
     XrInstanceCreateInfo instance_create_info = {
         .type = XR_TYPE_INSTANCE_CREATE_INFO,
@@ -245,10 +1208,10 @@ int main()
             .engineName = "XR",
             .engineVersion = 1,
         },
-        .enabledExtensionCount = 1,
-        .enabledExtensionNames = (const char *[1]){XR_KHR_OPENGL_ENABLE_EXTENSION_NAME}};
+        .enabledExtensionCount = enabled_extension_count,
+        .enabledExtensionNames = enabled_extensions};
 
-    XrResult result = xrCreateInstance(&instance_create_info, &state.instance);
+    result = xrCreateInstance(&instance_create_info, &state.instance);
     if (result != XR_SUCCESS)
     {
         printf("Instance Creation Failed\n");
@@ -264,6 +1227,20 @@ int main()
         return 1;
     }
 
+#ifdef _WIN32
+    static PFN_xrConvertWin32PerformanceCounterToTimeKHR pfnConvertWin32PerformanceCounterToTimeKHR = NULL;
+    if (convert_time_extension)
+    {
+        xrGetInstanceProcAddr(state.instance, "xrConvertWin32PerformanceCounterToTimeKHR", (PFN_xrVoidFunction *)&pfnConvertWin32PerformanceCounterToTimeKHR);
+    }
+#else
+    static PFN_xrConvertTimespecTimeToTimeKHR pfnConvertTimespecTimeToTimeKHR = NULL;
+    if (convert_time_extension)
+    {
+        xrGetInstanceProcAddr(state.instance, "xrConvertTimespecTimeToTimeKHR", (PFN_xrVoidFunction *)&pfnConvertTimespecTimeToTimeKHR);
+    }
+#endif
+
     // Get system
     XrSystemGetInfo system_get_info = {
         .type = XR_TYPE_SYSTEM_GET_INFO,
@@ -292,14 +1269,32 @@ int main()
     printf("\tOrientation Tracking: %d\n", state.system_props.trackingProperties.orientationTracking);
     printf("\tPosition Tracking   : %d\n", state.system_props.trackingProperties.positionTracking);
 
+    // Pick the view configuration, quad views if the system supports them
+    state.view_type = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+    if (quad_views_extension)
+    {
+        XrViewConfigurationType view_types[8];
+        uint32_t view_type_count = 0;
+        result = xrEnumerateViewConfigurations(state.instance, state.system_id, 8, &view_type_count, view_types);
+        for (uint32_t i = 0; result == XR_SUCCESS && i < view_type_count; i++)
+        {
+            if (view_types[i] == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO)
+            {
+                state.view_type = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+            }
+        }
+    }
+
+    printf("View configuration: %s\n", state.view_type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO ? "quad views" : "stereo");
+
     // Get view configurations
-    result = xrEnumerateViewConfigurationViews(state.instance, state.system_id, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, 0, &state.view_count, NULL);
+    result = xrEnumerateViewConfigurationViews(state.instance, state.system_id, state.view_type, 0, &state.view_count, NULL);
     if (result != XR_SUCCESS)
     {
         printf("Failed to get view count\n");
     }
 
-    result = xrEnumerateViewConfigurationViews(state.instance, state.system_id, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, MAX_VIEWS, &state.view_count, state.view_confs);
+    result = xrEnumerateViewConfigurationViews(state.instance, state.system_id, state.view_type, MAX_VIEWS, &state.view_count, state.view_confs);
     if (result != XR_SUCCESS)
     {
         printf("Failed to get views\n");
@@ -323,6 +1318,7 @@ int main()
     printf("Supports OpenGL versions %llu to %llu\n", state.opengl_reqs.minApiVersionSupported, state.opengl_reqs.maxApiVersionSupported);
 
     // Init SDL and OpenGL
+#ifdef _WIN32
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
         printf("Unable to initialize SDL\n");
@@ -346,13 +1342,30 @@ int main()
     state.gl_context = SDL_GL_CreateContext(state.desktop_window);
     gladLoadGLLoader(SDL_GL_GetProcAddress);
     SDL_GL_SetSwapInterval(0);
+#else
+    if (!egl_context_create(&state.egl, 4, 3))
+    {
+        return 1;
+    }
+    gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+#endif
 
     // Create Session
+#ifdef _WIN32
     XrGraphicsBindingOpenGLWin32KHR graphics_binding_gl = {
         .type = XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR,
         .hDC = wglGetCurrentDC(),
         .hGLRC = wglGetCurrentContext(),
     };
+#else
+    XrGraphicsBindingEGLMNDX graphics_binding_gl = {
+        .type = XR_TYPE_GRAPHICS_BINDING_EGL_MNDX,
+        .getProcAddress = eglGetProcAddress,
+        .display = state.egl.display,
+        .config = state.egl.config,
+        .context = state.egl.context,
+    };
+#endif
 
     XrSessionCreateInfo session_create_info = {
         .type = XR_TYPE_SESSION_CREATE_INFO,
@@ -403,17 +1416,80 @@ int main()
     }
 
     int64_t color_format = swapchain_formats[0];
-    int64_t depth_format = -1;
     for (int i = 0; i < swapchain_format_count; i++)
     {
-        if (swapchain_formats[i] == GL_SRGB8_ALPHA8)
-            color_format = GL_SRGB8_ALPHA8;
+        if (swapchain_formats[i] == GL_SRGB8_ALPHA8)
+            color_format = GL_SRGB8_ALPHA8;
+    }
+
+    // reversed-Z stores depth as 1 / distance, which only keeps its precision in a float buffer
+    state.reverse_z = !options.no_reverse_z && (GLAD_GL_VERSION_4_5 || gl_extension_supported("GL_ARB_clip_control"));
+    const int64_t reversed_depth_formats[] = {GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT16};
+    const int64_t standard_depth_formats[] = {GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F};
+    const int64_t *depth_formats = state.reverse_z ? reversed_depth_formats : standard_depth_formats;
+
+    int64_t depth_format = -1;
+    for (int f = 0; f < 3 && depth_format < 0; f++)
+    {
+        for (int i = 0; i < swapchain_format_count; i++)
+        {
+            if (swapchain_formats[i] == depth_formats[f])
+                depth_format = depth_formats[f];
+        }
+    }
+
+    if (depth_format < 0)
+    {
+        printf("Runtime offers no supported depth swapchain format\n");
+        return 1;
+    }
+
+    printf("Depth: %s, %s\n", state.reverse_z ? "reversed-Z with infinite far plane" : "standard",
+           depth_format == GL_DEPTH_COMPONENT32F ? "32 bit float" : (depth_format == GL_DEPTH_COMPONENT24 ? "24 bit" : "16 bit"));
+
+    // Single pass stereo needs GL_OVR_multiview2 and both views sharing one image size,
+    // otherwise fall back to one swapchain and one pass per view
+    state.multiview = !options.no_multiview && state.view_count == 2 && gl_extension_supported("GL_OVR_multiview2");
+    for (uint32_t i = 1; i < state.view_count; i++)
+    {
+        if (state.view_confs[i].recommendedImageRectWidth != state.view_confs[0].recommendedImageRectWidth ||
+            state.view_confs[i].recommendedImageRectHeight != state.view_confs[0].recommendedImageRectHeight)
+        {
+            state.multiview = 0;
+        }
+    }
+
+    if (state.multiview)
+    {
+        glFramebufferTextureMultiviewOVR = (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)gl_proc_address("glFramebufferTextureMultiviewOVR");
+        state.multiview = glFramebufferTextureMultiviewOVR != NULL;
+    }
+
+    printf("Render path: %s\n", state.multiview ? "multiview (single pass)" : "one pass per view");
+
+    // room to render above the recommended size, bounded by what the runtime allows
+    float max_render_scale = options.no_dynamic_resolution ? 1.0f : MAX_RENDER_SCALE;
+    for (uint32_t i = 0; i < state.view_count; i++)
+    {
+        XrViewConfigurationView *conf = &state.view_confs[i];
+        state.swapchain_widths[i] = (uint32_t)(conf->recommendedImageRectWidth * max_render_scale);
+        state.swapchain_heights[i] = (uint32_t)(conf->recommendedImageRectHeight * max_render_scale);
+        state.swapchain_widths[i] = state.swapchain_widths[i] < conf->maxImageRectWidth ? state.swapchain_widths[i] : conf->maxImageRectWidth;
+        state.swapchain_heights[i] = state.swapchain_heights[i] < conf->maxImageRectHeight ? state.swapchain_heights[i] : conf->maxImageRectHeight;
+
+        float width_scale = (float)state.swapchain_widths[i] / conf->recommendedImageRectWidth;
+        float height_scale = (float)state.swapchain_heights[i] / conf->recommendedImageRectHeight;
+        max_render_scale = fminf(max_render_scale, fminf(width_scale, height_scale));
+    }
 
-        if (swapchain_formats[i] == GL_DEPTH_COMPONENT16)
-            depth_format = GL_DEPTH_COMPONENT16;
+    resolution_init(&state.resolution, options.no_dynamic_resolution ? 1.0f : MIN_RENDER_SCALE, max_render_scale);
+    if (!options.no_dynamic_resolution)
+    {
+        printf("Dynamic resolution: render scale %.2f to %.2f\n", state.resolution.min_scale, state.resolution.max_scale);
     }
 
-    state.swapchain_count = state.view_count;
+    state.swapchain_count = state.multiview ? 1 : state.view_count;
+    uint32_t swapchain_array_size = state.multiview ? state.view_count : 1;
     for (int i = 0; i < state.swapchain_count; i++)
     {
         // Color Swapchain
@@ -422,10 +1498,10 @@ int main()
             .usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT,
             .format = color_format,
             .sampleCount = state.view_confs[i].recommendedSwapchainSampleCount,
-            .width = state.view_confs[i].recommendedImageRectWidth,
-            .height = state.view_confs[i].recommendedImageRectHeight,
+            .width = state.swapchain_widths[i],
+            .height = state.swapchain_heights[i],
             .faceCount = 1,
-            .arraySize = 1,
+            .arraySize = swapchain_array_size,
             .mipCount = 1,
         };
 
@@ -456,7 +1532,7 @@ int main()
         }
     }
 
-    state.depth_count = state.view_count;
+    state.depth_count = state.swapchain_count;
     for (int i = 0; i < state.swapchain_count; i++)
     {
         // Depth Swapchain
@@ -465,10 +1541,10 @@ int main()
             .usageFlags = XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
             .format = depth_format,
             .sampleCount = state.view_confs[i].recommendedSwapchainSampleCount,
-            .width = state.view_confs[i].recommendedImageRectWidth,
-            .height = state.view_confs[i].recommendedImageRectHeight,
+            .width = state.swapchain_widths[i],
+            .height = state.swapchain_heights[i],
             .faceCount = 1,
-            .arraySize = 1,
+            .arraySize = swapchain_array_size,
             .mipCount = 1,
         };
 
@@ -506,45 +1582,64 @@ int main()
         state.views[i].type = XR_TYPE_VIEW;
     }
 
+    if (options.record_poses_path && !pose_trace_open_write(&state.pose_trace, options.record_poses_path, state.view_type, state.view_count))
+    {
+        return 1;
+    }
+    if (options.replay_poses_path && !pose_trace_open_read(&state.pose_trace, options.replay_poses_path, state.view_type, state.view_count))
+    {
+        return 1;
+    }
+
     state.near_z = 0.01f;
-    state.far_z = 100.0f;
+    state.far_z = state.reverse_z ? INFINITY : 100.0f;
+    view_cache_init(&state.view_cache, state.near_z, state.far_z, state.reverse_z);
+
+    // reversed-Z has the infinite far plane at depth 0 and the near plane at 1
+    state.depth_near_z = state.reverse_z ? INFINITY : state.near_z;
+    state.depth_far_z = state.reverse_z ? state.near_z : state.far_z;
 
     for (int i = 0; i < state.view_count; i++)
     {
         state.proj_views[i] = (XrCompositionLayerProjectionView){
             .type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW,
             .subImage = {
-                .swapchain = state.swapchains[i],
+                .swapchain = state.swapchains[state.multiview ? 0 : i],
+                .imageRect = {
+                    .extent.width = state.view_confs[i].recommendedImageRectWidth,
+                    .extent.height = state.view_confs[i].recommendedImageRectHeight,
+                },
+                .imageArrayIndex = state.multiview ? i : 0,
+            },
+        };
+    };
+
+    // the depth swapchains are rendered and released every frame anyway, chaining them in
+    // is all the runtime needs for positional reprojection
+    for (int i = 0; i < state.view_count && state.depth_layer; i++)
+    {
+        state.depth_infos[i] = (XrCompositionLayerDepthInfoKHR){
+            .type = XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+            .nearZ = state.depth_near_z,
+            .farZ = state.depth_far_z,
+            .subImage = {
+                .swapchain = state.depths[state.multiview ? 0 : i],
                 .imageRect = {
+                    .offset.x = 0,
+                    .offset.y = 0,
                     .extent.width = state.view_confs[i].recommendedImageRectWidth,
                     .extent.height = state.view_confs[i].recommendedImageRectHeight,
                 },
+                .imageArrayIndex = state.multiview ? i : 0,
             },
         };
+
+        state.proj_views[i].next = &state.depth_infos[i];
     };
 
-    // for (int i = 0; i < state.view_count; i++)
-    // {
-    //     state.depth_infos[i] = (XrCompositionLayerDepthInfoKHR){
-    //         .type = XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR,
-    //         .minDepth = 0.0f,
-    //         .maxDepth = 1.0f,
-    //         .nearZ = state.near_z,
-    //         .farZ = state.far_z,
-    //         .subImage = {
-    //             .swapchain = state.depths[i],
-    //             .imageRect = {
-    //                 .offset.x = 0,
-    //                 .offset.y = 0,
-    //                 .extent.width = state.view_confs[i].recommendedImageRectWidth,
-    //                 .extent.height = state.view_confs[i].recommendedImageRectHeight,
-    //             },
-    //         },
-
-    //     };
-
-    //     state.proj_views[i].next = &state.depth_infos[i];
-    // };
+    set_render_scale(state.resolution.scale);
 
     // Setup Inputs/Actions/Poses
     xrStringToPath(state.instance, "/user/hand/left", &state.hand_paths[HAND_LEFT_INDEX]);
@@ -713,80 +1808,77 @@ int main()
     }
 
     // Setup up OpenGL state
-    static const char *vert_src =
+    // the vertex shader header decides where the view index comes from, gl_ViewID_OVR when
+    // both eyes are rendered in one pass, or a uniform set before each pass otherwise
+    static const char *vert_header_src =
         "#version 330 core\n"
         "#extension GL_ARB_explicit_uniform_location : require\n"
+        "layout(location = 2) uniform int viewIndex;\n"
+        "#define VIEW_INDEX viewIndex\n";
+
+    static const char *vert_multiview_header_src =
+        "#version 330 core\n"
+        "#extension GL_OVR_multiview2 : require\n"
+        "layout(num_views = 2) in;\n"
+        "#define VIEW_INDEX gl_ViewID_OVR\n";
+
+    // FrameData must match frame_uniforms_t
+    static const char *vert_src =
+        "layout(std140) uniform FrameData {\n"
+        "	mat4 view[4];\n"
+        "	mat4 proj[4];\n"
+        "	vec4 time;\n"
+        "};\n"
         "layout(location = 0) in vec3 aPos;\n"
-        "layout(location = 2) uniform mat4 model;\n"
-        "layout(location = 3) uniform mat4 view;\n"
-        "layout(location = 4) uniform mat4 proj;\n"
         "layout(location = 5) in vec2 aColor;\n"
+        "layout(location = 6) in mat4 instanceModel;\n"
+        "layout(location = 10) in vec4 instanceColor;\n"
         "out vec2 vertexColor;\n"
+        "flat out vec4 objectColor;\n"
         "void main() {\n"
-        "	gl_Position = proj * view * model * vec4(aPos.x, aPos.y, aPos.z, "
+        "	gl_Position = proj[VIEW_INDEX] * view[VIEW_INDEX] * instanceModel * vec4(aPos.x, aPos.y, aPos.z, "
         "1.0);\n"
         "	vertexColor = aColor;\n"
+        "	objectColor = instanceColor;\n"
         "}\n";
 
     static const char *frag_src =
         "#version 330 core\n"
-        "#extension GL_ARB_explicit_uniform_location : require\n"
         "layout(location = 0) out vec4 FragColor;\n"
-        "layout(location = 1) uniform vec3 uniformColor;\n"
+        "flat in vec4 objectColor;\n"
         "in vec2 vertexColor;\n"
         "void main() {\n"
-        "	FragColor = (uniformColor.x < 0.01 && uniformColor.y < 0.01 && "
-        "uniformColor.z < 0.01) ? vec4(vertexColor, 1.0, 1.0) : vec4(uniformColor, "
+        "	FragColor = (objectColor.x < 0.01 && objectColor.y < 0.01 && "
+        "objectColor.z < 0.01) ? vec4(vertexColor, 1.0, 1.0) : vec4(objectColor.rgb, "
         "1.0);\n"
         "}\n";
 
-    for (int i = 0; i < state.view_count; i++)
+    for (int i = 0; i < state.swapchain_count; i++)
     {
         glGenFramebuffers(state.swapchain_lengths[i], state.framebuffers[i]);
     }
 
-    GLuint vert_shd = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vert_shd, 1, &vert_src, NULL);
-    glCompileShader(vert_shd);
-    int vertex_compile_res;
-    glGetShaderiv(vert_shd, GL_COMPILE_STATUS, &vertex_compile_res);
-    if (!vertex_compile_res)
+    if (state.multiview)
     {
-        char info_log[512];
-        glGetShaderInfoLog(vert_shd, 512, NULL, info_log);
-        printf("Vertex Shader failed to compile: %s\n", info_log);
-        return 1;
+        glGenFramebuffers(1, &state.mirror_framebuffer);
     }
 
-    GLuint frag_shd = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(frag_shd, 1, &frag_src, NULL);
-    glCompileShader(frag_shd);
-    int fragment_compile_res;
-    glGetShaderiv(frag_shd, GL_COMPILE_STATUS, &fragment_compile_res);
-    if (!fragment_compile_res)
+    const char *vert_srcs[] = {state.multiview ? vert_multiview_header_src : vert_header_src, vert_src};
+    if (!program_create(&state.program, vert_srcs, 2, &frag_src, 1))
     {
-        char info_log[512];
-        glGetShaderInfoLog(frag_shd, 512, NULL, info_log);
-        printf("Fragment Shader failed to compile: %s\n", info_log);
         return 1;
     }
 
-    state.shader = glCreateProgram();
-    glAttachShader(state.shader, vert_shd);
-    glAttachShader(state.shader, frag_shd);
-    glLinkProgram(state.shader);
-    GLint shader_program_res;
-    glGetProgramiv(state.shader, GL_LINK_STATUS, &shader_program_res);
-    if (!shader_program_res)
+    // uniform locations and block layouts are reflected once here, never per frame
+    state.view_index_location = program_uniform_location(&state.program, "viewIndex");
+
+    const program_block_t *frame_block = program_block(&state.program, "FrameData");
+    if (!frame_block || frame_block->data_size != sizeof(frame_uniforms_t))
     {
-        char info_log[512];
-        glGetProgramInfoLog(state.shader, 512, NULL, info_log);
-        printf("Shader Program failed to link: %s\n", info_log);
+        printf("FrameData uniform block does not match frame_uniforms_t\n");
         return 1;
     }
-
-    glDeleteShader(vert_shd);
-    glDeleteShader(frag_shd);
+    program_bind_block(&state.program, "FrameData", FRAME_UNIFORMS_BINDING);
 
     const float vertices[] = {
         -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.5f, -0.5f, -0.5f, 1.0f, 0.0f,
@@ -813,22 +1905,176 @@ int main()
         0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
         -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, -0.5f, 0.5f, -0.5f, 0.0f, 1.0f};
 
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
+    // all buffers are immutable storage, per-frame data is streamed through one persistently mapped buffer
+    if (!GLAD_GL_VERSION_4_4 && !gl_extension_supported("GL_ARB_buffer_storage"))
+    {
+        printf("GL_ARB_buffer_storage is not supported\n");
+        return 1;
+    }
+
+    if (options.mesh_path)
+    {
+        // a converted mesh replaces the cube, it is mapped and uploaded without parsing
+        uint64_t load_start = clock_ns();
 
-    glGenVertexArrays(1, &state.vao);
+        mesh_file_t mesh_file;
+        if (!mesh_file_open(&mesh_file, options.mesh_path))
+        {
+            return 1;
+        }
+
+        int mesh_uploaded = mesh_file_upload(&state.cube_mesh, &mesh_file);
+        mesh_file_close(&mesh_file);
+        if (!mesh_uploaded)
+        {
+            printf("Failed to upload %s\n", options.mesh_path);
+            return 1;
+        }
+
+        printf("Loaded %s: %u vertices, %u indices in %.3f ms\n", options.mesh_path,
+               state.cube_mesh.vertex_count, state.cube_mesh.index_count, (clock_ns() - load_start) / 1e6);
+    }
+    else
+    {
+        // vertices has the mesh_vertex_t layout, position then uv
+        const uint32_t cube_vertex_count = sizeof(vertices) / (5 * sizeof(float));
+        mesh_data_t cube_data;
+        if (!mesh_data_from_triangles(&cube_data, (const mesh_vertex_t *)vertices, cube_vertex_count))
+        {
+            printf("Failed to create cube mesh\n");
+            return 1;
+        }
+
+        mesh_stats_t cube_stats;
+        if (!mesh_optimize(&cube_data, &cube_stats))
+        {
+            printf("Failed to optimize cube mesh\n");
+            return 1;
+        }
+
+        printf("Cube mesh: %u vertices -> %u unique, %u indices, ACMR %.3f -> %.3f\n",
+               cube_vertex_count, cube_stats.vertex_count, cube_stats.index_count,
+               cube_stats.acmr_before, cube_stats.acmr_after);
+
+        int cube_uploaded = mesh_upload(&state.cube_mesh, &cube_data);
+        mesh_data_free(&cube_data);
+        if (!cube_uploaded)
+        {
+            printf("Failed to upload cube mesh\n");
+            return 1;
+        }
+    }
 
+    glGenVertexArrays(1, &state.vao);
     glBindVertexArray(state.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
+    mesh_bind_attributes();
+
+    // the scene cubes plus the two controllers
+    instance_batch_init(&state.cubes, 5 + options.cube_count + HAND_COUNT);
+    instance_batch_init(&state.models, 1);
+    state.scene_objects = malloc(state.cubes.capacity * sizeof(scene_object_t));
+    state.scene_order = malloc(state.cubes.capacity * sizeof(uint32_t));
+    if (!state.scene_objects || !state.scene_order || !cull_init(&state.cull, state.cubes.capacity))
+    {
+        printf("Failed to allocate the scene\n");
+        return 1;
+    }
+
+    if (options.cube_count > 0)
+    {
+        // the cubes spin in place, so their bounds are the boxes around their bounding spheres
+        bvh_aabb_t *cube_bounds = malloc(options.cube_count * sizeof(bvh_aabb_t));
+        state.scene_query = malloc(options.cube_count * sizeof(uint32_t));
+        if (!cube_bounds || !state.scene_query)
+        {
+            printf("Failed to allocate the scene\n");
+            return 1;
+        }
+
+        for (int i = 0; i < options.cube_count; i++)
+        {
+            float position[3];
+            float radius = state.cube_mesh.radius * lattice_cube(i, position) / 2.0f;
+            for (int k = 0; k < 3; k++)
+            {
+                cube_bounds[i].min[k] = position[k] - radius;
+                cube_bounds[i].max[k] = position[k] + radius;
+            }
+        }
+
+        uint64_t build_start = clock_ns();
+        int built = bvh_build(&state.scene_bvh, cube_bounds, (uint32_t)options.cube_count);
+        free(cube_bounds);
+        if (!built)
+        {
+            printf("Failed to build the scene BVH\n");
+            return 1;
+        }
+
+        printf("Scene BVH: %d objects, %u nodes, SAH cost %.2f, built in %.3f ms\n", options.cube_count,
+               state.scene_bvh.node_count, state.scene_bvh.build_cost, (clock_ns() - build_start) / 1e6);
+    }
+    instance_batch_bind_attributes();
+
+    // decoded on a worker while the session starts, then uploaded through the frame ring
+    if (options.gltf_path)
+    {
+        state.upload_budget = (size_t)options.upload_budget_kb * 1024;
+        if (!gltf_stream_start(&state.gltf, options.gltf_path))
+        {
+            printf("Failed to start streaming %s\n", options.gltf_path);
+            return 1;
+        }
+    }
+
+    // three frames in flight before we wait on the GPU
+    GLsizeiptr frame_ring_size = (state.cubes.capacity + state.models.capacity) * sizeof(instance_data_t) + sizeof(frame_uniforms_t) + state.upload_budget + 64 * 1024;
+    if (!gpu_ring_init(&state.frame_ring, frame_ring_size, 3))
+    {
+        printf("Failed to create frame ring buffer\n");
+        return 1;
+    }
+
+    gpu_timer_init(&state.gpu_timer);
+    gpu_profiler_init(&state.gpu_profiler);
+    frame_pacing_init(&state.pacing);
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(5);
+    // clock_ns reads the same performance counter, so one conversion gives a fixed offset
+#ifdef _WIN32
+    if (pfnConvertWin32PerformanceCounterToTimeKHR)
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        uint64_t cpu_ns = clock_ns();
+        XrTime xr_time;
+        if (pfnConvertWin32PerformanceCounterToTimeKHR(state.instance, &counter, &xr_time) == XR_SUCCESS)
+        {
+            state.gpu_profiler.xr_to_cpu_ns = (int64_t)cpu_ns - xr_time;
+            state.gpu_profiler.xr_clock_known = 1;
+        }
+    }
+#else
+    if (pfnConvertTimespecTimeToTimeKHR)
+    {
+        struct timespec counter;
+        clock_gettime(CLOCK_MONOTONIC, &counter);
+        uint64_t cpu_ns = clock_ns();
+        XrTime xr_time;
+        if (pfnConvertTimespecTimeToTimeKHR(state.instance, &counter, &xr_time) == XR_SUCCESS)
+        {
+            state.gpu_profiler.xr_to_cpu_ns = (int64_t)cpu_ns - xr_time;
+            state.gpu_profiler.xr_clock_known = 1;
+        }
+    }
+#endif
 
     glEnable(GL_DEPTH_TEST);
+    if (state.reverse_z)
+    {
+        glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glClearDepth(0.0);
+        glDepthFunc(GL_GREATER);
+    }
 
     // Start Session
     XrSessionActionSetsAttachInfo actionset_attach_info = {
@@ -844,12 +2090,56 @@ int main()
         return 1;
     }
 
+    input_init(&state.input, state.session, state.gameplay_actionset, state.play_space, state.hand_paths, HAND_COUNT);
+    state.grab_input = input_add_float_action(&state.input, state.grab_action_float);
+    state.hand_pose_input = input_add_pose_action(&state.input, state.hand_pose_action, state.hand_pose_spaces);
+    if (!haptics_init(&state.haptics, state.session, state.haptic_action, state.hand_paths, HAND_COUNT))
+    {
+        return 1;
+    }
+    input_set_tick_callback(&state.input, haptics_tick, &state.haptics);
+    if (options.input_rate > 0 && !options.replay_poses_path && !input_start(&state.input, options.input_rate))
+    {
+        return 1;
+    }
+
+    // the frame loop stays on this thread with the window and events, rendering moves to its own
+    if (!frame_queue_init(&state.ready_packets) || !frame_queue_init(&state.free_packets))
+    {
+        return 1;
+    }
+    for (int i = 0; i < FRAME_PACKETS; i++)
+    {
+        state.packets[i].instances = malloc(state.cubes.capacity * sizeof(instance_data_t));
+        if (!state.packets[i].instances)
+        {
+            printf("Failed to allocate frame packets\n");
+            return 1;
+        }
+        frame_queue_push(&state.free_packets, &state.packets[i]);
+    }
+
+    make_gl_current(0);
+    state.render_thread = SDL_CreateThread(render_thread_main, "render", NULL);
+    if (!state.render_thread)
+    {
+        printf("Failed to create render thread: %s\n", SDL_GetError());
+        return 1;
+    }
+
     XrSessionState session_state = XR_SESSION_STATE_UNKNOWN;
     int quit_mainloop = 0;
     int session_running = 0; // to avoid beginning an already running session
     int run_framecycle = 0;  // for some session states skip the frame cycle
+    int exit_requested = 0;
+    int replay_finished = 0;
+#ifndef _WIN32
+    signal(SIGINT, on_interrupt);
+#endif
     while (!quit_mainloop)
     {
+        cpu_zone_begin("events", -1);
+#ifdef _WIN32
         // Pump SDL events
         SDL_Event sdl_event;
         while (SDL_PollEvent(&sdl_event))
@@ -859,6 +2149,29 @@ int main()
                 printf("Requesting exit...\n");
                 xrRequestExitSession(state.session);
             }
+            else if (sdl_event.type == SDL_KEYDOWN && sdl_event.key.keysym.sym == SDLK_F12)
+            {
+                cpu_profiler_write_trace(options.trace_path ? options.trace_path : "trace.json");
+            }
+        }
+#else
+        // fails until the session is running, so keep asking
+        if (interrupted && !exit_requested && xrRequestExitSession(state.session) == XR_SUCCESS)
+        {
+            printf("Requesting exit...\n");
+            exit_requested = 1;
+        }
+#endif
+        if (options.frame_limit > 0 && state.frames_submitted >= (uint64_t)options.frame_limit && !exit_requested &&
+            xrRequestExitSession(state.session) == XR_SUCCESS)
+        {
+            printf("Requesting exit after %llu frames\n", (unsigned long long)state.frames_submitted);
+            exit_requested = 1;
+        }
+        if (replay_finished && !exit_requested && xrRequestExitSession(state.session) == XR_SUCCESS)
+        {
+            printf("Pose trace replayed, requesting exit\n");
+            exit_requested = 1;
         }
 
         // Handle runtime Events
@@ -925,7 +2238,7 @@ int main()
                     {
                         XrSessionBeginInfo session_begin_info = {
                             .type = XR_TYPE_SESSION_BEGIN_INFO,
-                            .primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+                            .primaryViewConfigurationType = state.view_type,
                         };
                         result = xrBeginSession(state.session, &session_begin_info);
                         if (result != XR_SUCCESS)
@@ -947,6 +2260,8 @@ int main()
                     // runtime did not switch to the next state yet
                     if (session_running)
                     {
+                        // every frame of the session has to be ended before the session is
+                        wait_for_render();
                         result = xrEndSession(state.session);
                         if (result != XR_SUCCESS)
                         {
@@ -954,6 +2269,7 @@ int main()
                             return 1;
                         }
                         session_running = 0;
+                        frame_pacing_restart(&state.pacing);
                     }
                     // after ending the session, don't run render loop
                     run_framecycle = 0;
@@ -964,6 +2280,11 @@ int main()
                 // destroy session, skip render loop, exit render loop and quit
                 case XR_SESSION_STATE_LOSS_PENDING:
                 case XR_SESSION_STATE_EXITING:
+                    wait_for_render();
+                    input_stop(&state.input);
+                    haptics_stop(&state.haptics);
+                    // the session's GL context has to be current when it is destroyed
+                    stop_render_thread();
                     result = xrDestroySession(state.session);
                     if (result != XR_SUCCESS)
                     {
@@ -1015,6 +2336,7 @@ int main()
             runtime_event.type = XR_TYPE_EVENT_DATA_BUFFER;
             poll_result = xrPollEvent(state.instance, &runtime_event);
         }
+        cpu_zone_end();
         if (poll_result == XR_EVENT_UNAVAILABLE)
         {
             // processed all events in the queue
@@ -1030,10 +2352,22 @@ int main()
             continue;
         }
 
+        if (SDL_AtomicGet(&state.render_failed))
+        {
+            break;
+        }
+
+        // the render thread hands packets back in order, so this one finished longest ago
+        frame_packet_t *packet = frame_queue_pop(&state.free_packets);
+        retire_packet(packet);
+
         // Wait for our turn to do head-pose dependent computation and render a frame
         XrFrameState frame_state = {.type = XR_TYPE_FRAME_STATE};
         XrFrameWaitInfo frame_wait_info = {.type = XR_TYPE_FRAME_WAIT_INFO};
+        cpu_zone_begin("xrWaitFrame", -1);
+        uint64_t wait_start_ns = clock_ns();
         result = xrWaitFrame(state.session, &frame_wait_info, &frame_state);
+        cpu_zone_end();
 
         if (result != XR_SUCCESS)
         {
@@ -1041,277 +2375,230 @@ int main()
             return 1;
         }
 
-        //! @todo Move this action processing to before xrWaitFrame, probably.
-        const XrActiveActionSet active_actionsets[] = {
-            {
-                .actionSet = state.gameplay_actionset,
-                .subactionPath = XR_NULL_PATH,
-            },
-        };
-
-        XrActionsSyncInfo actions_sync_info = {
-            .type = XR_TYPE_ACTIONS_SYNC_INFO,
-            .countActiveActionSets = sizeof(active_actionsets) / sizeof(active_actionsets[0]),
-            .activeActionSets = active_actionsets,
-        };
-        result = xrSyncActions(state.session, &actions_sync_info);
-        if (result != XR_SUCCESS)
-        {
-            printf("Failed to sync actions\n");
-            // return 1;
-        }
+        // the CPU work of the frame, from its wait returning to its submission
+        uint64_t frame_start_ns = clock_ns();
+        frame_pacing_wait(&state.pacing, frame_start_ns - wait_start_ns, frame_state.predictedDisplayTime,
+                          frame_state.predictedDisplayPeriod, frame_state.shouldRender);
+        cpu_zone_begin("frame", -1);
 
-        // query each value / location with a subaction path != XR_NULL_PATH
-        // resulting in individual values per hand/.
+        // Input is sampled once the display time the poses are predicted for is known, unless the
+        // input thread samples it on its own schedule and this only takes the newest snapshot. Syncing
+        // before xrWaitFrame instead would hand the frame values a whole wait older.
         XrActionStateFloat grab_value[HAND_COUNT];
         XrSpaceLocation hand_locations[HAND_COUNT];
 
-        for (int i = 0; i < HAND_COUNT; i++)
+        // a replayed frame stands in for every tracking query, the last one repeats once it ends
+        int replaying = options.replay_poses_path != NULL;
+        if (replaying && !pose_trace_next(&state.pose_trace))
+        {
+            replay_finished = 1;
+        }
+
+        cpu_zone_begin("input", -1);
+        uint64_t hand_located_ns = 0;
+        if (replaying)
         {
-            XrActionStatePose hand_pose_state = {.type = XR_TYPE_ACTION_STATE_POSE};
+            for (int i = 0; i < HAND_COUNT; i++)
             {
-                XrActionStateGetInfo get_info = {
-                    .type = XR_TYPE_ACTION_STATE_GET_INFO,
-                    .action = state.hand_pose_action,
-                    .subactionPath = state.hand_paths[i],
-                };
-                result = xrGetActionStatePose(state.session, &get_info, &hand_pose_state);
-                if (result != XR_SUCCESS)
-                {
-                    printf("Failed to get pose action\n");
-                    // return 1;
-                }
+                hand_locations[i] = (XrSpaceLocation){.type = XR_TYPE_SPACE_LOCATION};
+                grab_value[i] = (XrActionStateFloat){.type = XR_TYPE_ACTION_STATE_FLOAT};
             }
-
-            hand_locations[i].type = XR_TYPE_SPACE_LOCATION;
-            hand_locations[i].next = NULL;
-
-            result = xrLocateSpace(state.hand_pose_spaces[i], state.play_space, frame_state.predictedDisplayTime, &hand_locations[i]);
-            if (result != XR_SUCCESS)
+            pose_trace_get_hands(&state.pose_trace, hand_locations, grab_value);
+        }
+        else
+        {
+            if (state.input.thread)
+            {
+                input_set_frame_time(&state.input, frame_state.predictedDisplayTime);
+            }
+            else
             {
-                printf("Failed to locate space \n");
-                // return 1;
+                input_sample(&state.input, frame_state.predictedDisplayTime);
             }
 
-            /*
-			printf("Pose %d valid %d: %f %f %f %f, %f %f %f\n", i,
-			spaceLocationValid[i], spaceLocation[0].pose.orientation.x,
-			spaceLocation[0].pose.orientation.y, spaceLocation[0].pose.orientation.z,
-			spaceLocation[0].pose.orientation.w, spaceLocation[0].pose.position.x,
-			spaceLocation[0].pose.position.y, spaceLocation[0].pose.position.z
-			);
-			*/
-
-            grab_value[i].type = XR_TYPE_ACTION_STATE_FLOAT;
-            grab_value[i].next = NULL;
+            // one snapshot, so every value the frame reads comes from the same sync
+            const input_snapshot_t *input = input_read(&state.input);
+            for (int i = 0; i < HAND_COUNT; i++)
             {
-                XrActionStateGetInfo get_info = {
-                    .type = XR_TYPE_ACTION_STATE_GET_INFO,
-                    .action = state.grab_action_float,
-                    .subactionPath = state.hand_paths[i],
-                };
-
-                result = xrGetActionStateFloat(state.session, &get_info, &grab_value[i]);
-                if (result != XR_SUCCESS)
-                {
-                    printf("Failed to get grab action \n");
-                    // return 1;
-                }
+                grab_value[i] = input->floats[state.grab_input][i];
+                hand_locations[i] = input->locations[state.hand_pose_input][i];
             }
+            hand_located_ns = input->sampled_ns;
+        }
 
-            // printf("Grab %d active %d, current %f, changed %d\n", i,
-            // grabValue[i].isActive, grabValue[i].currentState,
-            // grabValue[i].changedSinceLastSync);
+        if (options.record_poses_path)
+        {
+            pose_trace_set_hands(&state.pose_trace, hand_locations, grab_value);
+        }
 
+        // a trigger held down buzzes, each frame keeps the vibration going two periods longer
+        for (int i = 0; i < HAND_COUNT; i++)
+        {
             if (grab_value[i].isActive && grab_value[i].currentState > 0.75)
             {
-                XrHapticVibration vibration = {
-                    .type = XR_TYPE_HAPTIC_VIBRATION,
-                    .amplitude = 0.5,
-                    .duration = XR_MIN_HAPTIC_DURATION,
-                    .frequency = XR_FREQUENCY_UNSPECIFIED,
-                };
-
-                XrHapticActionInfo haptic_action_info = {
-                    .type = XR_TYPE_HAPTIC_ACTION_INFO,
-                    .action = state.haptic_action,
-                    .subactionPath = state.hand_paths[i],
-                };
-
-                result = xrApplyHapticFeedback(state.session, &haptic_action_info, (const XrHapticBaseHeader *)&vibration);
-                if (result != XR_SUCCESS)
-                {
-                    printf("Failed to apply haptics\n");
-                    // return 1;
-                }
-                // printf("Sent haptic output to hand %d\n", i);
+                haptics_request(&state.haptics, i, 0.5f, XR_FREQUENCY_UNSPECIFIED, 2 * frame_state.predictedDisplayPeriod);
             }
-        };
-
-        // Begin frame
-        XrFrameBeginInfo frame_begin_info = {.type = XR_TYPE_FRAME_BEGIN_INFO};
-        result = xrBeginFrame(state.session, &frame_begin_info);
-        if (result != XR_SUCCESS)
+        }
+        if (!state.input.thread)
         {
-            printf("Failed to begin frame\n");
-            break;
+            haptics_update(&state.haptics);
         }
 
+        cpu_zone_end();
+
         // Create view, projection matrices
         XrViewLocateInfo view_locate_info = {
             .type = XR_TYPE_VIEW_LOCATE_INFO,
-            .viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+            .viewConfigurationType = state.view_type,
             .displayTime = frame_state.predictedDisplayTime,
             .space = state.play_space,
         };
 
         XrViewState view_state = {.type = XR_TYPE_VIEW_STATE};
-        result = xrLocateViews(state.session, &view_locate_info, &view_state, 0, &state.view_count, NULL);
-        if (result != XR_SUCCESS)
-        {
-            printf("Failed to locate views\n");
-            return 1;
-        }
-
-        result = xrLocateViews(state.session, &view_locate_info, &view_state, state.view_count, &state.view_count, state.views);
-        if (result != XR_SUCCESS)
+        if (replaying)
         {
-            printf("Failed to locate views\n");
-            return 1;
+            pose_trace_get_views(&state.pose_trace, &view_state, state.views);
         }
-
-        // Render each eye and fill projection_views with the result
-        for (int i = 0; i < state.view_count; i++)
+        else
         {
-            if (!frame_state.shouldRender)
-            {
-                printf("shouldRender = false, Skipping rendering work\n");
-                continue;
-            }
-
-            uint32_t acquired_index;
-            XrSwapchainImageAcquireInfo acquire_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
-            result = xrAcquireSwapchainImage(state.swapchains[i], &acquire_info, &acquired_index);
-            if (result != XR_SUCCESS)
-            {
-                printf("Failed to acquire swapchain image\n");
-                break;
-            }
-
-            uint32_t depth_acquired_index = UINT32_MAX;
-            XrSwapchainImageAcquireInfo depth_acquire_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
-            result = xrAcquireSwapchainImage(state.depths[i], &depth_acquire_info, &depth_acquired_index);
-            if (result != XR_SUCCESS)
-            {
-                printf("Failed to acquire swapchain image\n");
-                break;
-            }
-
-            XrSwapchainImageWaitInfo wait_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO, .timeout = 1000};
-            result = xrWaitSwapchainImage(state.swapchains[i], &wait_info);
-            if (result != XR_SUCCESS)
-            {
-                printf("Failed to wait for swapchain image\n");
-                break;
-            }
-
-            XrSwapchainImageWaitInfo depth_wait_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO, .timeout = 1000};
-            result = xrWaitSwapchainImage(state.depths[i], &depth_wait_info);
-            if (result != XR_SUCCESS)
-            {
-                printf("Failed to wait for swapchain image\n");
-                break;
-            }
-
-            int w = state.view_confs[i].recommendedImageRectWidth;
-            int h = state.view_confs[i].recommendedImageRectHeight;
-
-            float proj[16];
-            mat4_proj_xr(proj, state.views[i].fov, state.near_z, state.far_z);
-
-            float translation[16];
-            mat4_identity(translation);
-            mat4_translate(translation, translation, (float *)&state.views[i].pose.position);
-
-            float rotation[16];
-            mat4_rotation_quat(rotation, (float *)&state.views[i].pose.orientation);
-
-            float view[16];
-            mat4_multiply(view, translation, rotation);
-            mat4_inverse(view, view);
-
-            state.proj_views[i].pose = state.views[i].pose;
-            state.proj_views[i].fov = state.views[i].fov;
-
-            GLuint framebuffer = state.framebuffers[i][acquired_index];
-            GLuint swap_image = state.swapchain_images[i][acquired_index].image;
-            GLuint depth_image = state.depth_images[i][depth_acquired_index].image;
-
-            render_frame(w, h, frame_state.predictedDisplayTime, i, hand_locations, proj, view, framebuffer, swap_image, depth_image);
-
-            XrSwapchainImageReleaseInfo release_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO, .next = NULL};
-            result = xrReleaseSwapchainImage(state.swapchains[i], &release_info);
+            // state.view_count is fixed at startup, the render thread reads it
+            uint32_t located_view_count = 0;
+            cpu_zone_begin("xrLocateViews", -1);
+            result = view_cache_locate(&state.view_cache, state.session, &view_locate_info, &view_state, MAX_VIEWS, &located_view_count, state.views);
+            cpu_zone_end();
             if (result != XR_SUCCESS)
             {
-                printf("Failed to release for swapchain image\n");
-                break;
+                printf("Failed to locate views\n");
+                return 1;
             }
-
-            XrSwapchainImageReleaseInfo depth_release_info = {.type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
-            result = xrReleaseSwapchainImage(state.depths[i], &depth_release_info);
-            if (result != XR_SUCCESS)
+            if (located_view_count != state.view_count)
             {
-                printf("Failed to release for swapchain image\n");
-                break;
+                printf("Located %u views, the view configuration has %u\n", located_view_count, state.view_count);
+                return 1;
             }
         }
 
-        XrCompositionLayerProjection projection_layer = {
-            .type = XR_TYPE_COMPOSITION_LAYER_PROJECTION,
-            .layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT,
-            .space = state.play_space,
-            .viewCount = state.view_count,
-            .views = state.proj_views,
-        };
-
-        int submitted_layer_count = 1;
-        const XrCompositionLayerBaseHeader *submitted_layers[1] = {(const XrCompositionLayerBaseHeader *const)&projection_layer};
-
-        if ((view_state.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT) == 0)
+        // the scene animates on the display time, a replay takes the recorded one to repeat exactly
+        XrTime scene_time = replaying ? state.pose_trace.frame.display_time : frame_state.predictedDisplayTime;
+        if (options.record_poses_path)
         {
-            printf("submitting 0 layers because orientation is invalid\n");
-            submitted_layer_count = 0;
+            pose_trace_write(&state.pose_trace, frame_state.predictedDisplayTime, &view_state, state.views);
         }
 
-        if (!frame_state.shouldRender)
+        // the fovs of the focus views are only known once the views are located
+        if (state.view_type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO && state.view_count == 4 && state.stereo_pixel_ratio == 0.0 &&
+            (view_state.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT))
         {
-            printf("submitting 0 layers because shouldRender = false\n");
-            submitted_layer_count = 0;
+            print_quad_view_pixels();
         }
 
-        XrFrameEndInfo frame_end_info = {
-            .type = XR_TYPE_FRAME_END_INFO,
-            .displayTime = frame_state.predictedDisplayTime,
-            .layerCount = submitted_layer_count,
-            .layers = submitted_layers,
-            .environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE,
-        };
+        // Build each eye's matrices, the render thread fills projection_views from the packet's views
+        frame_uniforms_t *frame_uniforms = &packet->uniforms;
+        memset(frame_uniforms, 0, sizeof(*frame_uniforms));
+        view_cache_begin_frame(&state.view_cache);
+        for (int i = 0; i < state.view_count; i++)
+        {
+            memcpy(frame_uniforms->proj[i], view_cache_projection(&state.view_cache, i, &state.views[i].fov), sizeof(frame_uniforms->proj[i]));
+            view_cache_view_matrix(frame_uniforms->view[i], &state.views[i].pose);
 
-        result = xrEndFrame(state.session, &frame_end_info);
-        if (result != XR_SUCCESS)
+            packet->views[i] = state.views[i];
+        }
+
+        if (frame_state.shouldRender)
         {
-            printf("Failed to end frame\n");
-            break;
+            frame_uniforms->time[0] = (float)(((double)scene_time) / (1000. * 1000. * 1000.));
+
+            cpu_zone_begin("build scene", -1);
+            build_scene(packet, scene_time, hand_locations);
+            cpu_zone_end();
         }
+
+        packet->frame_state = frame_state;
+        packet->frame_start_ns = frame_start_ns;
+        packet->view_state = view_state;
+        packet->hand_located_ns = replaying || options.no_late_latch ? 0 : hand_located_ns;
+        cpu_zone_end();
+
+        // blocks only if the render thread is a whole queue behind
+        frame_queue_push(&state.ready_packets, packet);
     }
 
+    input_stop(&state.input);
+
+    stop_render_thread();
+
     // Cleanup
-    for (int i = 0; i < state.view_count; i++)
+    frame_queue_close(&state.free_packets);
+    frame_packet_t *packet;
+    while ((packet = frame_queue_pop(&state.free_packets)) != NULL)
+    {
+        retire_packet(packet);
+    }
+    for (int i = 0; i < FRAME_PACKETS; i++)
+    {
+        free(state.packets[i].instances);
+    }
+    frame_queue_free(&state.ready_packets);
+    frame_queue_free(&state.free_packets);
+
+    for (int i = 0; i < state.swapchain_count; i++)
     {
         glDeleteFramebuffers(state.swapchain_lengths[i], state.framebuffers[i]);
     }
 
+    if (state.multiview)
+    {
+        glDeleteFramebuffers(1, &state.mirror_framebuffer);
+    }
+
+    cull_print_stats(&state.cull);
+    cull_free(&state.cull);
+    bvh_free(&state.scene_bvh);
+    free(state.scene_query);
+    free(state.scene_objects);
+    free(state.scene_order);
+    gpu_ring_print_stats(&state.frame_ring);
+    gpu_ring_free(&state.frame_ring);
+    if (!options.no_dynamic_resolution)
+    {
+        resolution_print_stats(&state.resolution);
+    }
+    if (state.stereo_pixel_ratio > 0.0 && state.gpu_frames)
+    {
+        // only the quad view time is measured, the stereo time assumes GPU time follows the pixel count
+        double quad_ms = state.gpu_ms_total / state.gpu_frames;
+        printf("Quad views: %.2f ms GPU per frame measured, stereo at focus density estimated at %.2f ms\n",
+               quad_ms, quad_ms / state.stereo_pixel_ratio);
+    }
+    gpu_timer_free(&state.gpu_timer);
+    gpu_profiler_print_stats(&state.gpu_profiler);
+    gpu_profiler_print_frame(&state.gpu_profiler);
+    gpu_profiler_free(&state.gpu_profiler);
+    mesh_free(&state.cube_mesh);
+    gltf_stream_free(&state.gltf);
+    program_destroy(&state.program);
+
+    frame_pacing_print_stats(&state.pacing);
+    view_cache_print_stats(&state.view_cache);
+    input_print_stats(&state.input);
+    haptics_print_stats(&state.haptics);
+    haptics_free(&state.haptics);
+    if (state.late_latch_frames)
+    {
+        printf("Late latching: controllers located again in %llu frames, %.3f ms newer on average, %.3f ms at most\n",
+               (unsigned long long)state.late_latch_frames, state.late_latch_total_ns / 1e6 / state.late_latch_frames, state.late_latch_max_ns / 1e6);
+    }
+    pose_trace_close(&state.pose_trace);
+    if (options.trace_path)
+    {
+        cpu_profiler_write_trace(options.trace_path);
+    }
+    cpu_profiler_free();
+
     xrDestroyInstance(state.instance);
+#ifndef _WIN32
+    egl_context_destroy(&state.egl);
+#endif
 
     return 0;
 }
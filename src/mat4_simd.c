@@ -0,0 +1,394 @@
+#include "mat4_simd.h"
+
+#include "mathc.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MAT4_SSE 1
+#include <xmmintrin.h>
+#else
+#define MAT4_SSE 0
+#endif
+
+// AVX2 is not part of the x86-64 baseline, its kernels are built for it on their own and only
+// run once cpuid says so. MSVC has no per-function targets, it stays on SSE.
+#if MAT4_SSE && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MAT4_AVX2 1
+#include <cpuid.h>
+#include <immintrin.h>
+#define MAT4_AVX2_TARGET __attribute__((target("avx,avx2,fma")))
+#else
+#define MAT4_AVX2 0
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define MAT4_NEON 1
+#include <arm_neon.h>
+#else
+#define MAT4_NEON 0
+#endif
+
+// Every kernel transforms count column vectors by a matrix, a product being the transform of
+// the right matrix's columns, so one loop serves both
+typedef void (*transform_kernel_t)(float *result, const float *vectors, uint32_t count, const float m0[16]);
+typedef void (*inverse_kernel_t)(float result[16], const float m0[16]);
+
+// The sums run in the same order as mathc's, c0 * x + c1 * y + c2 * z + c3 * w from the left
+static void transform_scalar(float *result, const float *vectors, uint32_t count, const float m0[16])
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float *v = &vectors[i * 4];
+        float x = v[0], y = v[1], z = v[2], w = v[3];
+        float *r = &result[i * 4];
+        for (int k = 0; k < 4; k++)
+        {
+            r[k] = m0[k] * x + m0[4 + k] * y + m0[8 + k] * z + m0[12 + k] * w;
+        }
+    }
+}
+
+// mathc reads the whole matrix before it writes the result
+static void inverse_scalar(float result[16], const float m0[16])
+{
+    mat4_inverse(result, (float *)m0);
+}
+
+#if MAT4_SSE
+static void transform_sse(float *result, const float *vectors, uint32_t count, const float m0[16])
+{
+    __m128 c0 = _mm_loadu_ps(&m0[0]);
+    __m128 c1 = _mm_loadu_ps(&m0[4]);
+    __m128 c2 = _mm_loadu_ps(&m0[8]);
+    __m128 c3 = _mm_loadu_ps(&m0[12]);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        __m128 v = _mm_loadu_ps(&vectors[i * 4]);
+        __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, 0x00));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, 0x55)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, 0xaa)));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, 0xff)));
+        _mm_storeu_ps(&result[i * 4], r);
+    }
+}
+
+#define SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define SWIZZLE(a, x, y, z, w) SHUFFLE(a, a, x, y, z, w)
+
+// 2x2 blocks held as one register, a b c d for the block with rows (a b) and (c d)
+
+// a * b
+static __m128 block_multiply(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adjugate(a) * b
+static __m128 block_adjugate_multiply(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(SWIZZLE(a, 1, 1, 2, 2), SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// a * adjugate(b)
+static __m128 block_multiply_adjugate(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// The inverse of the block matrix (A B; C D) from the adjugates and determinants of its 2x2
+// blocks. The blocks are taken as if the columns were rows, which gives the inverse of the
+// transpose, and that stored the same way is the inverse.
+static void inverse_sse(float result[16], const float m0[16])
+{
+    __m128 r0 = _mm_loadu_ps(&m0[0]);
+    __m128 r1 = _mm_loadu_ps(&m0[4]);
+    __m128 r2 = _mm_loadu_ps(&m0[8]);
+    __m128 r3 = _mm_loadu_ps(&m0[12]);
+
+    __m128 a = _mm_movelh_ps(r0, r1);
+    __m128 b = _mm_movehl_ps(r1, r0);
+    __m128 c = _mm_movelh_ps(r2, r3);
+    __m128 d = _mm_movehl_ps(r3, r2);
+
+    // |A| |B| |C| |D|
+    __m128 block_determinants = _mm_sub_ps(_mm_mul_ps(SHUFFLE(r0, r2, 0, 2, 0, 2), SHUFFLE(r1, r3, 1, 3, 1, 3)),
+                                           _mm_mul_ps(SHUFFLE(r0, r2, 1, 3, 1, 3), SHUFFLE(r1, r3, 0, 2, 0, 2)));
+    __m128 det_a = SWIZZLE(block_determinants, 0, 0, 0, 0);
+    __m128 det_b = SWIZZLE(block_determinants, 1, 1, 1, 1);
+    __m128 det_c = SWIZZLE(block_determinants, 2, 2, 2, 2);
+    __m128 det_d = SWIZZLE(block_determinants, 3, 3, 3, 3);
+
+    __m128 adj_d_c = block_adjugate_multiply(d, c);
+    __m128 adj_a_b = block_adjugate_multiply(a, b);
+
+    // the adjugates of the blocks of the inverse, before the division by the determinant
+    __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), block_multiply(b, adj_d_c));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), block_multiply(c, adj_a_b));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), block_multiply_adjugate(d, adj_a_b));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), block_multiply_adjugate(a, adj_d_c));
+
+    // |M| = |A| |D| + |B| |C| - tr(adjugate(A) B adjugate(D) C)
+    __m128 trace = _mm_mul_ps(adj_a_b, SWIZZLE(adj_d_c, 0, 2, 1, 3));
+    trace = _mm_add_ps(trace, SWIZZLE(trace, 1, 0, 3, 2));
+    trace = _mm_add_ps(trace, SWIZZLE(trace, 2, 3, 0, 1));
+    __m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), trace);
+
+    // the signs turn the adjugates back into the blocks
+    __m128 inverse_determinant = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+    x = _mm_mul_ps(x, inverse_determinant);
+    y = _mm_mul_ps(y, inverse_determinant);
+    z = _mm_mul_ps(z, inverse_determinant);
+    w = _mm_mul_ps(w, inverse_determinant);
+
+    _mm_storeu_ps(&result[0], SHUFFLE(x, y, 3, 1, 3, 1));
+    _mm_storeu_ps(&result[4], SHUFFLE(x, y, 2, 0, 2, 0));
+    _mm_storeu_ps(&result[8], SHUFFLE(z, w, 3, 1, 3, 1));
+    _mm_storeu_ps(&result[12], SHUFFLE(z, w, 2, 0, 2, 0));
+}
+
+#undef SWIZZLE
+#undef SHUFFLE
+#endif
+
+#if MAT4_AVX2
+// Two vectors per register, each lane holding the matrix columns and one vector's coordinates
+MAT4_AVX2_TARGET static void transform_avx2(float *result, const float *vectors, uint32_t count, const float m0[16])
+{
+    __m256 c0 = _mm256_broadcast_ps((const __m128 *)&m0[0]);
+    __m256 c1 = _mm256_broadcast_ps((const __m128 *)&m0[4]);
+    __m256 c2 = _mm256_broadcast_ps((const __m128 *)&m0[8]);
+    __m256 c3 = _mm256_broadcast_ps((const __m128 *)&m0[12]);
+
+    uint32_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 v = _mm256_loadu_ps(&vectors[i * 4]);
+        __m256 r = _mm256_mul_ps(c0, _mm256_shuffle_ps(v, v, 0x00));
+        r = _mm256_fmadd_ps(c1, _mm256_shuffle_ps(v, v, 0x55), r);
+        r = _mm256_fmadd_ps(c2, _mm256_shuffle_ps(v, v, 0xaa), r);
+        r = _mm256_fmadd_ps(c3, _mm256_shuffle_ps(v, v, 0xff), r);
+        _mm256_storeu_ps(&result[i * 4], r);
+    }
+
+    if (i < count)
+    {
+        __m128 v = _mm_loadu_ps(&vectors[i * 4]);
+        __m128 r = _mm_mul_ps(_mm256_castps256_ps128(c0), _mm_shuffle_ps(v, v, 0x00));
+        r = _mm_fmadd_ps(_mm256_castps256_ps128(c1), _mm_shuffle_ps(v, v, 0x55), r);
+        r = _mm_fmadd_ps(_mm256_castps256_ps128(c2), _mm_shuffle_ps(v, v, 0xaa), r);
+        r = _mm_fmadd_ps(_mm256_castps256_ps128(c3), _mm_shuffle_ps(v, v, 0xff), r);
+        _mm_storeu_ps(&result[i * 4], r);
+    }
+}
+
+// AVX2 and FMA, and the OS saving the AVX registers on a switch
+static int cpu_has_avx2(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return 0;
+    }
+    const unsigned int fma = 1u << 12, osxsave = 1u << 27, avx = 1u << 28;
+    if ((ecx & (fma | osxsave | avx)) != (fma | osxsave | avx))
+    {
+        return 0;
+    }
+
+    unsigned int xcr0, xcr0_high;
+    __asm__ volatile("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+    if ((xcr0 & 6) != 6)
+    {
+        return 0;
+    }
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return 0;
+    }
+    return (ebx & (1u << 5)) != 0;
+}
+#endif
+
+#if MAT4_NEON
+static void transform_neon(float *result, const float *vectors, uint32_t count, const float m0[16])
+{
+    float32x4_t c0 = vld1q_f32(&m0[0]);
+    float32x4_t c1 = vld1q_f32(&m0[4]);
+    float32x4_t c2 = vld1q_f32(&m0[8]);
+    float32x4_t c3 = vld1q_f32(&m0[12]);
+
+    // vmlaq is a separate multiply and add, not fused, so the sums round like mathc's
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float32x4_t v = vld1q_f32(&vectors[i * 4]);
+        float32x4_t r = vmulq_laneq_f32(c0, v, 0);
+        r = vmlaq_laneq_f32(r, c1, v, 1);
+        r = vmlaq_laneq_f32(r, c2, v, 2);
+        r = vmlaq_laneq_f32(r, c3, v, 3);
+        vst1q_f32(&result[i * 4], r);
+    }
+}
+#endif
+
+#if MAT4_NEON
+static mat4_simd_level_t level = MAT4_SIMD_NEON;
+static transform_kernel_t transform_kernel = transform_neon;
+static inverse_kernel_t inverse_kernel = inverse_scalar;
+#elif MAT4_SSE
+static mat4_simd_level_t level = MAT4_SIMD_SSE;
+static transform_kernel_t transform_kernel = transform_sse;
+static inverse_kernel_t inverse_kernel = inverse_sse;
+#else
+static mat4_simd_level_t level = MAT4_SIMD_SCALAR;
+static transform_kernel_t transform_kernel = transform_scalar;
+static inverse_kernel_t inverse_kernel = inverse_scalar;
+#endif
+
+int mat4_simd_use(mat4_simd_level_t use_level)
+{
+    switch (use_level)
+    {
+    case MAT4_SIMD_SCALAR:
+        transform_kernel = transform_scalar;
+        inverse_kernel = inverse_scalar;
+        break;
+#if MAT4_SSE
+    case MAT4_SIMD_SSE:
+        transform_kernel = transform_sse;
+        inverse_kernel = inverse_sse;
+        break;
+#endif
+#if MAT4_AVX2
+    case MAT4_SIMD_AVX2:
+        if (!cpu_has_avx2())
+        {
+            return 0;
+        }
+        // one matrix does not fill the wider registers, the inverse stays on SSE
+        transform_kernel = transform_avx2;
+        inverse_kernel = inverse_sse;
+        break;
+#endif
+#if MAT4_NEON
+    case MAT4_SIMD_NEON:
+        transform_kernel = transform_neon;
+        inverse_kernel = inverse_scalar;
+        break;
+#endif
+    default:
+        return 0;
+    }
+
+    level = use_level;
+    return 1;
+}
+
+mat4_simd_level_t mat4_simd_init(void)
+{
+    mat4_simd_use(MAT4_SIMD_AVX2);
+    return level;
+}
+
+mat4_simd_level_t mat4_simd_level(void)
+{
+    return level;
+}
+
+const char *mat4_simd_name(mat4_simd_level_t name_level)
+{
+    switch (name_level)
+    {
+    case MAT4_SIMD_SCALAR:
+        return "scalar";
+    case MAT4_SIMD_SSE:
+        return "SSE";
+    case MAT4_SIMD_AVX2:
+        return "AVX2";
+    case MAT4_SIMD_NEON:
+        return "NEON";
+    }
+    return "unknown";
+}
+
+void mat4_multiply_simd(float result[16], const float m0[16], const float m1[16])
+{
+    if (result == m0)
+    {
+        // the scalar kernel reads the matrix while it writes the result
+        float copy[16];
+        for (int k = 0; k < 16; k++)
+        {
+            copy[k] = m0[k];
+        }
+        transform_kernel(result, m1, 4, copy);
+        return;
+    }
+    transform_kernel(result, m1, 4, m0);
+}
+
+void mat4_inverse_simd(float result[16], const float m0[16])
+{
+    inverse_kernel(result, m0);
+}
+
+// A handful of products per element with nothing to share a register between, so this is
+// mathc's arithmetic with the quaternion read first
+void mat4_rotation_quat_simd(float result[16], const float q[4])
+{
+    float x = q[0], y = q[1], z = q[2], w = q[3];
+    float xx = x * x;
+    float yy = y * y;
+    float zz = z * z;
+    float xy = x * y;
+    float zw = z * w;
+    float xz = x * z;
+    float yw = y * w;
+    float yz = y * z;
+    float xw = x * w;
+    result[0] = 1.0f - 2.0f * (yy + zz);
+    result[1] = 2.0f * (xy + zw);
+    result[2] = 2.0f * (xz - yw);
+    result[3] = 0.0f;
+    result[4] = 2.0f * (xy - zw);
+    result[5] = 1.0f - 2.0f * (xx + zz);
+    result[6] = 2.0f * (yz + xw);
+    result[7] = 0.0f;
+    result[8] = 2.0f * (xz + yw);
+    result[9] = 2.0f * (yz - xw);
+    result[10] = 1.0f - 2.0f * (xx + yy);
+    result[11] = 0.0f;
+    result[12] = 0.0f;
+    result[13] = 0.0f;
+    result[14] = 0.0f;
+    result[15] = 1.0f;
+}
+
+// The scale only multiplies the rotation's columns and the translation is the last column, so
+// neither needs a product
+void mat4_trs(float result[16], const float translation[3], const float q[4], const float scale[3])
+{
+    float t[3] = {translation[0], translation[1], translation[2]};
+    float s[3] = {scale[0], scale[1], scale[2]};
+    mat4_rotation_quat_simd(result, q);
+    for (int c = 0; c < 3; c++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            result[c * 4 + k] *= s[c];
+        }
+    }
+    result[12] = t[0];
+    result[13] = t[1];
+    result[14] = t[2];
+}
+
+void vec4_multiply_mat4_simd(float result[4], const float v0[4], const float m0[16])
+{
+    transform_kernel(result, v0, 1, m0);
+}
+
+void mat4_transform_vec4_simd(float *result, const float *vectors, uint32_t count, const float m0[16])
+{
+    transform_kernel(result, vectors, count, m0);
+}
@@ -0,0 +1,41 @@
+#ifndef MAT4_SIMD_H
+#define MAT4_SIMD_H
+
+#include <stdint.h>
+
+// SIMD versions of the mathc mat4 functions on the scene update path, same column major layout.
+// Unlike mathc every input is read before the result is written, so the result may be any of
+// the inputs. The SSE and NEON kernels do the same operations in the same order as mathc and
+// give the same bits; AVX2 fuses multiply-adds, which is at most a rounding step closer. The
+// inverse uses 2x2 blocks rather than cofactors and differs by rounding.
+typedef enum mat4_simd_level_t
+{
+    MAT4_SIMD_SCALAR,
+    MAT4_SIMD_SSE,
+    MAT4_SIMD_AVX2, // with FMA, picked at runtime, SSE is used where it does not pay off
+    MAT4_SIMD_NEON,
+} mat4_simd_level_t;
+
+// Picks the widest kernels this CPU runs and returns their level. Until it is called the build's
+// baseline is used, SSE on x86-64 and NEON on arm64.
+mat4_simd_level_t mat4_simd_init(void);
+// Switches to a level for comparing them, returns 0 if the build or CPU lacks it
+int mat4_simd_use(mat4_simd_level_t level);
+mat4_simd_level_t mat4_simd_level(void);
+const char *mat4_simd_name(mat4_simd_level_t level);
+
+// result = m0 * m1
+void mat4_multiply_simd(float result[16], const float m0[16], const float m1[16]);
+// Singular matrices give infinities like mathc
+void mat4_inverse_simd(float result[16], const float m0[16]);
+// q is a unit quaternion x, y, z, w
+void mat4_rotation_quat_simd(float result[16], const float q[4]);
+// translation * rotation * scale for a position, a unit quaternion and per axis scales
+void mat4_trs(float result[16], const float translation[3], const float q[4], const float scale[3]);
+
+// result = m0 * v0
+void vec4_multiply_mat4_simd(float result[4], const float v0[4], const float m0[16]);
+// count vectors of 4 floats, result may be vectors
+void mat4_transform_vec4_simd(float *result, const float *vectors, uint32_t count, const float m0[16]);
+
+#endif
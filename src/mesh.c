@@ -0,0 +1,652 @@
+#include "mesh.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Forsyth scoring constants, see "Linear-Speed Vertex Cache Optimisation"
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRI_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+static uint32_t hash_vertex(const mesh_vertex_t *vertex)
+{
+    // FNV-1a over the vertex bytes, exact duplicates only
+    const uint8_t *bytes = (const uint8_t *)vertex;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(mesh_vertex_t); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+int mesh_data_from_triangles(mesh_data_t *mesh, const mesh_vertex_t *vertices, uint32_t vertex_count)
+{
+    memset(mesh, 0, sizeof(*mesh));
+
+    uint32_t table_size = 1;
+    while (table_size < vertex_count * 2)
+    {
+        table_size *= 2;
+    }
+
+    uint32_t *table = malloc(table_size * sizeof(uint32_t));
+    mesh->vertices = malloc(vertex_count * sizeof(mesh_vertex_t));
+    mesh->indices = malloc(vertex_count * sizeof(uint32_t));
+    if (!table || !mesh->vertices || !mesh->indices)
+    {
+        free(table);
+        mesh_data_free(mesh);
+        return 0;
+    }
+
+    memset(table, 0xff, table_size * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        uint32_t slot = hash_vertex(&vertices[i]) & (table_size - 1);
+        while (table[slot] != UINT32_MAX && memcmp(&mesh->vertices[table[slot]], &vertices[i], sizeof(mesh_vertex_t)) != 0)
+        {
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if (table[slot] == UINT32_MAX)
+        {
+            table[slot] = mesh->vertex_count;
+            mesh->vertices[mesh->vertex_count++] = vertices[i];
+        }
+
+        mesh->indices[mesh->index_count++] = table[slot];
+    }
+
+    free(table);
+    return 1;
+}
+
+void mesh_data_free(mesh_data_t *mesh)
+{
+    free(mesh->vertices);
+    free(mesh->indices);
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+float mesh_data_radius(const mesh_data_t *mesh)
+{
+    float max_length_sq = 0.0f;
+    for (uint32_t i = 0; i < mesh->vertex_count; i++)
+    {
+        const float *p = mesh->vertices[i].position;
+        float length_sq = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+        if (length_sq > max_length_sq)
+        {
+            max_length_sq = length_sq;
+        }
+    }
+    return sqrtf(max_length_sq);
+}
+
+// FIFO cache simulation, a vertex is cached if it was loaded in the last size misses
+typedef struct fifo_cache_t
+{
+    uint32_t *timestamps;
+    uint32_t time;
+    uint32_t size;
+} fifo_cache_t;
+
+static int fifo_cache_init(fifo_cache_t *cache, uint32_t vertex_count, uint32_t size)
+{
+    cache->timestamps = calloc(vertex_count ? vertex_count : 1, sizeof(uint32_t));
+    cache->time = size + 1;
+    cache->size = size;
+    return cache->timestamps != NULL;
+}
+
+static void fifo_cache_flush(fifo_cache_t *cache)
+{
+    cache->time += cache->size + 1;
+}
+
+static uint32_t fifo_cache_triangle_misses(fifo_cache_t *cache, const uint32_t *triangle)
+{
+    uint32_t misses = 0;
+    for (int k = 0; k < 3; k++)
+    {
+        uint32_t v = triangle[k];
+        if (cache->time - cache->timestamps[v] > cache->size)
+        {
+            cache->timestamps[v] = cache->time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+float mesh_acmr(const uint32_t *indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size)
+{
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+    {
+        return 0.0f;
+    }
+
+    fifo_cache_t cache;
+    if (!fifo_cache_init(&cache, vertex_count, cache_size))
+    {
+        return 0.0f;
+    }
+
+    uint32_t misses = 0;
+    for (uint32_t t = 0; t < triangle_count; t++)
+    {
+        misses += fifo_cache_triangle_misses(&cache, &indices[t * 3]);
+    }
+
+    free(cache.timestamps);
+    return (float)misses / (float)triangle_count;
+}
+
+static float forsyth_vertex_score(int cache_position, uint32_t active_triangles)
+{
+    // vertices without triangles left to emit should never be picked
+    if (active_triangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+        {
+            // used by the last triangle, fixed score so it doesn't win just by being there
+            score = FORSYTH_LAST_TRI_SCORE;
+        }
+        else
+        {
+            const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cache_position - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    // boost vertices with few triangles left, to finish them off and avoid lone triangles
+    score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)active_triangles, -FORSYTH_VALENCE_BOOST_POWER);
+    return score;
+}
+
+int mesh_optimize_vertex_cache(uint32_t *indices, uint32_t index_count, uint32_t vertex_count)
+{
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+    {
+        return 1;
+    }
+
+    uint32_t *active = calloc(vertex_count, sizeof(uint32_t));
+    uint32_t *offsets = malloc(vertex_count * sizeof(uint32_t));
+    uint32_t *adjacency = malloc(index_count * sizeof(uint32_t));
+    int *cache_position = malloc(vertex_count * sizeof(int));
+    float *vertex_scores = malloc(vertex_count * sizeof(float));
+    float *triangle_scores = malloc(triangle_count * sizeof(float));
+    uint8_t *emitted = calloc(triangle_count, 1);
+    uint32_t *output = malloc(index_count * sizeof(uint32_t));
+
+    int ok = active && offsets && adjacency && cache_position && vertex_scores && triangle_scores && emitted && output;
+    if (ok)
+    {
+        // triangles using each vertex, as one flat array indexed by offsets
+        for (uint32_t i = 0; i < triangle_count * 3; i++)
+        {
+            active[indices[i]]++;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            offsets[v] = offset;
+            offset += active[v];
+            active[v] = 0;
+        }
+
+        for (uint32_t t = 0; t < triangle_count; t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[t * 3 + k];
+                adjacency[offsets[v] + active[v]++] = t;
+            }
+        }
+
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            cache_position[v] = -1;
+            vertex_scores[v] = forsyth_vertex_score(-1, active[v]);
+        }
+
+        uint32_t best_triangle = 0;
+        float best_score = -1.0f;
+        for (uint32_t t = 0; t < triangle_count; t++)
+        {
+            const uint32_t *tri = &indices[t * 3];
+            triangle_scores[t] = vertex_scores[tri[0]] + vertex_scores[tri[1]] + vertex_scores[tri[2]];
+            if (triangle_scores[t] > best_score)
+            {
+                best_score = triangle_scores[t];
+                best_triangle = t;
+            }
+        }
+
+        uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t cache_count = 0;
+        uint32_t next_unemitted = 0;
+
+        for (uint32_t out = 0; out < triangle_count; out++)
+        {
+            // nothing adjacent to the cache left, continue with the next triangle in input order
+            if (best_triangle == UINT32_MAX)
+            {
+                while (emitted[next_unemitted])
+                {
+                    next_unemitted++;
+                }
+                best_triangle = next_unemitted;
+            }
+
+            const uint32_t *tri = &indices[best_triangle * 3];
+            memcpy(&output[out * 3], tri, 3 * sizeof(uint32_t));
+            emitted[best_triangle] = 1;
+
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = tri[k];
+                uint32_t *list = &adjacency[offsets[v]];
+                for (uint32_t i = 0; i < active[v]; i++)
+                {
+                    if (list[i] == best_triangle)
+                    {
+                        list[i] = list[--active[v]];
+                        break;
+                    }
+                }
+            }
+
+            // LRU update, the triangle's vertices move to the front
+            uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+            uint32_t new_count = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                if (new_count == 0 || (tri[k] != new_cache[0] && (new_count < 2 || tri[k] != new_cache[1])))
+                {
+                    new_cache[new_count++] = tri[k];
+                }
+            }
+
+            for (uint32_t i = 0; i < cache_count; i++)
+            {
+                uint32_t v = cache[i];
+                if (v != tri[0] && v != tri[1] && v != tri[2])
+                {
+                    new_cache[new_count++] = v;
+                }
+            }
+
+            for (uint32_t i = 0; i < new_count; i++)
+            {
+                uint32_t v = new_cache[i];
+                cache_position[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+                vertex_scores[v] = forsyth_vertex_score(cache_position[v], active[v]);
+            }
+
+            cache_count = new_count < FORSYTH_CACHE_SIZE ? new_count : FORSYTH_CACHE_SIZE;
+            memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+
+            // only triangles touching the cache changed score, pick the best of those
+            best_triangle = UINT32_MAX;
+            best_score = -1.0f;
+            for (uint32_t i = 0; i < new_count; i++)
+            {
+                uint32_t v = new_cache[i];
+                const uint32_t *list = &adjacency[offsets[v]];
+                for (uint32_t j = 0; j < active[v]; j++)
+                {
+                    uint32_t t = list[j];
+                    const uint32_t *other = &indices[t * 3];
+                    triangle_scores[t] = vertex_scores[other[0]] + vertex_scores[other[1]] + vertex_scores[other[2]];
+                    if (triangle_scores[t] > best_score)
+                    {
+                        best_score = triangle_scores[t];
+                        best_triangle = t;
+                    }
+                }
+            }
+        }
+
+        memcpy(indices, output, triangle_count * 3 * sizeof(uint32_t));
+    }
+
+    free(active);
+    free(offsets);
+    free(adjacency);
+    free(cache_position);
+    free(vertex_scores);
+    free(triangle_scores);
+    free(emitted);
+    free(output);
+    return ok;
+}
+
+typedef struct cluster_sort_t
+{
+    float key;
+    uint32_t cluster;
+} cluster_sort_t;
+
+static int compare_clusters(const void *a, const void *b)
+{
+    const cluster_sort_t *ca = a;
+    const cluster_sort_t *cb = b;
+    if (ca->key != cb->key)
+    {
+        return ca->key > cb->key ? -1 : 1;
+    }
+    return ca->cluster < cb->cluster ? -1 : (ca->cluster > cb->cluster);
+}
+
+static void triangle_centroid_normal(const mesh_vertex_t *vertices, const uint32_t *tri, float centroid[3], float normal[3])
+{
+    const float *p0 = vertices[tri[0]].position;
+    const float *p1 = vertices[tri[1]].position;
+    const float *p2 = vertices[tri[2]].position;
+
+    float e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+
+    // unnormalized, its length is twice the triangle area
+    normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+
+    for (int k = 0; k < 3; k++)
+    {
+        centroid[k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+    }
+}
+
+int mesh_optimize_overdraw(uint32_t *indices, uint32_t index_count, const mesh_vertex_t *vertices, uint32_t vertex_count, float threshold)
+{
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+    {
+        return 1;
+    }
+
+    fifo_cache_t cache = {0};
+    uint32_t *hard = malloc((triangle_count + 1) * sizeof(uint32_t));
+    uint32_t *soft = malloc((triangle_count + 1) * sizeof(uint32_t));
+    cluster_sort_t *sort = malloc(triangle_count * sizeof(cluster_sort_t));
+    uint32_t *source = malloc(index_count * sizeof(uint32_t));
+
+    int ok = hard && soft && sort && source && fifo_cache_init(&cache, vertex_count, MESH_CACHE_SIZE);
+    if (ok)
+    {
+        memcpy(source, indices, triangle_count * 3 * sizeof(uint32_t));
+
+        // hard boundaries where the cache-optimized order restarts, all three vertices miss
+        uint32_t hard_count = 0;
+        for (uint32_t t = 0; t < triangle_count; t++)
+        {
+            if (fifo_cache_triangle_misses(&cache, &source[t * 3]) == 3 || t == 0)
+            {
+                hard[hard_count++] = t;
+            }
+        }
+        hard[hard_count] = triangle_count;
+
+        // soft boundaries split each hard cluster further, wherever the ACMR of the run so far
+        // is within threshold of the whole cluster's ACMR
+        uint32_t soft_count = 0;
+        for (uint32_t c = 0; c < hard_count; c++)
+        {
+            uint32_t start = hard[c];
+            uint32_t end = hard[c + 1];
+
+            fifo_cache_flush(&cache);
+            uint32_t cluster_misses = 0;
+            for (uint32_t t = start; t < end; t++)
+            {
+                cluster_misses += fifo_cache_triangle_misses(&cache, &source[t * 3]);
+            }
+            float cluster_threshold = threshold * (float)cluster_misses / (float)(end - start);
+
+            fifo_cache_flush(&cache);
+            soft[soft_count++] = start;
+            uint32_t run_start = start;
+            uint32_t run_misses = 0;
+            for (uint32_t t = start; t < end; t++)
+            {
+                run_misses += fifo_cache_triangle_misses(&cache, &source[t * 3]);
+                if (t + 1 < end && run_misses <= cluster_threshold * (float)(t + 1 - run_start))
+                {
+                    soft[soft_count++] = t + 1;
+                    run_start = t + 1;
+                    run_misses = 0;
+                    fifo_cache_flush(&cache);
+                }
+            }
+        }
+        soft[soft_count] = triangle_count;
+
+        // draw clusters facing away from the mesh center first, they tend to occlude the rest
+        float mesh_centroid[3] = {0, 0, 0};
+        float mesh_area = 0.0f;
+        for (uint32_t t = 0; t < triangle_count; t++)
+        {
+            float centroid[3], normal[3];
+            triangle_centroid_normal(vertices, &source[t * 3], centroid, normal);
+            float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (int k = 0; k < 3; k++)
+            {
+                mesh_centroid[k] += centroid[k] * area;
+            }
+            mesh_area += area;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            mesh_centroid[k] = mesh_area > 0.0f ? mesh_centroid[k] / mesh_area : 0.0f;
+        }
+
+        for (uint32_t c = 0; c < soft_count; c++)
+        {
+            float cluster_centroid[3] = {0, 0, 0};
+            float cluster_normal[3] = {0, 0, 0};
+            float cluster_area = 0.0f;
+            for (uint32_t t = soft[c]; t < soft[c + 1]; t++)
+            {
+                float centroid[3], normal[3];
+                triangle_centroid_normal(vertices, &source[t * 3], centroid, normal);
+                float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                for (int k = 0; k < 3; k++)
+                {
+                    cluster_centroid[k] += centroid[k] * area;
+                    cluster_normal[k] += normal[k];
+                }
+                cluster_area += area;
+            }
+
+            float normal_length = sqrtf(cluster_normal[0] * cluster_normal[0] + cluster_normal[1] * cluster_normal[1] + cluster_normal[2] * cluster_normal[2]);
+            float key = 0.0f;
+            if (cluster_area > 0.0f && normal_length > 0.0f)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    key += (cluster_centroid[k] / cluster_area - mesh_centroid[k]) * cluster_normal[k] / normal_length;
+                }
+            }
+
+            sort[c].key = key;
+            sort[c].cluster = c;
+        }
+
+        qsort(sort, soft_count, sizeof(cluster_sort_t), compare_clusters);
+
+        uint32_t out = 0;
+        for (uint32_t i = 0; i < soft_count; i++)
+        {
+            uint32_t c = sort[i].cluster;
+            uint32_t count = (soft[c + 1] - soft[c]) * 3;
+            memcpy(&indices[out], &source[soft[c] * 3], count * sizeof(uint32_t));
+            out += count;
+        }
+    }
+
+    free(cache.timestamps);
+    free(hard);
+    free(soft);
+    free(sort);
+    free(source);
+    return ok;
+}
+
+int mesh_optimize_vertex_fetch(mesh_data_t *mesh)
+{
+    uint32_t *remap = malloc(mesh->vertex_count * sizeof(uint32_t));
+    mesh_vertex_t *vertices = malloc(mesh->vertex_count * sizeof(mesh_vertex_t));
+    if (!remap || !vertices)
+    {
+        free(remap);
+        free(vertices);
+        return 0;
+    }
+
+    memset(remap, 0xff, mesh->vertex_count * sizeof(uint32_t));
+
+    // unreferenced vertices are dropped
+    uint32_t vertex_count = 0;
+    for (uint32_t i = 0; i < mesh->index_count; i++)
+    {
+        uint32_t v = mesh->indices[i];
+        if (remap[v] == UINT32_MAX)
+        {
+            remap[v] = vertex_count;
+            vertices[vertex_count++] = mesh->vertices[v];
+        }
+        mesh->indices[i] = remap[v];
+    }
+
+    free(remap);
+    free(mesh->vertices);
+    mesh->vertices = vertices;
+    mesh->vertex_count = vertex_count;
+    return 1;
+}
+
+int mesh_optimize(mesh_data_t *mesh, mesh_stats_t *stats)
+{
+    float acmr_before = mesh_acmr(mesh->indices, mesh->index_count, mesh->vertex_count, MESH_CACHE_SIZE);
+
+    if (!mesh_optimize_vertex_cache(mesh->indices, mesh->index_count, mesh->vertex_count) ||
+        !mesh_optimize_overdraw(mesh->indices, mesh->index_count, mesh->vertices, mesh->vertex_count, 1.05f) ||
+        !mesh_optimize_vertex_fetch(mesh))
+    {
+        return 0;
+    }
+
+    if (stats)
+    {
+        stats->vertex_count = mesh->vertex_count;
+        stats->index_count = mesh->index_count;
+        stats->acmr_before = acmr_before;
+        stats->acmr_after = mesh_acmr(mesh->indices, mesh->index_count, mesh->vertex_count, MESH_CACHE_SIZE);
+    }
+
+    return 1;
+}
+
+int mesh_create(mesh_t *mesh, const void *vertices, uint32_t vertex_count, const void *indices, uint32_t index_count, GLenum index_type)
+{
+    memset(mesh, 0, sizeof(*mesh));
+
+    size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // upload through the copy target, binding GL_ELEMENT_ARRAY_BUFFER would change the bound vertex array
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    mesh->vertex_buffer = buffers[0];
+    mesh->index_buffer = buffers[1];
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mesh->vertex_buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, vertex_count * sizeof(mesh_vertex_t), vertices, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mesh->index_buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, index_count * index_size, indices, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    mesh->vertex_count = vertex_count;
+    mesh->index_count = index_count;
+    mesh->index_type = index_type;
+    return 1;
+}
+
+uint16_t *mesh_short_indices(const uint32_t *indices, uint32_t index_count)
+{
+    uint16_t *short_indices = malloc(index_count * sizeof(uint16_t));
+    if (!short_indices)
+    {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        short_indices[i] = (uint16_t)indices[i];
+    }
+    return short_indices;
+}
+
+int mesh_upload(mesh_t *mesh, const mesh_data_t *data)
+{
+    int ok;
+    if (mesh_index_type(data->vertex_count) == GL_UNSIGNED_INT)
+    {
+        ok = mesh_create(mesh, data->vertices, data->vertex_count, data->indices, data->index_count, GL_UNSIGNED_INT);
+    }
+    else
+    {
+        uint16_t *short_indices = mesh_short_indices(data->indices, data->index_count);
+        if (!short_indices)
+        {
+            return 0;
+        }
+
+        ok = mesh_create(mesh, data->vertices, data->vertex_count, short_indices, data->index_count, GL_UNSIGNED_SHORT);
+        free(short_indices);
+    }
+
+    mesh->radius = mesh_data_radius(data);
+    return ok;
+}
+
+void mesh_free(mesh_t *mesh)
+{
+    GLuint buffers[2] = {mesh->vertex_buffer, mesh->index_buffer};
+    glDeleteBuffers(2, buffers);
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+void mesh_bind_attributes(void)
+{
+    glVertexAttribFormat(MESH_POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(mesh_vertex_t, position));
+    glVertexAttribBinding(MESH_POSITION_LOCATION, MESH_BUFFER_BINDING);
+    glEnableVertexAttribArray(MESH_POSITION_LOCATION);
+
+    glVertexAttribFormat(MESH_UV_LOCATION, 2, GL_FLOAT, GL_FALSE, offsetof(mesh_vertex_t, uv));
+    glVertexAttribBinding(MESH_UV_LOCATION, MESH_BUFFER_BINDING);
+    glEnableVertexAttribArray(MESH_UV_LOCATION);
+}
+
+void mesh_bind(const mesh_t *mesh)
+{
+    glBindVertexBuffer(MESH_BUFFER_BINDING, mesh->vertex_buffer, 0, sizeof(mesh_vertex_t));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);
+}
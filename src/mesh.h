@@ -0,0 +1,90 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+// Vertex attribute locations and buffer binding of the mesh vertices
+#define MESH_POSITION_LOCATION 0
+#define MESH_UV_LOCATION 5
+#define MESH_BUFFER_BINDING 0
+
+// FIFO cache size used to measure the average cache miss ratio (ACMR)
+#define MESH_CACHE_SIZE 16
+
+typedef struct mesh_vertex_t
+{
+    float position[3];
+    float uv[2];
+} mesh_vertex_t;
+
+// CPU side indexed triangle list
+typedef struct mesh_data_t
+{
+    mesh_vertex_t *vertices;
+    uint32_t vertex_count;
+    uint32_t *indices;
+    uint32_t index_count;
+} mesh_data_t;
+
+typedef struct mesh_stats_t
+{
+    uint32_t vertex_count;
+    uint32_t index_count;
+    float acmr_before;
+    float acmr_after;
+} mesh_stats_t;
+
+// GPU side indexed mesh in immutable buffers
+typedef struct mesh_t
+{
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    GLenum index_type;
+    float radius; // bounding sphere around the mesh origin, for culling
+} mesh_t;
+
+// Builds an indexed mesh from a non-indexed triangle list, removing duplicate vertices
+int mesh_data_from_triangles(mesh_data_t *mesh, const mesh_vertex_t *vertices, uint32_t vertex_count);
+void mesh_data_free(mesh_data_t *mesh);
+// Distance of the farthest vertex from the mesh origin
+float mesh_data_radius(const mesh_data_t *mesh);
+
+// Average number of vertex shader invocations per triangle for a FIFO cache of cache_size,
+// 0.5 is the best possible for a regular grid, 3 is no reuse at all
+float mesh_acmr(const uint32_t *indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size);
+
+// Reorders triangles for the post-transform vertex cache (Forsyth, linear-speed)
+int mesh_optimize_vertex_cache(uint32_t *indices, uint32_t index_count, uint32_t vertex_count);
+// Reorders clusters of cache-ordered triangles so outward facing ones are drawn first, while
+// keeping the ACMR within threshold (e.g. 1.05) of the cache-optimized order
+int mesh_optimize_overdraw(uint32_t *indices, uint32_t index_count, const mesh_vertex_t *vertices, uint32_t vertex_count, float threshold);
+// Reorders vertices in order of first use, so vertex fetch walks memory linearly
+int mesh_optimize_vertex_fetch(mesh_data_t *mesh);
+
+// Runs all of the above, optionally filling stats
+int mesh_optimize(mesh_data_t *mesh, mesh_stats_t *stats);
+
+// 16 bit indices when they fit, halves index fetch bandwidth
+static inline GLenum mesh_index_type(uint32_t vertex_count)
+{
+    return vertex_count <= UINT16_MAX ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+// Returns a malloc'ed 16 bit copy of the indices
+uint16_t *mesh_short_indices(const uint32_t *indices, uint32_t index_count);
+
+// Creates immutable GPU buffers from mesh_vertex_t vertices and indices of index_type
+int mesh_create(mesh_t *mesh, const void *vertices, uint32_t vertex_count, const void *indices, uint32_t index_count, GLenum index_type);
+int mesh_upload(mesh_t *mesh, const mesh_data_t *data);
+void mesh_free(mesh_t *mesh);
+
+// Sets up the mesh vertex attributes of the currently bound vertex array
+void mesh_bind_attributes(void);
+// Binds the mesh buffers to the currently bound vertex array
+void mesh_bind(const mesh_t *mesh);
+
+#endif
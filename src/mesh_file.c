@@ -0,0 +1,255 @@
+#include "mesh_file.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN_32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static int map_file(mesh_file_t *file, const char *path)
+{
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_handle, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file_handle);
+        return 0;
+    }
+
+    HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_handle)
+    {
+        CloseHandle(file_handle);
+        return 0;
+    }
+
+    const void *data = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        return 0;
+    }
+
+    file->data = data;
+    file->size = (size_t)size.QuadPart;
+    file->file_handle = file_handle;
+    file->mapping_handle = mapping_handle;
+    return 1;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    // the whole file is read once, front to back, by the upload
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    file->data = data;
+    file->size = (size_t)st.st_size;
+    return 1;
+#endif
+}
+
+int mesh_file_open(mesh_file_t *file, const char *path)
+{
+    memset(file, 0, sizeof(*file));
+
+    if (!map_file(file, path))
+    {
+        printf("Failed to map mesh file %s\n", path);
+        return 0;
+    }
+
+    const mesh_file_header_t *header = (const mesh_file_header_t *)file->data;
+    if (file->size < sizeof(mesh_file_header_t) || header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION)
+    {
+        printf("%s is not a version %d mesh file\n", path, MESH_FILE_VERSION);
+        mesh_file_close(file);
+        return 0;
+    }
+
+    if (header->index_type != GL_UNSIGNED_SHORT && header->index_type != GL_UNSIGNED_INT)
+    {
+        printf("Mesh file %s has an unsupported index type 0x%x\n", path, (unsigned)header->index_type);
+        mesh_file_close(file);
+        return 0;
+    }
+
+    // the ranges are checked by subtracting so that a huge offset or size cannot wrap around
+    size_t index_size = header->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    if (header->vertex_size > file->size || header->vertex_offset > file->size - header->vertex_size ||
+        header->index_size > file->size || header->index_offset > file->size - header->index_size ||
+        header->vertex_size != (uint64_t)header->vertex_count * header->vertex_stride ||
+        header->index_size != (uint64_t)header->index_count * index_size ||
+        header->attribute_count > MESH_FILE_MAX_ATTRIBUTES)
+    {
+        printf("Mesh file %s is truncated or corrupt\n", path);
+        mesh_file_close(file);
+        return 0;
+    }
+
+    file->header = header;
+    return 1;
+}
+
+void mesh_file_close(mesh_file_t *file)
+{
+#ifdef _WIN32
+    if (file->data)
+    {
+        UnmapViewOfFile(file->data);
+        CloseHandle(file->mapping_handle);
+        CloseHandle(file->file_handle);
+    }
+#else
+    if (file->data)
+    {
+        munmap((void *)file->data, file->size);
+    }
+#endif
+    memset(file, 0, sizeof(*file));
+}
+
+// The attribute layout of mesh_vertex_t as stored in the file
+static const mesh_file_attribute_t vertex_attributes[] = {
+    {.location = MESH_POSITION_LOCATION, .components = 3, .type = GL_FLOAT, .offset = offsetof(mesh_vertex_t, position)},
+    {.location = MESH_UV_LOCATION, .components = 2, .type = GL_FLOAT, .offset = offsetof(mesh_vertex_t, uv)},
+};
+#define VERTEX_ATTRIBUTE_COUNT (sizeof(vertex_attributes) / sizeof(vertex_attributes[0]))
+
+int mesh_file_upload(mesh_t *mesh, const mesh_file_t *file)
+{
+    const mesh_file_header_t *header = file->header;
+    if (header->vertex_stride != sizeof(mesh_vertex_t) ||
+        header->attribute_count != VERTEX_ATTRIBUTE_COUNT ||
+        memcmp(header->attributes, vertex_attributes, sizeof(vertex_attributes)) != 0)
+    {
+        printf("Mesh file vertex layout does not match mesh_vertex_t\n");
+        return 0;
+    }
+
+    // the driver copies straight out of the mapped pages
+    if (!mesh_create(mesh, file->data + header->vertex_offset, header->vertex_count,
+                     file->data + header->index_offset, header->index_count, header->index_type))
+    {
+        return 0;
+    }
+
+    // the farthest bounds corner, conservative without reading the vertices
+    float corner[3];
+    for (int i = 0; i < 3; i++)
+    {
+        corner[i] = fmaxf(fabsf(header->bounds_min[i]), fabsf(header->bounds_max[i]));
+    }
+    mesh->radius = sqrtf(corner[0] * corner[0] + corner[1] * corner[1] + corner[2] * corner[2]);
+    return 1;
+}
+
+static int write_padding(FILE *f, long alignment)
+{
+    static const uint8_t zeros[MESH_FILE_ALIGNMENT] = {0};
+    long position = ftell(f);
+    long padding = (alignment - position % alignment) % alignment;
+    return fwrite(zeros, 1, padding, f) == (size_t)padding;
+}
+
+int mesh_file_write(const char *path, const mesh_data_t *data)
+{
+    mesh_file_header_t header = {
+        .magic = MESH_FILE_MAGIC,
+        .version = MESH_FILE_VERSION,
+        .vertex_count = data->vertex_count,
+        .index_count = data->index_count,
+        .index_type = mesh_index_type(data->vertex_count),
+        .vertex_stride = sizeof(mesh_vertex_t),
+        .attribute_count = VERTEX_ATTRIBUTE_COUNT,
+    };
+    memcpy(header.attributes, vertex_attributes, sizeof(vertex_attributes));
+
+    size_t index_size = header.index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    header.vertex_size = (uint64_t)data->vertex_count * sizeof(mesh_vertex_t);
+    header.index_size = (uint64_t)data->index_count * index_size;
+    header.vertex_offset = (sizeof(mesh_file_header_t) + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+    header.index_offset = (header.vertex_offset + header.vertex_size + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+
+    for (int k = 0; k < 3; k++)
+    {
+        header.bounds_min[k] = data->vertex_count ? data->vertices[0].position[k] : 0.0f;
+        header.bounds_max[k] = header.bounds_min[k];
+    }
+    for (uint32_t i = 1; i < data->vertex_count; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            float p = data->vertices[i].position[k];
+            header.bounds_min[k] = p < header.bounds_min[k] ? p : header.bounds_min[k];
+            header.bounds_max[k] = p > header.bounds_max[k] ? p : header.bounds_max[k];
+        }
+    }
+
+    const void *indices = data->indices;
+    uint16_t *short_indices = NULL;
+    if (header.index_type == GL_UNSIGNED_SHORT)
+    {
+        short_indices = mesh_short_indices(data->indices, data->index_count);
+        if (!short_indices)
+        {
+            return 0;
+        }
+        indices = short_indices;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        printf("Failed to open %s for writing\n", path);
+        free(short_indices);
+        return 0;
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             write_padding(f, MESH_FILE_ALIGNMENT) &&
+             fwrite(data->vertices, 1, header.vertex_size, f) == header.vertex_size &&
+             write_padding(f, MESH_FILE_ALIGNMENT) &&
+             fwrite(indices, 1, header.index_size, f) == header.index_size;
+
+    ok = fclose(f) == 0 && ok;
+    free(short_indices);
+
+    if (!ok)
+    {
+        printf("Failed to write %s\n", path);
+    }
+    return ok;
+}
@@ -0,0 +1,66 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh.h"
+
+// Binary mesh container, little endian. The header is followed by the vertex and index blobs,
+// each aligned to MESH_FILE_ALIGNMENT, in exactly the layout the GPU buffers use. Loading is
+// a mmap and a glBufferStorage straight from the mapping, nothing is parsed.
+#define MESH_FILE_MAGIC 0x48534d58 // "XMSH"
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_ALIGNMENT 64
+#define MESH_FILE_MAX_ATTRIBUTES 8
+
+typedef struct mesh_file_attribute_t
+{
+    uint32_t location;
+    uint32_t components;
+    uint32_t type; // GL type enum of each component
+    uint32_t offset;
+} mesh_file_attribute_t;
+
+typedef struct mesh_file_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t index_type; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t vertex_stride;
+    uint32_t attribute_count;
+    uint32_t reserved;
+    mesh_file_attribute_t attributes[MESH_FILE_MAX_ATTRIBUTES];
+    uint64_t vertex_offset;
+    uint64_t vertex_size;
+    uint64_t index_offset;
+    uint64_t index_size;
+    float bounds_min[3];
+    float bounds_max[3];
+} mesh_file_header_t;
+
+// A read-only mapping of a mesh file
+typedef struct mesh_file_t
+{
+    const uint8_t *data;
+    size_t size;
+    const mesh_file_header_t *header;
+#ifdef _WIN32
+    void *file_handle;
+    void *mapping_handle;
+#endif
+} mesh_file_t;
+
+// Maps the file and validates the header, returns 0 and prints why on failure
+int mesh_file_open(mesh_file_t *file, const char *path);
+void mesh_file_close(mesh_file_t *file);
+
+// Creates the GPU buffers directly from the mapped blobs, the layout must match mesh_vertex_t
+int mesh_file_upload(mesh_t *mesh, const mesh_file_t *file);
+
+// Writes an indexed mesh in the container format, used by the offline converter
+int mesh_file_write(const char *path, const mesh_data_t *data);
+
+#endif
@@ -0,0 +1,163 @@
+#include "pose_trace.h"
+
+#include <stddef.h>
+#include <string.h>
+
+int pose_trace_open_write(pose_trace_t *trace, const char *path, XrViewConfigurationType view_type, uint32_t view_count)
+{
+    memset(trace, 0, sizeof(*trace));
+    if (view_count > POSE_TRACE_MAX_VIEWS)
+    {
+        printf("Pose trace holds at most %d views, not %u\n", POSE_TRACE_MAX_VIEWS, view_count);
+        return 0;
+    }
+
+    trace->file = fopen(path, "wb");
+    if (!trace->file)
+    {
+        printf("Failed to open %s for writing\n", path);
+        return 0;
+    }
+
+    // the frame count is patched in on close
+    pose_trace_header_t header = {
+        .magic = POSE_TRACE_MAGIC,
+        .version = POSE_TRACE_VERSION,
+        .view_type = (uint32_t)view_type,
+        .view_count = view_count,
+    };
+    if (fwrite(&header, sizeof(header), 1, trace->file) != 1)
+    {
+        printf("Failed to write %s\n", path);
+        fclose(trace->file);
+        trace->file = NULL;
+        return 0;
+    }
+
+    trace->writing = 1;
+    trace->view_count = view_count;
+    return 1;
+}
+
+int pose_trace_open_read(pose_trace_t *trace, const char *path, XrViewConfigurationType view_type, uint32_t view_count)
+{
+    memset(trace, 0, sizeof(*trace));
+    trace->file = fopen(path, "rb");
+    if (!trace->file)
+    {
+        printf("Failed to open pose trace %s\n", path);
+        return 0;
+    }
+
+    pose_trace_header_t header;
+    if (fread(&header, sizeof(header), 1, trace->file) != 1 || header.magic != POSE_TRACE_MAGIC || header.version != POSE_TRACE_VERSION)
+    {
+        printf("%s is not a version %d pose trace\n", path, POSE_TRACE_VERSION);
+        pose_trace_close(trace);
+        return 0;
+    }
+
+    if (header.view_type != (uint32_t)view_type || header.view_count != view_count)
+    {
+        printf("Pose trace %s was recorded with %u views of configuration %u, the session has %u of %u\n",
+               path, header.view_count, header.view_type, view_count, (uint32_t)view_type);
+        pose_trace_close(trace);
+        return 0;
+    }
+
+    trace->view_count = view_count;
+    trace->frame_count = header.frame_count;
+    printf("Replaying %llu frames of poses from %s\n", (unsigned long long)header.frame_count, path);
+    return 1;
+}
+
+void pose_trace_close(pose_trace_t *trace)
+{
+    if (!trace->file)
+    {
+        return;
+    }
+
+    if (trace->writing)
+    {
+        // a trace cut short by a crash still replays, its count just reads 0
+        if (fseek(trace->file, (long)offsetof(pose_trace_header_t, frame_count), SEEK_SET) == 0)
+        {
+            fwrite(&trace->frames, sizeof(trace->frames), 1, trace->file);
+        }
+        printf("Pose trace: recorded %llu frames\n", (unsigned long long)trace->frames);
+    }
+
+    fclose(trace->file);
+    trace->file = NULL;
+}
+
+void pose_trace_set_hands(pose_trace_t *trace, const XrSpaceLocation *hand_locations, const XrActionStateFloat *grab_values)
+{
+    pose_trace_frame_t *frame = &trace->frame;
+    frame->grab_active = 0;
+    for (int i = 0; i < POSE_TRACE_HANDS; i++)
+    {
+        frame->hand_location_flags[i] = hand_locations[i].locationFlags;
+        frame->hand_poses[i] = hand_locations[i].pose;
+        frame->grab_values[i] = grab_values[i].currentState;
+        frame->grab_active |= grab_values[i].isActive ? 1u << i : 0;
+    }
+}
+
+void pose_trace_write(pose_trace_t *trace, XrTime display_time, const XrViewState *view_state, const XrView *views)
+{
+    pose_trace_frame_t *frame = &trace->frame;
+    frame->display_time = display_time;
+    frame->view_state_flags = view_state->viewStateFlags;
+    for (uint32_t i = 0; i < trace->view_count; i++)
+    {
+        frame->view_poses[i] = views[i].pose;
+        frame->view_fovs[i] = views[i].fov;
+    }
+
+    if (fwrite(frame, sizeof(*frame), 1, trace->file) == 1)
+    {
+        trace->frames++;
+    }
+}
+
+int pose_trace_next(pose_trace_t *trace)
+{
+    pose_trace_frame_t frame;
+    if (fread(&frame, sizeof(frame), 1, trace->file) != 1)
+    {
+        return 0;
+    }
+
+    trace->frame = frame;
+    trace->frames++;
+    return 1;
+}
+
+void pose_trace_get_hands(const pose_trace_t *trace, XrSpaceLocation *hand_locations, XrActionStateFloat *grab_values)
+{
+    const pose_trace_frame_t *frame = &trace->frame;
+    for (int i = 0; i < POSE_TRACE_HANDS; i++)
+    {
+        hand_locations[i].locationFlags = (XrSpaceLocationFlags)frame->hand_location_flags[i];
+        hand_locations[i].pose = frame->hand_poses[i];
+
+        // changedSinceLastSync and lastChangeTime are not recorded, nothing reads them
+        grab_values[i].currentState = frame->grab_values[i];
+        grab_values[i].isActive = (frame->grab_active >> i) & 1;
+        grab_values[i].changedSinceLastSync = XR_FALSE;
+        grab_values[i].lastChangeTime = frame->display_time;
+    }
+}
+
+void pose_trace_get_views(const pose_trace_t *trace, XrViewState *view_state, XrView *views)
+{
+    const pose_trace_frame_t *frame = &trace->frame;
+    view_state->viewStateFlags = (XrViewStateFlags)frame->view_state_flags;
+    for (uint32_t i = 0; i < trace->view_count; i++)
+    {
+        views[i].pose = frame->view_poses[i];
+        views[i].fov = frame->view_fovs[i];
+    }
+}
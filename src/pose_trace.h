@@ -0,0 +1,65 @@
+#ifndef POSE_TRACE_H
+#define POSE_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "openxr/openxr.h"
+
+// Binary trace of everything the frame loop reads from the tracking system, little endian. A
+// header is followed by one fixed size record per frame. Replaying one in place of the runtime
+// queries renders the same head and hand movement on every run, so CPU and GPU costs can be
+// compared between builds.
+#define POSE_TRACE_MAGIC 0x52545058 // "XPTR"
+#define POSE_TRACE_VERSION 1
+#define POSE_TRACE_MAX_VIEWS 4
+#define POSE_TRACE_HANDS 2
+
+typedef struct pose_trace_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t view_type; // XrViewConfigurationType
+    uint32_t view_count;
+    uint64_t frame_count; // written when the trace is closed
+} pose_trace_header_t;
+
+typedef struct pose_trace_frame_t
+{
+    int64_t display_time; // XrTime the frame was predicted for
+    uint64_t view_state_flags;
+    XrPosef view_poses[POSE_TRACE_MAX_VIEWS];
+    XrFovf view_fovs[POSE_TRACE_MAX_VIEWS];
+    uint64_t hand_location_flags[POSE_TRACE_HANDS];
+    XrPosef hand_poses[POSE_TRACE_HANDS];
+    float grab_values[POSE_TRACE_HANDS];
+    uint32_t grab_active; // bit per hand
+    uint32_t reserved;
+} pose_trace_frame_t;
+
+typedef struct pose_trace_t
+{
+    FILE *file;
+    int writing;
+    uint32_t view_count;
+    uint64_t frame_count; // in the file when replaying
+    uint64_t frames;      // written or read so far
+    pose_trace_frame_t frame; // the current frame
+} pose_trace_t;
+
+// Both return 0 and print why on failure. A replayed trace has to be recorded with the same view
+// configuration, the views it holds are the views that get rendered.
+int pose_trace_open_write(pose_trace_t *trace, const char *path, XrViewConfigurationType view_type, uint32_t view_count);
+int pose_trace_open_read(pose_trace_t *trace, const char *path, XrViewConfigurationType view_type, uint32_t view_count);
+void pose_trace_close(pose_trace_t *trace);
+
+// Recording, hands are captured before xrBeginFrame and the views after, then the frame is written
+void pose_trace_set_hands(pose_trace_t *trace, const XrSpaceLocation *hand_locations, const XrActionStateFloat *grab_values);
+void pose_trace_write(pose_trace_t *trace, XrTime display_time, const XrViewState *view_state, const XrView *views);
+
+// Replay, reads the next frame and returns 0 once the trace is exhausted, which keeps the last one
+int pose_trace_next(pose_trace_t *trace);
+void pose_trace_get_hands(const pose_trace_t *trace, XrSpaceLocation *hand_locations, XrActionStateFloat *grab_values);
+void pose_trace_get_views(const pose_trace_t *trace, XrViewState *view_state, XrView *views);
+
+#endif
@@ -0,0 +1,135 @@
+#include "program.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static GLuint compile_shader(GLenum stage, const char *const *srcs, int count)
+{
+    GLuint shader = glCreateShader(stage);
+    glShaderSource(shader, count, srcs, NULL);
+    glCompileShader(shader);
+
+    int compile_res;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_res);
+    if (!compile_res)
+    {
+        char info_log[512];
+        glGetShaderInfoLog(shader, 512, NULL, info_log);
+        printf("%s Shader failed to compile: %s\n", stage == GL_VERTEX_SHADER ? "Vertex" : "Fragment", info_log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+static void reflect_program(program_t *program)
+{
+    GLint uniform_count;
+    glGetProgramiv(program->id, GL_ACTIVE_UNIFORMS, &uniform_count);
+    for (GLint i = 0; i < uniform_count && program->uniform_count < PROGRAM_MAX_UNIFORMS; i++)
+    {
+        program_uniform_t *uniform = &program->uniforms[program->uniform_count++];
+        glGetActiveUniform(program->id, i, PROGRAM_MAX_NAME, NULL, &uniform->size, &uniform->type, uniform->name);
+        uniform->location = glGetUniformLocation(program->id, uniform->name);
+    }
+
+    GLint block_count;
+    glGetProgramiv(program->id, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+    for (GLint i = 0; i < block_count && program->block_count < PROGRAM_MAX_BLOCKS; i++)
+    {
+        program_block_t *block = &program->blocks[program->block_count++];
+        block->index = i;
+        glGetActiveUniformBlockName(program->id, i, PROGRAM_MAX_NAME, NULL, block->name);
+        glGetActiveUniformBlockiv(program->id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block->data_size);
+    }
+}
+
+int program_create(program_t *program, const char *const *vert_srcs, int vert_count, const char *const *frag_srcs, int frag_count)
+{
+    memset(program, 0, sizeof(*program));
+
+    GLuint vert_shd = compile_shader(GL_VERTEX_SHADER, vert_srcs, vert_count);
+    if (!vert_shd)
+    {
+        return 0;
+    }
+
+    GLuint frag_shd = compile_shader(GL_FRAGMENT_SHADER, frag_srcs, frag_count);
+    if (!frag_shd)
+    {
+        glDeleteShader(vert_shd);
+        return 0;
+    }
+
+    program->id = glCreateProgram();
+    glAttachShader(program->id, vert_shd);
+    glAttachShader(program->id, frag_shd);
+    glLinkProgram(program->id);
+
+    glDeleteShader(vert_shd);
+    glDeleteShader(frag_shd);
+
+    GLint link_res;
+    glGetProgramiv(program->id, GL_LINK_STATUS, &link_res);
+    if (!link_res)
+    {
+        char info_log[512];
+        glGetProgramInfoLog(program->id, 512, NULL, info_log);
+        printf("Shader Program failed to link: %s\n", info_log);
+        glDeleteProgram(program->id);
+        program->id = 0;
+        return 0;
+    }
+
+    reflect_program(program);
+
+    return 1;
+}
+
+void program_destroy(program_t *program)
+{
+    glDeleteProgram(program->id);
+    memset(program, 0, sizeof(*program));
+}
+
+GLint program_uniform_location(const program_t *program, const char *name)
+{
+    size_t name_len = strlen(name);
+    for (uint32_t i = 0; i < program->uniform_count; i++)
+    {
+        const char *uniform_name = program->uniforms[i].name;
+        if (strcmp(uniform_name, name) == 0 ||
+            (strncmp(uniform_name, name, name_len) == 0 && strcmp(uniform_name + name_len, "[0]") == 0))
+        {
+            return program->uniforms[i].location;
+        }
+    }
+
+    return -1;
+}
+
+const program_block_t *program_block(const program_t *program, const char *name)
+{
+    for (uint32_t i = 0; i < program->block_count; i++)
+    {
+        if (strcmp(program->blocks[i].name, name) == 0)
+        {
+            return &program->blocks[i];
+        }
+    }
+
+    return NULL;
+}
+
+int program_bind_block(const program_t *program, const char *name, GLuint binding)
+{
+    const program_block_t *block = program_block(program, name);
+    if (!block)
+    {
+        return 0;
+    }
+
+    glUniformBlockBinding(program->id, block->index, binding);
+    return 1;
+}
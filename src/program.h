@@ -0,0 +1,49 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+#define PROGRAM_MAX_UNIFORMS 32
+#define PROGRAM_MAX_BLOCKS 8
+#define PROGRAM_MAX_NAME 64
+
+typedef struct program_uniform_t
+{
+    char name[PROGRAM_MAX_NAME];
+    GLint location; // -1 for members of uniform blocks
+    GLenum type;
+    GLint size;
+} program_uniform_t;
+
+typedef struct program_block_t
+{
+    char name[PROGRAM_MAX_NAME];
+    GLuint index;
+    GLint data_size;
+} program_block_t;
+
+// A linked shader program with its uniforms and uniform blocks reflected once at link time,
+// so nothing has to be looked up by name while rendering.
+typedef struct program_t
+{
+    GLuint id;
+    uint32_t uniform_count;
+    program_uniform_t uniforms[PROGRAM_MAX_UNIFORMS];
+    uint32_t block_count;
+    program_block_t blocks[PROGRAM_MAX_BLOCKS];
+} program_t;
+
+// Compiles and links the concatenated sources of each stage, prints the info log on failure
+int program_create(program_t *program, const char *const *vert_srcs, int vert_count, const char *const *frag_srcs, int frag_count);
+void program_destroy(program_t *program);
+
+// Cached reflection lookups, arrays can be found by their plain name or with "[0]"
+GLint program_uniform_location(const program_t *program, const char *name);
+const program_block_t *program_block(const program_t *program, const char *name);
+
+// Assigns a uniform block to a buffer binding point, returns 0 if the block does not exist
+int program_bind_block(const program_t *program, const char *name, GLuint binding);
+
+#endif
@@ -0,0 +1,86 @@
+#include "resolution.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void resolution_init(resolution_t *resolution, float min_scale, float max_scale)
+{
+    memset(resolution, 0, sizeof(*resolution));
+    resolution->min_scale = min_scale;
+    resolution->max_scale = max_scale;
+    resolution->scale = 1.0f < max_scale ? 1.0f : max_scale;
+    resolution->lowest_scale = resolution->scale;
+}
+
+static float clamp_scale(const resolution_t *resolution, float scale)
+{
+    return scale < resolution->min_scale ? resolution->min_scale : (scale > resolution->max_scale ? resolution->max_scale : scale);
+}
+
+float resolution_update(resolution_t *resolution, double gpu_ms, double period_ms)
+{
+    if (resolution->cooldown > 0 || gpu_ms <= 0.0 || period_ms <= 0.0)
+    {
+        return resolution->scale;
+    }
+
+    // GPU time grows with the pixel count, the square of the scale; aim a little under budget
+    double budget_ms = period_ms * RESOLUTION_GPU_BUDGET;
+    float target = clamp_scale(resolution, 0.95f * resolution->scale * (float)sqrt(budget_ms / gpu_ms));
+
+    if (gpu_ms > budget_ms)
+    {
+        resolution->under_budget = 0;
+        if (target < resolution->scale)
+        {
+            resolution->scale = target;
+            resolution->downscales++;
+            resolution->cooldown = RESOLUTION_LATENCY_FRAMES;
+        }
+    }
+    else if (gpu_ms < 0.8 * budget_ms)
+    {
+        if (++resolution->under_budget >= RESOLUTION_UPSCALE_FRAMES)
+        {
+            // at most 10% per step, the measurement may have been a quiet frame
+            float step = 1.1f * resolution->scale;
+            target = target < step ? target : step;
+            if (target > resolution->scale + 0.01f)
+            {
+                resolution->scale = target;
+                resolution->upscales++;
+                resolution->cooldown = RESOLUTION_LATENCY_FRAMES;
+            }
+            resolution->under_budget = 0;
+        }
+    }
+    else
+    {
+        resolution->under_budget = 0;
+    }
+
+    return resolution->scale;
+}
+
+void resolution_frame(resolution_t *resolution)
+{
+    if (resolution->cooldown > 0)
+    {
+        resolution->cooldown--;
+    }
+
+    resolution->frames++;
+    resolution->scale_total += resolution->scale;
+    if (resolution->scale < resolution->lowest_scale)
+    {
+        resolution->lowest_scale = resolution->scale;
+    }
+}
+
+void resolution_print_stats(const resolution_t *resolution)
+{
+    printf("Dynamic resolution: average scale %.3f, lowest %.3f, %llu downscales and %llu upscales over %llu frames\n",
+           resolution->frames ? resolution->scale_total / resolution->frames : resolution->scale, resolution->lowest_scale,
+           (unsigned long long)resolution->downscales, (unsigned long long)resolution->upscales, (unsigned long long)resolution->frames);
+}
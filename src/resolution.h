@@ -0,0 +1,41 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include <stdint.h>
+
+// Share of the display period the app's GPU work may use, the rest is left to the compositor
+#define RESOLUTION_GPU_BUDGET 0.85f
+// Frames the GPU time takes to reflect a scale change: queries are read back a few frames late
+#define RESOLUTION_LATENCY_FRAMES 4
+// Frames under budget before the scale is raised again
+#define RESOLUTION_UPSCALE_FRAMES 30
+
+// Picks a render scale relative to the recommended image size from measured GPU time.
+// Over budget it scales down at once, so a load spike costs resolution instead of frames;
+// back under budget it creeps up again slowly so it does not oscillate.
+typedef struct resolution_t
+{
+    float scale;
+    float min_scale;
+    float max_scale;
+    uint32_t cooldown;     // frames until a measurement reflects the last change
+    uint32_t under_budget; // consecutive frames with room to scale up
+
+    // statistics
+    uint64_t frames;
+    uint64_t downscales;
+    uint64_t upscales;
+    double scale_total;
+    float lowest_scale;
+} resolution_t;
+
+void resolution_init(resolution_t *resolution, float min_scale, float max_scale);
+
+// Feed the newest GPU frame time and the display period, returns the scale for the next frame
+float resolution_update(resolution_t *resolution, double gpu_ms, double period_ms);
+// Call once per rendered frame whether or not a measurement came back
+void resolution_frame(resolution_t *resolution);
+
+void resolution_print_stats(const resolution_t *resolution);
+
+#endif
@@ -0,0 +1,183 @@
+#include "view_cache.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static void mat4_proj_xr(float result[16], XrFovf fov, float near_z, float far_z)
+{
+    const float tan_left = tanf(fov.angleLeft);
+    const float tan_right = tanf(fov.angleRight);
+
+    const float tan_down = tanf(fov.angleDown);
+    const float tan_up = tanf(fov.angleUp);
+
+    const float tan_width = tan_right - tan_left;
+    const float tan_height = (tan_up - tan_down);
+
+    const float offset_z = near_z;
+
+    result[0] = 2 / tan_width;
+    result[4] = 0;
+    result[8] = (tan_right + tan_left) / tan_width;
+    result[12] = 0;
+
+    result[1] = 0;
+    result[5] = 2 / tan_height;
+    result[9] = (tan_up + tan_down) / tan_height;
+    result[13] = 0;
+
+    result[2] = 0;
+    result[6] = 0;
+    result[10] = -(far_z + offset_z) / (far_z - near_z);
+    result[14] = -(far_z * (near_z + offset_z)) / (far_z - near_z);
+
+    result[3] = 0;
+    result[7] = 0;
+    result[11] = -1;
+    result[15] = 0;
+}
+
+// Reversed-Z projection with the far plane at infinity for a [0, 1] clip depth range
+// (glClipControl). Depth is near_z / distance: 1 at the near plane, approaching 0 at infinity,
+// which spreads float precision evenly over distance.
+static void mat4_proj_xr_reversed(float result[16], XrFovf fov, float near_z)
+{
+    // x and y are the same as the standard projection, only the depth row changes
+    mat4_proj_xr(result, fov, near_z, 2.0f * near_z);
+
+    result[10] = 0;
+    result[14] = near_z;
+}
+
+void view_cache_init(view_cache_t *cache, float near_z, float far_z, int reverse_z)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->near_z = near_z;
+    cache->far_z = far_z;
+    cache->reverse_z = reverse_z;
+}
+
+// Locates with the cached count, asking for the count first if there is none. Any failure
+// drops the cached count.
+static XrResult locate_views(view_cache_t *cache, XrSession session, const XrViewLocateInfo *info, XrViewState *view_state,
+                             uint32_t capacity, uint32_t *view_count, XrView *views)
+{
+    XrResult result;
+    if (cache->view_count == 0)
+    {
+        cache->count_queries++;
+        result = xrLocateViews(session, info, view_state, 0, &cache->view_count, NULL);
+        if (result != XR_SUCCESS)
+        {
+            cache->view_count = 0;
+            return result;
+        }
+        if (cache->view_count > capacity)
+        {
+            cache->view_count = 0;
+            return XR_ERROR_SIZE_INSUFFICIENT;
+        }
+    }
+    else
+    {
+        cache->count_queries_skipped++;
+    }
+
+    result = xrLocateViews(session, info, view_state, cache->view_count, view_count, views);
+    if (result != XR_SUCCESS)
+    {
+        cache->view_count = 0;
+    }
+    return result;
+}
+
+XrResult view_cache_locate(view_cache_t *cache, XrSession session, const XrViewLocateInfo *info, XrViewState *view_state,
+                           uint32_t capacity, uint32_t *view_count, XrView *views)
+{
+    int cached = cache->view_count != 0;
+    XrResult result = locate_views(cache, session, info, view_state, capacity, view_count, views);
+    if (result == XR_ERROR_SIZE_INSUFFICIENT && cached)
+    {
+        // the count changed since it was cached, ask for it and locate again right away
+        result = locate_views(cache, session, info, view_state, capacity, view_count, views);
+    }
+    return result;
+}
+
+void view_cache_begin_frame(view_cache_t *cache)
+{
+    cache->frames++;
+    cache->projections_built_last = 0;
+    cache->projections_reused_last = 0;
+}
+
+const float *view_cache_projection(view_cache_t *cache, uint32_t view, const XrFovf *fov)
+{
+    float *projection = cache->projections[view];
+    if (cache->projection_valid[view] && memcmp(&cache->fovs[view], fov, sizeof(*fov)) == 0)
+    {
+        cache->projections_reused_last++;
+        cache->projections_reused++;
+        return projection;
+    }
+
+    if (cache->reverse_z)
+    {
+        mat4_proj_xr_reversed(projection, *fov, cache->near_z);
+    }
+    else
+    {
+        mat4_proj_xr(projection, *fov, cache->near_z, cache->far_z);
+    }
+
+    cache->fovs[view] = *fov;
+    cache->projection_valid[view] = 1;
+    cache->projections_built_last++;
+    cache->projections_built++;
+    return projection;
+}
+
+void view_cache_view_matrix(float result[16], const XrPosef *pose)
+{
+    const float x = pose->orientation.x;
+    const float y = pose->orientation.y;
+    const float z = pose->orientation.z;
+    const float w = pose->orientation.w;
+
+    // rows of the pose rotation, which are the columns of the inverse
+    const float r[3][3] = {
+        {1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y)},
+        {2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x)},
+        {2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y)},
+    };
+    const float p[3] = {pose->position.x, pose->position.y, pose->position.z};
+
+    // column major, the inverse rotation is the transpose and the translation is -R^T p
+    for (int c = 0; c < 3; c++)
+    {
+        result[c * 4 + 0] = r[c][0];
+        result[c * 4 + 1] = r[c][1];
+        result[c * 4 + 2] = r[c][2];
+        result[c * 4 + 3] = 0.0f;
+    }
+    for (int row = 0; row < 3; row++)
+    {
+        result[12 + row] = -(r[0][row] * p[0] + r[1][row] * p[1] + r[2][row] * p[2]);
+    }
+    result[15] = 1.0f;
+}
+
+void view_cache_print_stats(const view_cache_t *cache)
+{
+    if (cache->frames == 0)
+    {
+        return;
+    }
+
+    uint64_t projections = cache->projections_built + cache->projections_reused;
+    printf("View cache: %llu frames, %llu of %llu view count queries skipped, %llu of %llu projections reused (%.1f%%)\n",
+           (unsigned long long)cache->frames, (unsigned long long)cache->count_queries_skipped,
+           (unsigned long long)(cache->count_queries + cache->count_queries_skipped), (unsigned long long)cache->projections_reused,
+           (unsigned long long)projections, projections ? 100.0 * cache->projections_reused / projections : 0.0);
+}
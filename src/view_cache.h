@@ -0,0 +1,53 @@
+#ifndef VIEW_CACHE_H
+#define VIEW_CACHE_H
+
+#include <stdint.h>
+
+#include "openxr/openxr.h"
+
+#define VIEW_CACHE_MAX_VIEWS 4
+
+// The per-frame view work that rarely changes. The view count of a view configuration is fixed,
+// so once it is known xrLocateViews is called once rather than twice. A projection is rebuilt
+// only when the view's fov changes, which on most headsets is never, and view matrices are
+// built from the pose as the transposed rotation rather than by a general inverse.
+typedef struct view_cache_t
+{
+    float near_z;
+    float far_z;
+    int reverse_z;
+
+    uint32_t view_count; // 0 until the first locate
+    int projection_valid[VIEW_CACHE_MAX_VIEWS];
+    XrFovf fovs[VIEW_CACHE_MAX_VIEWS];
+    float projections[VIEW_CACHE_MAX_VIEWS][16];
+
+    // counters, last frame and totals
+    uint32_t projections_built_last;
+    uint32_t projections_reused_last;
+    uint64_t frames;
+    uint64_t count_queries;
+    uint64_t count_queries_skipped;
+    uint64_t projections_built;
+    uint64_t projections_reused;
+} view_cache_t;
+
+// With reverse_z the projection has its far plane at infinity and far_z is not used
+void view_cache_init(view_cache_t *cache, float near_z, float far_z, int reverse_z);
+
+// xrLocateViews into views, which has room for capacity views. Only the first call asks for the
+// count; if the runtime says the cached count is too small it is asked again and the views are
+// located again in the same call.
+XrResult view_cache_locate(view_cache_t *cache, XrSession session, const XrViewLocateInfo *info, XrViewState *view_state,
+                           uint32_t capacity, uint32_t *view_count, XrView *views);
+
+// Call once per frame before the matrices of its views
+void view_cache_begin_frame(view_cache_t *cache);
+// The projection of view i, rebuilt only if fov differs from the one it was last built for
+const float *view_cache_projection(view_cache_t *cache, uint32_t view, const XrFovf *fov);
+// The world to view matrix of a view at pose, which has to hold a unit quaternion
+void view_cache_view_matrix(float result[16], const XrPosef *pose);
+
+void view_cache_print_stats(const view_cache_t *cache);
+
+#endif
@@ -0,0 +1,257 @@
+// Benchmark of the scene BVH (src/bvh.h) against linear scans as the object count grows.
+// Objects are random boxes in a 100m cube; each size reports build, refit and query times
+// and checks the queries against the linear results.
+//
+// usage: bvh_bench [object counts...]
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "clock.h"
+#include "culling.h"
+
+#define WORLD_SIZE 100.0f
+#define QUERY_COUNT 1000
+#define REFIT_FRAMES 100
+
+static uint32_t random_state = 0x12345678;
+
+static float random_float(float min, float max)
+{
+    // xorshift32
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return min + (max - min) * (random_state >> 8) / 16777216.0f;
+}
+
+static void random_box(bvh_aabb_t *box)
+{
+    for (int k = 0; k < 3; k++)
+    {
+        float center = random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2);
+        float half = random_float(0.05f, 0.5f);
+        box->min[k] = center - half;
+        box->max[k] = center + half;
+    }
+}
+
+static void random_frustum(frustum_t *frustum)
+{
+    float axis[3] = {random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)};
+    float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]) + 1e-6f;
+    float half_angle = random_float(0, 3.14159f) / 2;
+    XrPosef pose = {
+        .orientation = {axis[0] / length * sinf(half_angle), axis[1] / length * sinf(half_angle), axis[2] / length * sinf(half_angle), cosf(half_angle)},
+        .position = {random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2), random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2), random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2)},
+    };
+    XrFovf fov = {-0.8f, 0.8f, 0.75f, -0.8f};
+    frustum_from_view(frustum, &pose, &fov, 0.05f, 30.0f);
+}
+
+static int linear_frustum(const frustum_t *frustum, const bvh_aabb_t *box)
+{
+    for (uint32_t p = 0; p < frustum->plane_count; p++)
+    {
+        const float *plane = frustum->planes[p];
+        float distance = plane[3];
+        for (int k = 0; k < 3; k++)
+        {
+            distance += plane[k] * (plane[k] > 0.0f ? box->max[k] : box->min[k]);
+        }
+        if (distance < 0.0f)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static float linear_ray(const float origin[3], const float direction[3], const bvh_aabb_t *box)
+{
+    float t_enter = 0.0f;
+    float t_exit = FLT_MAX;
+    for (int k = 0; k < 3; k++)
+    {
+        float t0 = (box->min[k] - origin[k]) / direction[k];
+        float t1 = (box->max[k] - origin[k]) / direction[k];
+        t_enter = fmaxf(t_enter, fminf(t0, t1));
+        t_exit = fminf(t_exit, fmaxf(t0, t1));
+    }
+    return t_enter <= t_exit ? t_enter : FLT_MAX;
+}
+
+static int linear_sphere(const float center[3], float radius, const bvh_aabb_t *box)
+{
+    float distance_sq = 0.0f;
+    for (int k = 0; k < 3; k++)
+    {
+        float d = fmaxf(fmaxf(box->min[k] - center[k], center[k] - box->max[k]), 0.0f);
+        distance_sq += d * d;
+    }
+    return distance_sq <= radius * radius;
+}
+
+static int bench(uint32_t count)
+{
+    bvh_aabb_t *objects = malloc(count * sizeof(bvh_aabb_t));
+    uint32_t *results = malloc(count * sizeof(uint32_t));
+    if (!objects || !results)
+    {
+        free(objects);
+        free(results);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        random_box(&objects[i]);
+    }
+
+    bvh_t bvh = {0};
+    uint64_t start = clock_ns();
+    if (!bvh_build(&bvh, objects, count))
+    {
+        printf("Failed to build BVH of %u objects\n", count);
+        free(objects);
+        free(results);
+        return 0;
+    }
+    double build_ms = (clock_ns() - start) / 1e6;
+    float build_cost = bvh.build_cost;
+
+    // frustum queries
+    int mismatches = 0;
+    uint64_t bvh_ns = 0, linear_ns = 0;
+    for (int q = 0; q < QUERY_COUNT; q++)
+    {
+        frustum_t frustum;
+        random_frustum(&frustum);
+
+        start = clock_ns();
+        uint32_t found = bvh_query_frustum(&bvh, &frustum, results, count);
+        bvh_ns += clock_ns() - start;
+
+        start = clock_ns();
+        uint32_t expected = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            expected += linear_frustum(&frustum, &objects[i]);
+        }
+        linear_ns += clock_ns() - start;
+
+        mismatches += found != expected;
+    }
+    double frustum_us = bvh_ns / 1e3 / QUERY_COUNT;
+    double frustum_linear_us = linear_ns / 1e3 / QUERY_COUNT;
+
+    // ray casts, as from a controller
+    bvh_ns = linear_ns = 0;
+    for (int q = 0; q < QUERY_COUNT; q++)
+    {
+        float origin[3] = {random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2), random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2), random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2)};
+        float direction[3] = {random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)};
+
+        start = clock_ns();
+        float hit_t = FLT_MAX;
+        bvh_raycast(&bvh, origin, direction, FLT_MAX, &hit_t);
+        bvh_ns += clock_ns() - start;
+
+        start = clock_ns();
+        float expected_t = FLT_MAX;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            expected_t = fminf(expected_t, linear_ray(origin, direction, &objects[i]));
+        }
+        linear_ns += clock_ns() - start;
+
+        mismatches += fabsf(hit_t - expected_t) > 1e-4f * fmaxf(1.0f, expected_t) && !(hit_t == FLT_MAX && expected_t == FLT_MAX);
+    }
+    double ray_us = bvh_ns / 1e3 / QUERY_COUNT;
+    double ray_linear_us = linear_ns / 1e3 / QUERY_COUNT;
+
+    // proximity queries
+    bvh_ns = linear_ns = 0;
+    for (int q = 0; q < QUERY_COUNT; q++)
+    {
+        float center[3] = {random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2), random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2), random_float(-WORLD_SIZE / 2, WORLD_SIZE / 2)};
+
+        start = clock_ns();
+        uint32_t found = bvh_query_sphere(&bvh, center, 2.0f, results, count);
+        bvh_ns += clock_ns() - start;
+
+        start = clock_ns();
+        uint32_t expected = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            expected += linear_sphere(center, 2.0f, &objects[i]);
+        }
+        linear_ns += clock_ns() - start;
+
+        mismatches += found != expected;
+    }
+    double sphere_us = bvh_ns / 1e3 / QUERY_COUNT;
+    double sphere_linear_us = linear_ns / 1e3 / QUERY_COUNT;
+
+    // every object drifts a little each frame, the tree is refit and rebuilt when it degrades
+    uint64_t update_ns = 0, update_max_ns = 0;
+    for (int frame = 0; frame < REFIT_FRAMES; frame++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                float step = random_float(-0.2f, 0.2f);
+                objects[i].min[k] += step;
+                objects[i].max[k] += step;
+            }
+        }
+
+        start = clock_ns();
+        bvh_update(&bvh, objects);
+        uint64_t ns = clock_ns() - start;
+        update_ns += ns;
+        update_max_ns = ns > update_max_ns ? ns : update_max_ns;
+    }
+
+    printf("%8u %9.2f %9.3f %9.3f %3u %8.2f %10.2f %8.2f %10.2f %8.2f %10.2f %5.2f->%5.2f %s\n",
+           count, build_ms, update_ns / 1e6 / REFIT_FRAMES, update_max_ns / 1e6, bvh.rebuilds,
+           frustum_us, frustum_linear_us, ray_us, ray_linear_us, sphere_us, sphere_linear_us,
+           build_cost, bvh.cost, mismatches ? "MISMATCH" : "ok");
+
+    bvh_free(&bvh);
+    free(objects);
+    free(results);
+    return mismatches == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t default_counts[] = {1000, 5000, 10000, 50000, 100000};
+
+    printf("%8s %9s %9s %9s %3s %8s %10s %8s %10s %8s %10s %12s\n",
+           "objects", "build ms", "update ms", "max ms", "reb",
+           "frust us", "linear us", "ray us", "linear us", "near us", "linear us", "SAH cost");
+
+    int ok = 1;
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            ok &= bench((uint32_t)strtoul(argv[i], NULL, 10));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < sizeof(default_counts) / sizeof(default_counts[0]); i++)
+        {
+            ok &= bench(default_counts[i]);
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+// Benchmark of the SIMD mat4 kernels (src/mat4_simd.h) against mathc at every level the build
+// and CPU run. Matrices are random rigid transforms with scale, the kind the scene update
+// makes; each level reports the largest difference from mathc, relative to the largest element
+// of each result, and the time per call. A difference past the tolerance fails the run.
+//
+// usage: mat4_bench [matrix count]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+#include "mat4_simd.h"
+#include "mathc.h"
+
+#define DEFAULT_COUNT 100000
+#define REPEATS 10
+// multiplies and transforms round like mathc except where FMA skips a rounding step
+#define PRODUCT_TOLERANCE 1e-6f
+#define INVERSE_TOLERANCE 1e-5f
+
+static uint32_t random_state = 0x12345678;
+
+static float random_float(float min, float max)
+{
+    // xorshift32
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return min + (max - min) * (random_state >> 8) / 16777216.0f;
+}
+
+static void random_quat(float q[4])
+{
+    float length;
+    do
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            q[k] = random_float(-1, 1);
+        }
+        length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    } while (length < 0.1f);
+
+    for (int k = 0; k < 4; k++)
+    {
+        q[k] /= length;
+    }
+}
+
+static void random_transform(float m[16])
+{
+    float q[4];
+    random_quat(q);
+    float position[3] = {random_float(-50, 50), random_float(-50, 50), random_float(-50, 50)};
+    float scale[3] = {random_float(0.1f, 10), random_float(0.1f, 10), random_float(0.1f, 10)};
+
+    float rotation[16], scaling[16];
+    mat4_rotation_quat(rotation, q);
+    mat4_identity(scaling);
+    mat4_scaling(scaling, scaling, scale);
+    mat4_multiply(m, rotation, scaling);
+    m[12] = position[0];
+    m[13] = position[1];
+    m[14] = position[2];
+}
+
+// The largest difference between a and the reference b, relative to the largest element of
+// b's matrix or vector, so that a sum which cancels to near 0 is judged by what it summed
+static float max_difference(const float *a, const float *b, uint32_t count, uint32_t stride)
+{
+    float max = 0.0f;
+    for (uint32_t i = 0; i < count; i += stride)
+    {
+        float magnitude = 1.0f;
+        for (uint32_t k = 0; k < stride; k++)
+        {
+            magnitude = fabsf(b[i + k]) > magnitude ? fabsf(b[i + k]) : magnitude;
+        }
+        for (uint32_t k = 0; k < stride; k++)
+        {
+            float difference = fabsf(a[i + k] - b[i + k]) / magnitude;
+            if (!(difference <= max))
+            {
+                max = difference;
+            }
+        }
+    }
+    return max;
+}
+
+typedef struct reference_t
+{
+    uint32_t count;
+    float *matrices;  // count matrices
+    float *others;    // count more, the right side of the products
+    float *quats;     // count quaternions
+    float *vectors;   // count vectors, w = 1
+    float *products;  // mathc's results
+    float *inverses;
+    float *rotations;
+    float *transformed;
+    float *result;    // room for count matrices
+} reference_t;
+
+static double ns_per_call(uint64_t start_ns, uint32_t count)
+{
+    return (double)(clock_ns() - start_ns) / ((double)count * REPEATS);
+}
+
+static int bench_level(mat4_simd_level_t level, const reference_t *ref)
+{
+    if (!mat4_simd_use(level))
+    {
+        return 1;
+    }
+
+    uint32_t count = ref->count;
+    float *result = ref->result;
+    uint64_t start_ns;
+
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mat4_multiply_simd(&result[i * 16], &ref->matrices[i * 16], &ref->others[i * 16]);
+        }
+    }
+    double multiply_ns = ns_per_call(start_ns, count);
+    float multiply_difference = max_difference(result, ref->products, count * 16, 16);
+
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mat4_inverse_simd(&result[i * 16], &ref->matrices[i * 16]);
+        }
+    }
+    double inverse_ns = ns_per_call(start_ns, count);
+    float inverse_difference = max_difference(result, ref->inverses, count * 16, 16);
+
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mat4_rotation_quat_simd(&result[i * 16], &ref->quats[i * 4]);
+        }
+    }
+    double rotation_ns = ns_per_call(start_ns, count);
+    float rotation_difference = max_difference(result, ref->rotations, count * 16, 16);
+
+    // every vector by the first matrix, the way a mesh is moved into the world
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        mat4_transform_vec4_simd(result, ref->vectors, count, ref->matrices);
+    }
+    double transform_ns = ns_per_call(start_ns, count);
+    float transform_difference = max_difference(result, ref->transformed, count * 4, 4);
+
+    int ok = multiply_difference <= PRODUCT_TOLERANCE && inverse_difference <= INVERSE_TOLERANCE &&
+             rotation_difference == 0.0f && transform_difference <= PRODUCT_TOLERANCE;
+
+    printf("%-7s %11.2f %9.2g %10.2f %9.2g %10.2f %9.2g %10.2f %9.2g %s\n", mat4_simd_name(level),
+           multiply_ns, multiply_difference, inverse_ns, inverse_difference, rotation_ns, rotation_difference,
+           transform_ns, transform_difference, ok ? "" : "FAIL");
+    return ok;
+}
+
+// mathc's own timings, its results are the reference
+static void bench_mathc(const reference_t *ref)
+{
+    uint32_t count = ref->count;
+    uint64_t start_ns;
+
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mat4_multiply(&ref->products[i * 16], &ref->matrices[i * 16], &ref->others[i * 16]);
+        }
+    }
+    double multiply_ns = ns_per_call(start_ns, count);
+
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mat4_inverse(&ref->inverses[i * 16], &ref->matrices[i * 16]);
+        }
+    }
+    double inverse_ns = ns_per_call(start_ns, count);
+
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mat4_rotation_quat(&ref->rotations[i * 16], &ref->quats[i * 4]);
+        }
+    }
+    double rotation_ns = ns_per_call(start_ns, count);
+
+    start_ns = clock_ns();
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            vec4_multiply_mat4(&ref->transformed[i * 4], &ref->vectors[i * 4], ref->matrices);
+        }
+    }
+    double transform_ns = ns_per_call(start_ns, count);
+
+    printf("%-7s %11.2f %9s %10.2f %9s %10.2f %9s %10.2f %9s\n", "mathc",
+           multiply_ns, "", inverse_ns, "", rotation_ns, "", transform_ns, "");
+}
+
+int main(int argc, char *argv[])
+{
+    reference_t ref = {.count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : DEFAULT_COUNT};
+    if (ref.count == 0)
+    {
+        printf("usage: mat4_bench [matrix count]\n");
+        return 1;
+    }
+
+    uint32_t count = ref.count;
+    ref.matrices = malloc(count * 16 * sizeof(float));
+    ref.others = malloc(count * 16 * sizeof(float));
+    ref.quats = malloc(count * 4 * sizeof(float));
+    ref.vectors = malloc(count * 4 * sizeof(float));
+    ref.products = malloc(count * 16 * sizeof(float));
+    ref.inverses = malloc(count * 16 * sizeof(float));
+    ref.rotations = malloc(count * 16 * sizeof(float));
+    ref.transformed = malloc(count * 4 * sizeof(float));
+    ref.result = malloc(count * 16 * sizeof(float));
+    if (!ref.matrices || !ref.others || !ref.quats || !ref.vectors || !ref.products || !ref.inverses ||
+        !ref.rotations || !ref.transformed || !ref.result)
+    {
+        printf("Failed to allocate %u matrices\n", count);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        random_transform(&ref.matrices[i * 16]);
+        random_transform(&ref.others[i * 16]);
+        random_quat(&ref.quats[i * 4]);
+        for (int k = 0; k < 3; k++)
+        {
+            ref.vectors[i * 4 + k] = random_float(-10, 10);
+        }
+        ref.vectors[i * 4 + 3] = 1.0f;
+    }
+
+    mat4_simd_level_t best = mat4_simd_init();
+    printf("%u matrices, %d repeats, %s picked\n", count, REPEATS, mat4_simd_name(best));
+    printf("%-7s %11s %9s %10s %9s %10s %9s %10s %9s\n", "level",
+           "multiply ns", "max diff", "inverse ns", "max diff", "quat ns", "max diff", "vec4 ns", "max diff");
+
+    bench_mathc(&ref);
+    int ok = 1;
+    ok &= bench_level(MAT4_SIMD_SCALAR, &ref);
+    ok &= bench_level(MAT4_SIMD_SSE, &ref);
+    ok &= bench_level(MAT4_SIMD_AVX2, &ref);
+    ok &= bench_level(MAT4_SIMD_NEON, &ref);
+
+    return ok ? 0 : 1;
+}
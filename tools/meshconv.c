@@ -0,0 +1,216 @@
+// Offline converter from Wavefront OBJ to the binary mesh container (src/mesh_file.h).
+// Faces are triangulated as fans, vertices deduplicated and the result cache optimized,
+// so the app only has to map the file and hand it to the GPU.
+//
+// usage: meshconv input.obj output.xrm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh.h"
+#include "mesh_file.h"
+
+typedef struct float_array_t
+{
+    float *data;
+    uint32_t count; // in floats
+    uint32_t capacity;
+} float_array_t;
+
+typedef struct vertex_array_t
+{
+    mesh_vertex_t *data;
+    uint32_t count;
+    uint32_t capacity;
+} vertex_array_t;
+
+static int float_array_push(float_array_t *array, const float *values, uint32_t count)
+{
+    if (array->count + count > array->capacity)
+    {
+        uint32_t capacity = array->capacity ? array->capacity * 2 : 1024;
+        while (capacity < array->count + count)
+        {
+            capacity *= 2;
+        }
+
+        float *data = realloc(array->data, capacity * sizeof(float));
+        if (!data)
+        {
+            return 0;
+        }
+        array->data = data;
+        array->capacity = capacity;
+    }
+
+    memcpy(&array->data[array->count], values, count * sizeof(float));
+    array->count += count;
+    return 1;
+}
+
+static int vertex_array_push(vertex_array_t *array, const mesh_vertex_t *vertex)
+{
+    if (array->count == array->capacity)
+    {
+        uint32_t capacity = array->capacity ? array->capacity * 2 : 1024;
+        mesh_vertex_t *data = realloc(array->data, capacity * sizeof(mesh_vertex_t));
+        if (!data)
+        {
+            return 0;
+        }
+        array->data = data;
+        array->capacity = capacity;
+    }
+
+    array->data[array->count++] = *vertex;
+    return 1;
+}
+
+// Resolves a 1-based, possibly negative (relative) OBJ index, returns -1 if out of range
+static long resolve_index(long index, uint32_t count)
+{
+    if (index < 0)
+    {
+        index += (long)count;
+    }
+    else
+    {
+        index -= 1;
+    }
+    return index >= 0 && index < (long)count ? index : -1;
+}
+
+// Parses "v", "v/vt", "v//vn" or "v/vt/vn" into a vertex
+static int parse_face_vertex(const char *token, const float_array_t *positions, const float_array_t *uvs, mesh_vertex_t *vertex)
+{
+    char *end;
+    long v = resolve_index(strtol(token, &end, 10), positions->count / 3);
+    if (end == token || v < 0)
+    {
+        return 0;
+    }
+
+    memcpy(vertex->position, &positions->data[v * 3], 3 * sizeof(float));
+    vertex->uv[0] = 0.0f;
+    vertex->uv[1] = 0.0f;
+
+    if (*end == '/' && end[1] != '/')
+    {
+        const char *uv_token = end + 1;
+        long vt = resolve_index(strtol(uv_token, &end, 10), uvs->count / 2);
+        if (end != uv_token && vt >= 0)
+        {
+            memcpy(vertex->uv, &uvs->data[vt * 2], 2 * sizeof(float));
+        }
+    }
+
+    return 1;
+}
+
+static int load_obj(const char *path, vertex_array_t *triangles)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        printf("Failed to open %s\n", path);
+        return 0;
+    }
+
+    float_array_t positions = {0};
+    float_array_t uvs = {0};
+    int ok = 1;
+    unsigned long line_number = 0;
+    char line[4096];
+
+    while (ok && fgets(line, sizeof(line), f))
+    {
+        line_number++;
+
+        if (line[0] == 'v' && line[1] == ' ')
+        {
+            float p[3] = {0, 0, 0};
+            sscanf(line + 2, "%f %f %f", &p[0], &p[1], &p[2]);
+            ok = float_array_push(&positions, p, 3);
+        }
+        else if (line[0] == 'v' && line[1] == 't' && line[2] == ' ')
+        {
+            float uv[2] = {0, 0};
+            sscanf(line + 3, "%f %f", &uv[0], &uv[1]);
+            ok = float_array_push(&uvs, uv, 2);
+        }
+        else if (line[0] == 'f' && line[1] == ' ')
+        {
+            // polygons are triangulated as a fan around their first vertex
+            mesh_vertex_t first, previous, current;
+            int count = 0;
+            for (char *token = strtok(line + 2, " \t\r\n"); token && ok; token = strtok(NULL, " \t\r\n"))
+            {
+                if (!parse_face_vertex(token, &positions, &uvs, &current))
+                {
+                    printf("%s:%lu: invalid face vertex '%s'\n", path, line_number, token);
+                    ok = 0;
+                    break;
+                }
+
+                if (count == 0)
+                {
+                    first = current;
+                }
+                else if (count >= 2)
+                {
+                    ok = vertex_array_push(triangles, &first) &&
+                         vertex_array_push(triangles, &previous) &&
+                         vertex_array_push(triangles, &current);
+                }
+
+                previous = current;
+                count++;
+            }
+        }
+    }
+
+    fclose(f);
+    free(positions.data);
+    free(uvs.data);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        printf("Usage: %s input.obj output.xrm\n", argv[0]);
+        return 1;
+    }
+
+    vertex_array_t triangles = {0};
+    if (!load_obj(argv[1], &triangles))
+    {
+        free(triangles.data);
+        return 1;
+    }
+
+    mesh_data_t mesh;
+    if (!mesh_data_from_triangles(&mesh, triangles.data, triangles.count))
+    {
+        printf("Failed to index mesh\n");
+        free(triangles.data);
+        return 1;
+    }
+    free(triangles.data);
+
+    mesh_stats_t stats;
+    if (!mesh_optimize(&mesh, &stats))
+    {
+        printf("Failed to optimize mesh\n");
+        mesh_data_free(&mesh);
+        return 1;
+    }
+
+    printf("%s: %u triangles, %u vertices, ACMR %.3f -> %.3f\n", argv[1], stats.index_count / 3, stats.vertex_count, stats.acmr_before, stats.acmr_after);
+
+    int ok = mesh_file_write(argv[2], &mesh);
+    mesh_data_free(&mesh);
+    return ok ? 0 : 1;
+}
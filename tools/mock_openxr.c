@@ -0,0 +1,1301 @@
+// Headless stand-in OpenXR runtime for benchmarking the app without a headset.
+// The loader picks it up through the manifest next to it:
+//
+//   XR_RUNTIME_JSON=tools/mock_openxr.json ./game.exe
+//   XR_RUNTIME_JSON=tools/mock_openxr_linux.json ./game
+//
+// It implements the calls main() makes: instance and system queries, session state changes,
+// swapchains backed by plain GL textures in the app's context, xrWaitFrame paced at a fixed
+// rate, head and controller poses scripted from the display time, and timing of every
+// xrEndFrame. Nothing is displayed. Display times advance by exactly one period per frame
+// unless the app misses its slot, so poses, and with them the rendered work, repeat from run
+// to run.
+//
+// Frame calls are locked, so an app that waits on one thread and begins and ends frames on
+// another works too. As in real runtimes, xrWaitFrame holds the next frame back until the one
+// it handed out last has begun.
+//
+// Environment variables:
+//   MOCK_XR_RATE     display rate in Hz, 0 runs unpaced as fast as the app goes (default 90)
+//   MOCK_XR_FRAMES   frames before the runtime asks the session to exit, 0 never (default 0)
+//   MOCK_XR_WIDTH    recommended view width (default 1440)
+//   MOCK_XR_HEIGHT   recommended view height (default 1584)
+//   MOCK_XR_QUAD     1 offers XR_VARJO_quad_views with two focus views (default 0)
+//   MOCK_XR_CAPTURE  file to write per frame timings to as CSV
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+#include "glad/glad.h"
+
+#ifdef _WIN32
+#define XR_USE_PLATFORM_WIN32
+#define MOCK_EXPORT __declspec(dllexport)
+#else
+#include <pthread.h>
+#include <time.h>
+#include <EGL/egl.h>
+#define XR_USE_PLATFORM_EGL
+#define XR_USE_TIMESPEC
+#define MOCK_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define XR_USE_GRAPHICS_API_OPENGL
+#include "openxr/openxr.h"
+#include "openxr/openxr_platform.h"
+
+// Loader negotiation, from the loader's loader_interfaces.h which is not part of the SDK headers
+typedef enum XrLoaderInterfaceStructs
+{
+    XR_LOADER_INTERFACE_STRUCT_UNINTIALIZED = 0,
+    XR_LOADER_INTERFACE_STRUCT_LOADER_INFO,
+    XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST,
+    XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST,
+    XR_LOADER_INTERFACE_STRUCTS_MAX_ENUM = 0x7FFFFFFF
+} XrLoaderInterfaceStructs;
+
+#define XR_LOADER_INFO_STRUCT_VERSION 1
+#define XR_RUNTIME_INFO_STRUCT_VERSION 1
+#define XR_CURRENT_LOADER_RUNTIME_VERSION 1
+
+typedef struct XrNegotiateLoaderInfo
+{
+    XrLoaderInterfaceStructs structType;
+    uint32_t structVersion;
+    size_t structSize;
+    uint32_t minInterfaceVersion;
+    uint32_t maxInterfaceVersion;
+    XrVersion minApiVersion;
+    XrVersion maxApiVersion;
+} XrNegotiateLoaderInfo;
+
+typedef struct XrNegotiateRuntimeRequest
+{
+    XrLoaderInterfaceStructs structType;
+    uint32_t structVersion;
+    size_t structSize;
+    uint32_t runtimeInterfaceVersion;
+    XrVersion runtimeApiVersion;
+    PFN_xrGetInstanceProcAddr getInstanceProcAddr;
+} XrNegotiateRuntimeRequest;
+
+// Capacities
+#define MOCK_MAX_PATHS 256
+#define MOCK_MAX_SPACES 16
+#define MOCK_MAX_ACTIONS 32
+#define MOCK_MAX_SWAPCHAINS 16
+#define MOCK_SWAPCHAIN_LENGTH 3
+#define MOCK_MAX_EVENTS 16
+#define MOCK_MAX_FRAMES_IN_FLIGHT 4
+
+#define MOCK_IPD 0.064f
+#define MOCK_HEAD_HEIGHT 1.6f
+#define MOCK_PI 3.14159265358979323846
+
+typedef struct mock_space_t
+{
+    int used;
+    int hand; // -1 for reference spaces, else the hand of an action space
+} mock_space_t;
+
+typedef struct mock_action_t
+{
+    int used;
+    XrActionType type;
+} mock_action_t;
+
+typedef struct mock_swapchain_t
+{
+    int used;
+    GLenum target;
+    GLuint textures[MOCK_SWAPCHAIN_LENGTH];
+    uint32_t next; // image handed out by the next acquire
+} mock_swapchain_t;
+
+// A frame between xrWaitFrame and xrEndFrame
+typedef struct mock_frame_t
+{
+    XrTime display_time;
+    uint64_t wait_return_ns;
+    uint64_t wait_ns;
+} mock_frame_t;
+
+typedef struct mock_frame_capture_t
+{
+    XrTime display_time;
+    uint64_t wait_ns;    // xrWaitFrame blocked
+    uint64_t cpu_ns;     // xrWaitFrame returning to xrEndFrame
+    int64_t margin_ns;   // xrEndFrame to the display time, negative when late
+    uint32_t view_count; // views in the projection layer
+    int depth;           // depth was submitted
+} mock_frame_capture_t;
+
+static struct
+{
+    // configuration
+    double rate;
+    int64_t period_ns;
+    uint64_t frame_limit;
+    uint32_t width;
+    uint32_t height;
+    int offer_quad;
+    FILE *capture;
+
+    // instance
+    int instance_created;
+    int quad_enabled;
+    char paths[MOCK_MAX_PATHS][XR_MAX_PATH_LENGTH];
+    uint32_t path_count;
+    XrPath left_hand_path;
+    XrPath right_hand_path;
+    XrPath profile_path; // the first interaction profile the app suggested bindings for
+
+    // session
+    int session_created;
+    int session_running;
+    XrSessionState session_state;
+    int exit_requested;
+    XrTime start_time;
+    XrEventDataBuffer events[MOCK_MAX_EVENTS];
+    uint32_t event_first;
+    uint32_t event_count;
+
+    mock_space_t spaces[MOCK_MAX_SPACES];
+    mock_action_t actions[MOCK_MAX_ACTIONS];
+    mock_swapchain_t swapchains[MOCK_MAX_SWAPCHAINS];
+    int gl_loaded;
+
+    // frame loop, xrWaitFrame may run on another thread than xrBeginFrame and xrEndFrame
+    XrTime last_display_time;
+    XrTime waited_display_time; // of the newest waited frame
+    XrTime synced_display_time; // action values are the ones of this time until the next sync
+    int frame_waited;           // a waited frame has not begun yet, the next xrWaitFrame blocks
+    mock_frame_t waited;
+    mock_frame_t begun[MOCK_MAX_FRAMES_IN_FLIGHT];
+    uint32_t begun_count;
+
+    // statistics
+    uint64_t frames;
+    uint64_t missed_slots;
+    uint64_t late_frames;
+    uint64_t cpu_total_ns;
+    uint64_t cpu_max_ns;
+    uint64_t first_frame_ns;
+    uint64_t last_frame_ns;
+    uint64_t haptic_applies;
+    uint64_t haptic_stops;
+} mock;
+
+static XrResult XRAPI_CALL mock_xrGetInstanceProcAddr(XrInstance instance, const char *name, PFN_xrVoidFunction *function);
+
+// Guards the session, the event queue and the frame loop, which a pipelined app reaches from
+// more than one thread
+#ifdef _WIN32
+static SRWLOCK mock_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE mock_frame_begun = CONDITION_VARIABLE_INIT;
+#define MOCK_LOCK() AcquireSRWLockExclusive(&mock_lock)
+#define MOCK_UNLOCK() ReleaseSRWLockExclusive(&mock_lock)
+#define MOCK_WAIT_BEGUN() SleepConditionVariableSRW(&mock_frame_begun, &mock_lock, INFINITE, 0)
+#define MOCK_SIGNAL_BEGUN() WakeAllConditionVariable(&mock_frame_begun)
+#else
+static pthread_mutex_t mock_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mock_frame_begun = PTHREAD_COND_INITIALIZER;
+#define MOCK_LOCK() pthread_mutex_lock(&mock_lock)
+#define MOCK_UNLOCK() pthread_mutex_unlock(&mock_lock)
+#define MOCK_WAIT_BEGUN() pthread_cond_wait(&mock_frame_begun, &mock_lock)
+#define MOCK_SIGNAL_BEGUN() pthread_cond_broadcast(&mock_frame_begun)
+#endif
+
+static uint32_t env_uint(const char *name, uint32_t fallback)
+{
+    const char *value = getenv(name);
+    return value && *value ? (uint32_t)strtoul(value, NULL, 10) : fallback;
+}
+
+static void load_config(void)
+{
+    const char *rate = getenv("MOCK_XR_RATE");
+    mock.rate = rate && *rate ? atof(rate) : 90.0;
+    // unpaced runs still advance display time by a 90 Hz period so poses match a paced run
+    mock.period_ns = (int64_t)(1e9 / (mock.rate > 0.0 ? mock.rate : 90.0));
+    mock.frame_limit = env_uint("MOCK_XR_FRAMES", 0);
+    mock.width = env_uint("MOCK_XR_WIDTH", 1440);
+    mock.height = env_uint("MOCK_XR_HEIGHT", 1584);
+    mock.offer_quad = env_uint("MOCK_XR_QUAD", 0) != 0;
+
+    const char *capture = getenv("MOCK_XR_CAPTURE");
+    if (capture && *capture)
+    {
+        mock.capture = fopen(capture, "w");
+        if (mock.capture)
+        {
+            fprintf(mock.capture, "frame,display_time_ns,wait_ns,cpu_ns,margin_ns,views,depth\n");
+        }
+        else
+        {
+            printf("Mock runtime: failed to open %s\n", capture);
+        }
+    }
+}
+
+static void sleep_until(uint64_t target_ns)
+{
+    // coarse sleeps while far away, then spin, so pacing does not depend on the OS timer tick
+    while (clock_ns() + 2000000 < target_ns)
+    {
+#ifdef _WIN32
+        Sleep(1);
+#else
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+#endif
+    }
+    while (clock_ns() < target_ns)
+    {
+    }
+}
+
+static void push_state_event(XrSessionState state)
+{
+    if (mock.event_count == MOCK_MAX_EVENTS)
+    {
+        return;
+    }
+
+    XrEventDataSessionStateChanged *event = (XrEventDataSessionStateChanged *)&mock.events[(mock.event_first + mock.event_count) % MOCK_MAX_EVENTS];
+    memset(event, 0, sizeof(XrEventDataBuffer));
+    event->type = XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED;
+    event->session = (XrSession)(uintptr_t)1;
+    event->state = state;
+    event->time = (XrTime)clock_ns();
+    mock.event_count++;
+    mock.session_state = state;
+}
+
+static void push_profile_event(void)
+{
+    if (mock.event_count == MOCK_MAX_EVENTS)
+    {
+        return;
+    }
+
+    XrEventDataInteractionProfileChanged *event = (XrEventDataInteractionProfileChanged *)&mock.events[(mock.event_first + mock.event_count) % MOCK_MAX_EVENTS];
+    memset(event, 0, sizeof(XrEventDataBuffer));
+    event->type = XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED;
+    event->session = (XrSession)(uintptr_t)1;
+    mock.event_count++;
+}
+
+static void request_exit(void)
+{
+    if (!mock.exit_requested && mock.session_running)
+    {
+        mock.exit_requested = 1;
+        push_state_event(XR_SESSION_STATE_STOPPING);
+    }
+}
+
+// Scripted poses, functions of the display time only
+
+static XrQuaternionf quat_yaw_pitch(float yaw, float pitch)
+{
+    float cy = cosf(yaw / 2), sy = sinf(yaw / 2);
+    float cp = cosf(pitch / 2), sp = sinf(pitch / 2);
+    XrQuaternionf q = {cy * sp, sy * cp, -sy * sp, cy * cp};
+    return q;
+}
+
+static XrVector3f quat_rotate(XrQuaternionf q, XrVector3f v)
+{
+    // v + 2w(u x v) + 2u x (u x v)
+    XrVector3f u = {q.x, q.y, q.z};
+    XrVector3f t = {2 * (u.y * v.z - u.z * v.y), 2 * (u.z * v.x - u.x * v.z), 2 * (u.x * v.y - u.y * v.x)};
+    XrVector3f r = {
+        v.x + q.w * t.x + (u.y * t.z - u.z * t.y),
+        v.y + q.w * t.y + (u.z * t.x - u.x * t.z),
+        v.z + q.w * t.z + (u.x * t.y - u.y * t.x),
+    };
+    return r;
+}
+
+static double script_seconds(XrTime time)
+{
+    return (time - mock.start_time) / 1e9;
+}
+
+static XrPosef head_pose(XrTime time)
+{
+    // looks around slowly, left and right over 8 s and up and down over 5 s
+    double t = script_seconds(time);
+    XrPosef pose = {
+        .orientation = quat_yaw_pitch(0.6f * (float)sin(t * 2 * MOCK_PI / 8), 0.2f * (float)sin(t * 2 * MOCK_PI / 5)),
+        .position = {0.05f * (float)sin(t * 2 * MOCK_PI / 3), MOCK_HEAD_HEIGHT, 0.0f},
+    };
+    return pose;
+}
+
+static XrPosef hand_pose(int hand, XrTime time)
+{
+    // each hand circles in front of the body, pointing ahead
+    double t = script_seconds(time) + hand * 0.5;
+    float side = hand == 0 ? -1.0f : 1.0f;
+    XrPosef pose = {
+        .orientation = quat_yaw_pitch(0.3f * (float)sin(t * 2 * MOCK_PI / 4), -0.3f),
+        .position = {side * 0.25f + 0.1f * (float)cos(t * 2 * MOCK_PI / 2), 1.2f + 0.1f * (float)sin(t * 2 * MOCK_PI / 2), -0.4f},
+    };
+    return pose;
+}
+
+static float trigger_value(int hand, XrTime time)
+{
+    double t = script_seconds(time) + hand;
+    return (float)(0.5 + 0.5 * sin(t * 2 * MOCK_PI / 3));
+}
+
+static int hand_of_path(XrPath path)
+{
+    return path == mock.left_hand_path ? 0 : (path == mock.right_hand_path ? 1 : -1);
+}
+
+static XrFovf view_fov(uint32_t view)
+{
+    // slightly canted outwards like most headsets, the focus views cover the middle
+    XrFovf context = {-0.90f, 0.80f, 0.85f, -0.90f};
+    XrFovf focus = {-0.35f, 0.35f, 0.33f, -0.33f};
+    XrFovf fov = view < 2 ? context : focus;
+    if (view % 2 == 1)
+    {
+        float left = fov.angleLeft;
+        fov.angleLeft = -fov.angleRight;
+        fov.angleRight = -left;
+    }
+    return fov;
+}
+
+static uint32_t view_count(XrViewConfigurationType type)
+{
+    return type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO ? 4 : 2;
+}
+
+// Instance
+
+static XrResult XRAPI_CALL mock_xrEnumerateInstanceExtensionProperties(const char *layerName, uint32_t capacity, uint32_t *count, XrExtensionProperties *properties)
+{
+    const char *extensions[5];
+    uint32_t extension_count = 0;
+    extensions[extension_count++] = XR_KHR_OPENGL_ENABLE_EXTENSION_NAME;
+    extensions[extension_count++] = XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME;
+#ifdef _WIN32
+    extensions[extension_count++] = XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME;
+#else
+    extensions[extension_count++] = XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME;
+    extensions[extension_count++] = XR_MNDX_EGL_ENABLE_EXTENSION_NAME;
+#endif
+    if (env_uint("MOCK_XR_QUAD", 0))
+    {
+        extensions[extension_count++] = XR_VARJO_QUAD_VIEWS_EXTENSION_NAME;
+    }
+
+    *count = extension_count;
+    if (capacity == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacity < extension_count)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+
+    for (uint32_t i = 0; i < extension_count; i++)
+    {
+        strncpy(properties[i].extensionName, extensions[i], XR_MAX_EXTENSION_NAME_SIZE - 1);
+        properties[i].extensionVersion = 1;
+    }
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrEnumerateApiLayerProperties(uint32_t capacity, uint32_t *count, XrApiLayerProperties *properties)
+{
+    *count = 0;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrCreateInstance(const XrInstanceCreateInfo *info, XrInstance *instance)
+{
+    if (mock.instance_created)
+    {
+        return XR_ERROR_LIMIT_REACHED;
+    }
+
+    memset(&mock, 0, sizeof(mock));
+    load_config();
+
+    for (uint32_t i = 0; i < info->enabledExtensionCount; i++)
+    {
+        if (strcmp(info->enabledExtensionNames[i], XR_VARJO_QUAD_VIEWS_EXTENSION_NAME) == 0)
+        {
+            mock.quad_enabled = mock.offer_quad;
+        }
+    }
+
+    mock.instance_created = 1;
+    *instance = (XrInstance)(uintptr_t)1;
+    printf("Mock runtime: %.0f Hz%s, %ux%u views%s\n", mock.rate, mock.rate > 0.0 ? "" : " (unpaced)", mock.width, mock.height,
+           mock.quad_enabled ? ", quad views" : "");
+    return XR_SUCCESS;
+}
+
+static void print_capture_stats(void)
+{
+    if (mock.frames == 0)
+    {
+        return;
+    }
+
+    double seconds = (mock.last_frame_ns - mock.first_frame_ns) / 1e9;
+    printf("Mock runtime: %llu frames in %.2f s, %.1f fps, %llu display slots missed, %llu frames submitted late\n",
+           (unsigned long long)mock.frames, seconds, seconds > 0.0 ? (mock.frames - 1) / seconds : 0.0,
+           (unsigned long long)mock.missed_slots, (unsigned long long)mock.late_frames);
+    printf("Mock runtime: CPU frame time avg %.3f ms, max %.3f ms\n", mock.cpu_total_ns / 1e6 / mock.frames, mock.cpu_max_ns / 1e6);
+    printf("Mock runtime: %llu haptic vibrations applied, %llu stopped\n",
+           (unsigned long long)mock.haptic_applies, (unsigned long long)mock.haptic_stops);
+}
+
+static XrResult XRAPI_CALL mock_xrDestroyInstance(XrInstance instance)
+{
+    print_capture_stats();
+    if (mock.capture)
+    {
+        fclose(mock.capture);
+    }
+    memset(&mock, 0, sizeof(mock));
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrGetInstanceProperties(XrInstance instance, XrInstanceProperties *properties)
+{
+    properties->runtimeVersion = XR_MAKE_VERSION(0, 1, 0);
+    strncpy(properties->runtimeName, "Mock headless runtime", XR_MAX_RUNTIME_NAME_SIZE - 1);
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrStringToPath(XrInstance instance, const char *string, XrPath *path)
+{
+    for (uint32_t i = 0; i < mock.path_count; i++)
+    {
+        if (strcmp(mock.paths[i], string) == 0)
+        {
+            *path = i + 1;
+            return XR_SUCCESS;
+        }
+    }
+
+    if (mock.path_count == MOCK_MAX_PATHS || strlen(string) >= XR_MAX_PATH_LENGTH)
+    {
+        return XR_ERROR_PATH_COUNT_EXCEEDED;
+    }
+
+    strcpy(mock.paths[mock.path_count], string);
+    *path = ++mock.path_count;
+
+    if (strcmp(string, "/user/hand/left") == 0)
+    {
+        mock.left_hand_path = *path;
+    }
+    else if (strcmp(string, "/user/hand/right") == 0)
+    {
+        mock.right_hand_path = *path;
+    }
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrPathToString(XrInstance instance, XrPath path, uint32_t capacity, uint32_t *count, char *buffer)
+{
+    if (path == XR_NULL_PATH || path > mock.path_count)
+    {
+        return XR_ERROR_PATH_INVALID;
+    }
+
+    const char *string = mock.paths[path - 1];
+    *count = (uint32_t)strlen(string) + 1;
+    if (capacity == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacity < *count)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    memcpy(buffer, string, *count);
+    return XR_SUCCESS;
+}
+
+#ifdef _WIN32
+static XrResult XRAPI_CALL mock_xrConvertWin32PerformanceCounterToTimeKHR(XrInstance instance, const LARGE_INTEGER *counter, XrTime *time)
+{
+    // XrTime here is clock_ns, which is the performance counter in nanoseconds
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    *time = (XrTime)((counter->QuadPart / frequency.QuadPart) * 1000000000ll + (counter->QuadPart % frequency.QuadPart) * 1000000000ll / frequency.QuadPart);
+    return XR_SUCCESS;
+}
+#else
+static XrResult XRAPI_CALL mock_xrConvertTimespecTimeToTimeKHR(XrInstance instance, const struct timespec *timespec_time, XrTime *time)
+{
+    // XrTime here is clock_ns, which is CLOCK_MONOTONIC in nanoseconds
+    *time = (XrTime)timespec_time->tv_sec * 1000000000ll + timespec_time->tv_nsec;
+    return XR_SUCCESS;
+}
+#endif
+
+// System
+
+static XrResult XRAPI_CALL mock_xrGetSystem(XrInstance instance, const XrSystemGetInfo *info, XrSystemId *system)
+{
+    if (info->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY)
+    {
+        return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+    }
+    *system = 1;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrGetSystemProperties(XrInstance instance, XrSystemId system, XrSystemProperties *properties)
+{
+    properties->systemId = system;
+    properties->vendorId = 0;
+    strncpy(properties->systemName, "Mock headset", XR_MAX_SYSTEM_NAME_SIZE - 1);
+    properties->graphicsProperties.maxLayerCount = 16;
+    properties->graphicsProperties.maxSwapchainImageWidth = 8192;
+    properties->graphicsProperties.maxSwapchainImageHeight = 8192;
+    properties->trackingProperties.orientationTracking = XR_TRUE;
+    properties->trackingProperties.positionTracking = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrEnumerateViewConfigurations(XrInstance instance, XrSystemId system, uint32_t capacity, uint32_t *count, XrViewConfigurationType *types)
+{
+    *count = mock.quad_enabled ? 2 : 1;
+    if (capacity == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacity < *count)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+
+    types[0] = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+    if (mock.quad_enabled)
+    {
+        types[1] = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+    }
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrEnumerateViewConfigurationViews(XrInstance instance, XrSystemId system, XrViewConfigurationType type, uint32_t capacity, uint32_t *count, XrViewConfigurationView *views)
+{
+    if (type != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO && !(type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO && mock.quad_enabled))
+    {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+
+    *count = view_count(type);
+    if (capacity == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacity < *count)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+
+    for (uint32_t i = 0; i < *count; i++)
+    {
+        // focus views get as many pixels as context views on a much narrower fov
+        views[i].recommendedImageRectWidth = i < 2 ? mock.width : mock.width * 3 / 4;
+        views[i].recommendedImageRectHeight = i < 2 ? mock.height : mock.width * 3 / 4;
+        views[i].maxImageRectWidth = 8192;
+        views[i].maxImageRectHeight = 8192;
+        views[i].recommendedSwapchainSampleCount = 1;
+        views[i].maxSwapchainSampleCount = 1;
+    }
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrGetOpenGLGraphicsRequirementsKHR(XrInstance instance, XrSystemId system, XrGraphicsRequirementsOpenGLKHR *requirements)
+{
+    requirements->minApiVersionSupported = XR_MAKE_VERSION(4, 3, 0);
+    requirements->maxApiVersionSupported = XR_MAKE_VERSION(4, 6, 0);
+    return XR_SUCCESS;
+}
+
+// Session
+
+static XrResult XRAPI_CALL mock_xrCreateSession(XrInstance instance, const XrSessionCreateInfo *info, XrSession *session)
+{
+    if (mock.session_created)
+    {
+        return XR_ERROR_LIMIT_REACHED;
+    }
+
+    // the app's context is current on this thread, only EGL needs the binding to find the GL functions
+#ifndef _WIN32
+    for (const XrBaseInStructure *next = info->next; next; next = next->next)
+    {
+        if (next->type == XR_TYPE_GRAPHICS_BINDING_EGL_MNDX && !mock.gl_loaded)
+        {
+            const XrGraphicsBindingEGLMNDX *binding = (const XrGraphicsBindingEGLMNDX *)next;
+            if (!gladLoadGLLoader((GLADloadproc)binding->getProcAddress))
+            {
+                printf("Mock runtime: failed to load OpenGL through EGL\n");
+                return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+            }
+            mock.gl_loaded = 1;
+        }
+    }
+#endif
+
+    mock.session_created = 1;
+    mock.start_time = (XrTime)clock_ns();
+    push_state_event(XR_SESSION_STATE_IDLE);
+    push_state_event(XR_SESSION_STATE_READY);
+    *session = (XrSession)(uintptr_t)1;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrDestroySession(XrSession session)
+{
+    for (uint32_t i = 0; i < MOCK_MAX_SWAPCHAINS; i++)
+    {
+        if (mock.swapchains[i].used)
+        {
+            glDeleteTextures(MOCK_SWAPCHAIN_LENGTH, mock.swapchains[i].textures);
+        }
+    }
+    memset(mock.swapchains, 0, sizeof(mock.swapchains));
+    memset(mock.spaces, 0, sizeof(mock.spaces));
+    mock.session_created = 0;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrBeginSession(XrSession session, const XrSessionBeginInfo *info)
+{
+    if (info->primaryViewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO &&
+        !(info->primaryViewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO && mock.quad_enabled))
+    {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+
+    MOCK_LOCK();
+    if (mock.session_running)
+    {
+        MOCK_UNLOCK();
+        return XR_ERROR_SESSION_RUNNING;
+    }
+
+    mock.session_running = 1;
+    push_state_event(XR_SESSION_STATE_SYNCHRONIZED);
+    push_state_event(XR_SESSION_STATE_VISIBLE);
+    push_state_event(XR_SESSION_STATE_FOCUSED);
+    MOCK_UNLOCK();
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrEndSession(XrSession session)
+{
+    MOCK_LOCK();
+    if (!mock.session_running)
+    {
+        MOCK_UNLOCK();
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+
+    // frames still in flight are dropped, a blocked xrWaitFrame returns
+    mock.session_running = 0;
+    mock.frame_waited = 0;
+    mock.begun_count = 0;
+    MOCK_SIGNAL_BEGUN();
+    push_state_event(XR_SESSION_STATE_IDLE);
+    push_state_event(XR_SESSION_STATE_EXITING);
+    MOCK_UNLOCK();
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrRequestExitSession(XrSession session)
+{
+    MOCK_LOCK();
+    XrResult result = mock.session_running ? XR_SUCCESS : XR_ERROR_SESSION_NOT_RUNNING;
+    request_exit();
+    MOCK_UNLOCK();
+    return result;
+}
+
+static XrResult XRAPI_CALL mock_xrPollEvent(XrInstance instance, XrEventDataBuffer *event)
+{
+    MOCK_LOCK();
+    if (mock.event_count == 0)
+    {
+        MOCK_UNLOCK();
+        return XR_EVENT_UNAVAILABLE;
+    }
+
+    *event = mock.events[mock.event_first];
+    mock.event_first = (mock.event_first + 1) % MOCK_MAX_EVENTS;
+    mock.event_count--;
+    MOCK_UNLOCK();
+    return XR_SUCCESS;
+}
+
+// Spaces and actions
+
+static XrResult create_space(int hand, XrSpace *space)
+{
+    for (uint32_t i = 0; i < MOCK_MAX_SPACES; i++)
+    {
+        if (!mock.spaces[i].used)
+        {
+            mock.spaces[i].used = 1;
+            mock.spaces[i].hand = hand;
+            *space = (XrSpace)&mock.spaces[i];
+            return XR_SUCCESS;
+        }
+    }
+    return XR_ERROR_LIMIT_REACHED;
+}
+
+static XrResult XRAPI_CALL mock_xrCreateReferenceSpace(XrSession session, const XrReferenceSpaceCreateInfo *info, XrSpace *space)
+{
+    // every reference space is the stage and pose offsets are ignored, the app uses neither
+    return create_space(-1, space);
+}
+
+static XrResult XRAPI_CALL mock_xrCreateActionSpace(XrSession session, const XrActionSpaceCreateInfo *info, XrSpace *space)
+{
+    return create_space(hand_of_path(info->subactionPath), space);
+}
+
+static XrResult XRAPI_CALL mock_xrDestroySpace(XrSpace space)
+{
+    ((mock_space_t *)space)->used = 0;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrLocateSpace(XrSpace space, XrSpace base, XrTime time, XrSpaceLocation *location)
+{
+    const mock_space_t *located = (const mock_space_t *)space;
+    XrPosef identity = {{0, 0, 0, 1}, {0, 0, 0}};
+    location->pose = located->hand >= 0 ? hand_pose(located->hand, time) : identity;
+    location->locationFlags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT |
+                              XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrCreateActionSet(XrInstance instance, const XrActionSetCreateInfo *info, XrActionSet *action_set)
+{
+    *action_set = (XrActionSet)(uintptr_t)1;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrDestroyActionSet(XrActionSet action_set)
+{
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrCreateAction(XrActionSet action_set, const XrActionCreateInfo *info, XrAction *action)
+{
+    for (uint32_t i = 0; i < MOCK_MAX_ACTIONS; i++)
+    {
+        if (!mock.actions[i].used)
+        {
+            mock.actions[i].used = 1;
+            mock.actions[i].type = info->actionType;
+            *action = (XrAction)&mock.actions[i];
+            return XR_SUCCESS;
+        }
+    }
+    return XR_ERROR_LIMIT_REACHED;
+}
+
+static XrResult XRAPI_CALL mock_xrDestroyAction(XrAction action)
+{
+    ((mock_action_t *)action)->used = 0;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrSuggestInteractionProfileBindings(XrInstance instance, const XrInteractionProfileSuggestedBinding *bindings)
+{
+    if (mock.profile_path == XR_NULL_PATH)
+    {
+        mock.profile_path = bindings->interactionProfile;
+    }
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrAttachSessionActionSets(XrSession session, const XrSessionActionSetsAttachInfo *info)
+{
+    MOCK_LOCK();
+    push_profile_event();
+    MOCK_UNLOCK();
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrGetCurrentInteractionProfile(XrSession session, XrPath top_level_path, XrInteractionProfileState *profile)
+{
+    profile->interactionProfile = mock.profile_path;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrSyncActions(XrSession session, const XrActionsSyncInfo *info)
+{
+    MOCK_LOCK();
+    XrResult result = XR_SESSION_NOT_FOCUSED;
+    if (mock.session_state == XR_SESSION_STATE_FOCUSED)
+    {
+        mock.synced_display_time = mock.waited_display_time;
+        result = XR_SUCCESS;
+    }
+    MOCK_UNLOCK();
+    return result;
+}
+
+static XrResult XRAPI_CALL mock_xrGetActionStatePose(XrSession session, const XrActionStateGetInfo *info, XrActionStatePose *state)
+{
+    state->isActive = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrGetActionStateFloat(XrSession session, const XrActionStateGetInfo *info, XrActionStateFloat *state)
+{
+    int hand = hand_of_path(info->subactionPath);
+    MOCK_LOCK();
+    XrTime synced_time = mock.synced_display_time;
+    MOCK_UNLOCK();
+    state->currentState = trigger_value(hand < 0 ? 0 : hand, synced_time);
+    state->changedSinceLastSync = XR_TRUE;
+    state->lastChangeTime = synced_time;
+    state->isActive = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrApplyHapticFeedback(XrSession session, const XrHapticActionInfo *info, const XrHapticBaseHeader *haptic)
+{
+    MOCK_LOCK();
+    mock.haptic_applies++;
+    MOCK_UNLOCK();
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrStopHapticFeedback(XrSession session, const XrHapticActionInfo *info)
+{
+    MOCK_LOCK();
+    mock.haptic_stops++;
+    MOCK_UNLOCK();
+    return XR_SUCCESS;
+}
+
+// Swapchains
+
+static XrResult XRAPI_CALL mock_xrEnumerateSwapchainFormats(XrSession session, uint32_t capacity, uint32_t *count, int64_t *formats)
+{
+    static const int64_t supported[] = {GL_SRGB8_ALPHA8, GL_RGBA8, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT16};
+    *count = sizeof(supported) / sizeof(supported[0]);
+    if (capacity == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacity < *count)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    memcpy(formats, supported, sizeof(supported));
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrCreateSwapchain(XrSession session, const XrSwapchainCreateInfo *info, XrSwapchain *swapchain)
+{
+    if (info->faceCount != 1 || info->sampleCount > 1 || info->width == 0 || info->height == 0)
+    {
+        return XR_ERROR_FEATURE_UNSUPPORTED;
+    }
+
+    // the app's context is current, so GL calls here create textures it can render to
+    if (!mock.gl_loaded)
+    {
+        if (!gladLoadGL())
+        {
+            printf("Mock runtime: failed to load OpenGL\n");
+            return XR_ERROR_RUNTIME_FAILURE;
+        }
+        mock.gl_loaded = 1;
+    }
+
+    for (uint32_t i = 0; i < MOCK_MAX_SWAPCHAINS; i++)
+    {
+        mock_swapchain_t *chain = &mock.swapchains[i];
+        if (chain->used)
+        {
+            continue;
+        }
+
+        chain->used = 1;
+        chain->next = 0;
+        chain->target = info->arraySize > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        glGenTextures(MOCK_SWAPCHAIN_LENGTH, chain->textures);
+        for (uint32_t j = 0; j < MOCK_SWAPCHAIN_LENGTH; j++)
+        {
+            glBindTexture(chain->target, chain->textures[j]);
+            if (chain->target == GL_TEXTURE_2D_ARRAY)
+            {
+                glTexStorage3D(GL_TEXTURE_2D_ARRAY, info->mipCount, (GLenum)info->format, info->width, info->height, info->arraySize);
+            }
+            else
+            {
+                glTexStorage2D(GL_TEXTURE_2D, info->mipCount, (GLenum)info->format, info->width, info->height);
+            }
+        }
+        glBindTexture(chain->target, 0);
+
+        *swapchain = (XrSwapchain)chain;
+        return XR_SUCCESS;
+    }
+    return XR_ERROR_LIMIT_REACHED;
+}
+
+static XrResult XRAPI_CALL mock_xrDestroySwapchain(XrSwapchain swapchain)
+{
+    mock_swapchain_t *chain = (mock_swapchain_t *)swapchain;
+    glDeleteTextures(MOCK_SWAPCHAIN_LENGTH, chain->textures);
+    chain->used = 0;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrEnumerateSwapchainImages(XrSwapchain swapchain, uint32_t capacity, uint32_t *count, XrSwapchainImageBaseHeader *images)
+{
+    const mock_swapchain_t *chain = (const mock_swapchain_t *)swapchain;
+    *count = MOCK_SWAPCHAIN_LENGTH;
+    if (capacity == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacity < MOCK_SWAPCHAIN_LENGTH)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+
+    XrSwapchainImageOpenGLKHR *gl_images = (XrSwapchainImageOpenGLKHR *)images;
+    for (uint32_t i = 0; i < MOCK_SWAPCHAIN_LENGTH; i++)
+    {
+        gl_images[i].image = chain->textures[i];
+    }
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrAcquireSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageAcquireInfo *info, uint32_t *index)
+{
+    mock_swapchain_t *chain = (mock_swapchain_t *)swapchain;
+    *index = chain->next;
+    chain->next = (chain->next + 1) % MOCK_SWAPCHAIN_LENGTH;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo *info)
+{
+    // nothing reads the images, they are always ready
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo *info)
+{
+    return XR_SUCCESS;
+}
+
+// Frame loop
+
+static XrResult XRAPI_CALL mock_xrWaitFrame(XrSession session, const XrFrameWaitInfo *info, XrFrameState *state)
+{
+    uint64_t start_ns = clock_ns();
+
+    // like a real runtime, a frame is only handed out once the previous one has begun
+    MOCK_LOCK();
+    while (mock.frame_waited && mock.session_running)
+    {
+        MOCK_WAIT_BEGUN();
+    }
+    if (!mock.session_running)
+    {
+        MOCK_UNLOCK();
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+
+    XrTime display_time;
+    if (mock.last_display_time == 0)
+    {
+        display_time = (XrTime)start_ns + mock.period_ns;
+    }
+    else
+    {
+        display_time = mock.last_display_time + mock.period_ns;
+    }
+
+    if (mock.rate > 0.0)
+    {
+        // the app is released one period ahead of its display time; if it is too late to
+        // make a slot in time, it gets the next one and the slots between show the old frame
+        uint64_t now_ns = clock_ns();
+        while (display_time - (XrTime)now_ns < mock.period_ns / 2)
+        {
+            display_time += mock.period_ns;
+            mock.missed_slots++;
+        }
+    }
+
+    mock.last_display_time = display_time;
+    mock.frame_waited = 1;
+    int should_render = mock.session_state == XR_SESSION_STATE_VISIBLE || mock.session_state == XR_SESSION_STATE_FOCUSED;
+    MOCK_UNLOCK();
+
+    if (mock.rate > 0.0)
+    {
+        sleep_until((uint64_t)(display_time - mock.period_ns));
+    }
+
+    MOCK_LOCK();
+    mock.waited_display_time = display_time;
+    mock.waited.display_time = display_time;
+    mock.waited.wait_return_ns = clock_ns();
+    mock.waited.wait_ns = mock.waited.wait_return_ns - start_ns;
+    MOCK_UNLOCK();
+
+    state->predictedDisplayTime = display_time;
+    state->predictedDisplayPeriod = mock.period_ns;
+    state->shouldRender = should_render;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrBeginFrame(XrSession session, const XrFrameBeginInfo *info)
+{
+    MOCK_LOCK();
+    XrResult result = XR_SUCCESS;
+    if (!mock.session_running)
+    {
+        result = XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    else if (!mock.frame_waited || mock.begun_count == MOCK_MAX_FRAMES_IN_FLIGHT)
+    {
+        result = XR_ERROR_CALL_ORDER_INVALID;
+    }
+    else
+    {
+        mock.begun[mock.begun_count++] = mock.waited;
+        mock.frame_waited = 0;
+        MOCK_SIGNAL_BEGUN();
+    }
+    MOCK_UNLOCK();
+    return result;
+}
+
+static XrResult XRAPI_CALL mock_xrLocateViews(XrSession session, const XrViewLocateInfo *info, XrViewState *state, uint32_t capacity, uint32_t *count, XrView *views)
+{
+    if (info->viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO &&
+        !(info->viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO && mock.quad_enabled))
+    {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+
+    *count = view_count(info->viewConfigurationType);
+    if (capacity == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacity < *count)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+
+    XrPosef head = head_pose(info->displayTime);
+    for (uint32_t i = 0; i < *count; i++)
+    {
+        XrVector3f eye_offset = {i % 2 == 0 ? -MOCK_IPD / 2 : MOCK_IPD / 2, 0.0f, 0.0f};
+        XrVector3f offset = quat_rotate(head.orientation, eye_offset);
+        views[i].pose.orientation = head.orientation;
+        views[i].pose.position.x = head.position.x + offset.x;
+        views[i].pose.position.y = head.position.y + offset.y;
+        views[i].pose.position.z = head.position.z + offset.z;
+        views[i].fov = view_fov(i);
+    }
+
+    state->viewStateFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT |
+                            XR_VIEW_STATE_ORIENTATION_TRACKED_BIT | XR_VIEW_STATE_POSITION_TRACKED_BIT;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL mock_xrEndFrame(XrSession session, const XrFrameEndInfo *info)
+{
+    MOCK_LOCK();
+    if (!mock.session_running)
+    {
+        MOCK_UNLOCK();
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+
+    // frames end in the order they began
+    if (mock.begun_count == 0 || info->displayTime != mock.begun[0].display_time)
+    {
+        MOCK_UNLOCK();
+        return mock.begun_count == 0 ? XR_ERROR_CALL_ORDER_INVALID : XR_ERROR_TIME_INVALID;
+    }
+    mock_frame_t frame = mock.begun[0];
+    mock.begun_count--;
+    memmove(&mock.begun[0], &mock.begun[1], mock.begun_count * sizeof(mock_frame_t));
+
+    uint64_t end_ns = clock_ns();
+    mock_frame_capture_t capture = {
+        .display_time = info->displayTime,
+        .wait_ns = frame.wait_ns,
+        .cpu_ns = end_ns - frame.wait_return_ns,
+        .margin_ns = info->displayTime - (XrTime)end_ns,
+    };
+
+    for (uint32_t i = 0; i < info->layerCount; i++)
+    {
+        if (info->layers[i]->type != XR_TYPE_COMPOSITION_LAYER_PROJECTION)
+        {
+            continue;
+        }
+
+        const XrCompositionLayerProjection *layer = (const XrCompositionLayerProjection *)info->layers[i];
+        capture.view_count = layer->viewCount;
+        for (uint32_t v = 0; v < layer->viewCount; v++)
+        {
+            const XrCompositionLayerDepthInfoKHR *depth = layer->views[v].next;
+            capture.depth |= depth && depth->type == XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR;
+        }
+    }
+
+    if (mock.frames == 0)
+    {
+        mock.first_frame_ns = end_ns;
+    }
+    mock.last_frame_ns = end_ns;
+    mock.frames++;
+    mock.late_frames += mock.rate > 0.0 && capture.margin_ns < 0;
+    mock.cpu_total_ns += capture.cpu_ns;
+    mock.cpu_max_ns = capture.cpu_ns > mock.cpu_max_ns ? capture.cpu_ns : mock.cpu_max_ns;
+
+    if (mock.capture)
+    {
+        fprintf(mock.capture, "%llu,%lld,%llu,%llu,%lld,%u,%d\n", (unsigned long long)mock.frames, (long long)capture.display_time,
+                (unsigned long long)capture.wait_ns, (unsigned long long)capture.cpu_ns, (long long)capture.margin_ns,
+                capture.view_count, capture.depth);
+    }
+
+    if (mock.frame_limit && mock.frames >= mock.frame_limit)
+    {
+        request_exit();
+    }
+    MOCK_UNLOCK();
+    return XR_SUCCESS;
+}
+
+// Dispatch
+
+typedef struct mock_function_t
+{
+    const char *name;
+    PFN_xrVoidFunction function;
+} mock_function_t;
+
+#define MOCK_FUNCTION(name) {#name, (PFN_xrVoidFunction)mock_##name}
+
+static const mock_function_t functions[] = {
+    MOCK_FUNCTION(xrGetInstanceProcAddr),
+    MOCK_FUNCTION(xrEnumerateInstanceExtensionProperties),
+    MOCK_FUNCTION(xrEnumerateApiLayerProperties),
+    MOCK_FUNCTION(xrCreateInstance),
+    MOCK_FUNCTION(xrDestroyInstance),
+    MOCK_FUNCTION(xrGetInstanceProperties),
+    MOCK_FUNCTION(xrStringToPath),
+    MOCK_FUNCTION(xrPathToString),
+    MOCK_FUNCTION(xrGetSystem),
+    MOCK_FUNCTION(xrGetSystemProperties),
+    MOCK_FUNCTION(xrEnumerateViewConfigurations),
+    MOCK_FUNCTION(xrEnumerateViewConfigurationViews),
+    MOCK_FUNCTION(xrGetOpenGLGraphicsRequirementsKHR),
+    MOCK_FUNCTION(xrCreateSession),
+    MOCK_FUNCTION(xrDestroySession),
+    MOCK_FUNCTION(xrBeginSession),
+    MOCK_FUNCTION(xrEndSession),
+    MOCK_FUNCTION(xrRequestExitSession),
+    MOCK_FUNCTION(xrPollEvent),
+    MOCK_FUNCTION(xrCreateReferenceSpace),
+    MOCK_FUNCTION(xrCreateActionSpace),
+    MOCK_FUNCTION(xrDestroySpace),
+    MOCK_FUNCTION(xrLocateSpace),
+    MOCK_FUNCTION(xrCreateActionSet),
+    MOCK_FUNCTION(xrDestroyActionSet),
+    MOCK_FUNCTION(xrCreateAction),
+    MOCK_FUNCTION(xrDestroyAction),
+    MOCK_FUNCTION(xrSuggestInteractionProfileBindings),
+    MOCK_FUNCTION(xrAttachSessionActionSets),
+    MOCK_FUNCTION(xrGetCurrentInteractionProfile),
+    MOCK_FUNCTION(xrSyncActions),
+    MOCK_FUNCTION(xrGetActionStatePose),
+    MOCK_FUNCTION(xrGetActionStateFloat),
+    MOCK_FUNCTION(xrApplyHapticFeedback),
+    MOCK_FUNCTION(xrStopHapticFeedback),
+    MOCK_FUNCTION(xrEnumerateSwapchainFormats),
+    MOCK_FUNCTION(xrCreateSwapchain),
+    MOCK_FUNCTION(xrDestroySwapchain),
+    MOCK_FUNCTION(xrEnumerateSwapchainImages),
+    MOCK_FUNCTION(xrAcquireSwapchainImage),
+    MOCK_FUNCTION(xrWaitSwapchainImage),
+    MOCK_FUNCTION(xrReleaseSwapchainImage),
+    MOCK_FUNCTION(xrWaitFrame),
+    MOCK_FUNCTION(xrBeginFrame),
+    MOCK_FUNCTION(xrLocateViews),
+    MOCK_FUNCTION(xrEndFrame),
+#ifdef _WIN32
+    MOCK_FUNCTION(xrConvertWin32PerformanceCounterToTimeKHR),
+#else
+    MOCK_FUNCTION(xrConvertTimespecTimeToTimeKHR),
+#endif
+};
+
+static XrResult XRAPI_CALL mock_xrGetInstanceProcAddr(XrInstance instance, const char *name, PFN_xrVoidFunction *function)
+{
+    for (size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++)
+    {
+        if (strcmp(functions[i].name, name) == 0)
+        {
+            *function = functions[i].function;
+            return XR_SUCCESS;
+        }
+    }
+
+    // the loader asks for every core function, the ones main() does not use are missing
+    *function = NULL;
+    return XR_ERROR_FUNCTION_UNSUPPORTED;
+}
+
+MOCK_EXPORT XrResult XRAPI_CALL xrNegotiateLoaderRuntimeInterface(const XrNegotiateLoaderInfo *loader_info, XrNegotiateRuntimeRequest *runtime_request)
+{
+    if (!loader_info || !runtime_request || loader_info->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
+        loader_info->minInterfaceVersion > XR_CURRENT_LOADER_RUNTIME_VERSION ||
+        loader_info->maxInterfaceVersion < XR_CURRENT_LOADER_RUNTIME_VERSION ||
+        runtime_request->structType != XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST)
+    {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+
+    runtime_request->runtimeInterfaceVersion = XR_CURRENT_LOADER_RUNTIME_VERSION;
+    runtime_request->runtimeApiVersion = XR_CURRENT_API_VERSION;
+    runtime_request->getInstanceProcAddr = mock_xrGetInstanceProcAddr;
+    return XR_SUCCESS;
+}